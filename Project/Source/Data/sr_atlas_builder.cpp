@@ -0,0 +1,820 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_atlas_builder.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_atlas_builder.hpp"
+
+#include "sr_export_extension.hpp"  // ExportExtensionWriter
+#include "sr_image_cache.hpp"       // ImageCache
+#include "sr_image_resample.hpp"    // imageResampleRows
+#include "sr_image_trim.hpp"        // imageAlphaBounds
+
+#include "sprite_anim/bf_sprite_animation.hpp"  // SpritesheetBuilder
+
+#include <QDir>            // QDir
+#include <QElapsedTimer>   // QElapsedTimer
+#include <QFile>           // QFile
+#include <QHashFunctions>  // qHashBits, qHashMulti
+#include <QImageReader>    // QImageReader
+#include <QPainter>        // QPainter
+#include <QThread>         // QThread
+#include <QThreadPool>     // QThreadPool
+
+#include <algorithm>      // clamp, count_if, max, min
+#include <cmath>          // ceil, floor
+#include <cstring>        // memcmp
+#include <unordered_map>  // unordered_multimap<K, V>
+
+static constexpr int k_MaxDecodeThreads = 64;
+static constexpr int k_WaitPollMs       = 16;
+
+static constexpr ResampleFilter k_AtlasResampleFilter = ResampleFilter::Lanczos3;
+
+static constexpr std::uint32_t k_AlphaModePremultiplied = 1u;  //!< The "ALPH" extension chunk's 'alpha_mode'.
+
+int roundToUpperMultiple(int n, int grid_size)
+{
+  const int remainder = grid_size == 0 ? 0 : n % grid_size;
+
+  return (remainder == 0) ? n : n + grid_size - remainder;
+}
+
+QRect aspectRatioDrawRegion(std::uint32_t aspect_w, std::uint32_t aspect_h, std::uint32_t window_w, std::uint32_t window_h)
+{
+  QRect result = {};
+
+  if (aspect_w > 0 && aspect_h > 0 && window_w > 0 && window_h > 0)
+  {
+    const float optimal_w = float(window_h) * (float(aspect_w) / float(aspect_h));
+    const float optimal_h = float(window_w) * (float(aspect_h) / float(aspect_w));
+
+    if (optimal_w > float(window_w))
+    {
+      result.setRight(int(window_w) - 1);
+      result.setTop(qRound(0.5f * (window_h - optimal_h)));
+      result.setBottom(int(result.top() + optimal_h) - 1);
+    }
+    else
+    {
+      result.setBottom(int(window_h) - 1);
+      result.setLeft(qRound(0.5f * (window_w - optimal_w)));
+      result.setRight(int(result.left() + optimal_w) - 1);
+    }
+  }
+
+  return result;
+}
+
+int atlasResolveThreadCount(int requested_threads)
+{
+  if (requested_threads <= 0)
+  {
+    requested_threads = QThread::idealThreadCount();
+  }
+
+  return std::clamp(requested_threads, 1, k_MaxDecodeThreads);
+}
+
+void atlasDecodeImage(const QString& abs_image_path, QImage& out_image, std::size_t& out_hash)
+{
+  QImageReader reader(abs_image_path);
+
+  // NOTE(SR): Converted once here (a no-op for a null image) rather than by QPainter / the resampler each time the frame is drawn.
+  out_image = reader.read().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  out_hash  = atlasImageHash(out_image);
+}
+
+void atlasDecodeImages(const QVector<QString>& abs_image_paths, int num_threads, ImageCache* cache, AtlasDecodeResult& result, std::atomic_int* num_decoded, const std::function<void()>& on_wait, const std::atomic_bool* cancel)
+{
+  const int num_images = abs_image_paths.size();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  std::vector<ImageCacheKey> cache_keys     = {};
+  std::vector<int>           images_to_read = {};
+
+  result.images.clear();
+  result.images.resize(num_images);
+  result.image_hashes.clear();
+  result.image_hashes.resize(num_images, 0u);
+  result.num_cache_hits = 0;
+
+  images_to_read.reserve(num_images);
+
+  if (cache)
+  {
+    cache_keys.reserve(num_images);
+
+    for (int i = 0; i < num_images; ++i)
+    {
+      const ImageCacheKey& key = cache_keys.emplace_back(ImageCacheKey::fromFile(abs_image_paths[i]));
+
+      if (cache->find(key, result.images[i], result.image_hashes[i]))
+      {
+        ++result.num_cache_hits;
+
+        if (num_decoded)
+        {
+          num_decoded->fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      else
+      {
+        images_to_read.push_back(i);
+      }
+    }
+  }
+  else
+  {
+    for (int i = 0; i < num_images; ++i)
+    {
+      images_to_read.push_back(i);
+    }
+  }
+
+  result.num_threads = std::min(atlasResolveThreadCount(num_threads), std::max(int(images_to_read.size()), 1));
+
+  // NOTE(SR):
+  //   A private pool rather than the global one so that the user's thread count
+  //   is respected and so that we never wait on unrelated work.
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(result.num_threads);
+
+  for (const int i : images_to_read)
+  {
+    pool.start([&abs_image_paths, &result, num_decoded, cancel, i]() {
+      if (cancel && cancel->load(std::memory_order_relaxed))
+      {
+        return;
+      }
+
+      // Each slot is only ever written by a single task so no locking is needed.
+      atlasDecodeImage(abs_image_paths[i], result.images[i], result.image_hashes[i]);
+
+      if (num_decoded)
+      {
+        num_decoded->fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+
+  if (on_wait)
+  {
+    while (!pool.waitForDone(k_WaitPollMs))
+    {
+      on_wait();
+    }
+  }
+  else
+  {
+    pool.waitForDone();
+  }
+
+  // NOTE(SR): A skipped image is null and inserting that would evict a good entry.
+  if (cache && !(cancel && cancel->load(std::memory_order_relaxed)))
+  {
+    for (const int i : images_to_read)
+    {
+      cache->insert(cache_keys[i], result.images[i], result.image_hashes[i]);
+    }
+  }
+
+  result.decode_time_ms = timer.elapsed();
+}
+
+// NOTE(SR): Resampled up front rather than scaled by QPainter (bilinear) which aliases on big reductions, the draw is then a plain blit.
+static void drawResampledFrame(QPainter& painter, const QImage& image, const QRectF& source_rect, const QRect& target_rect, const QRect& clip_rect)
+{
+  // A band only pays for the rows of the frame that land in it.
+  const int row_begin = clip_rect.isNull() ? 0 : std::max(clip_rect.top() - target_rect.top(), 0);
+  const int row_end   = clip_rect.isNull() ? target_rect.height() : std::min(clip_rect.bottom() + 1 - target_rect.top(), target_rect.height());
+
+  if (!target_rect.isEmpty() && row_begin < row_end)
+  {
+    painter.drawImage(QPoint(target_rect.left(), target_rect.top() + row_begin), imageResampleRows(image, source_rect, target_rect.size(), row_begin, row_end, k_AtlasResampleFilter));
+  }
+}
+
+QRect atlasCompositeFrame(QPainter& painter, const QImage& image, const QRect& cell_rect, const QRect& clip_rect)
+{
+  const QRect target_rect = aspectRatioDrawRegion(image.width(), image.height(), cell_rect.width(), cell_rect.height()).translated(cell_rect.topLeft());
+
+  drawResampledFrame(painter, image, QRectF(image.rect()), target_rect, clip_rect);
+
+  return target_rect;
+}
+
+std::size_t atlasImageHash(const QImage& image)
+{
+  if (image.isNull())
+  {
+    return 0u;
+  }
+
+  const qsizetype num_row_bytes = qsizetype(image.width()) * image.depth() / 8;
+  std::size_t     hash          = qHashMulti(0u, image.width(), image.height(), int(image.format()));
+
+  for (int y = 0; y < image.height(); ++y)
+  {
+    hash = qHashBits(image.constScanLine(y), num_row_bytes, hash);
+  }
+
+  return hash;
+}
+
+bool atlasImagesEqual(const QImage& lhs, const QImage& rhs)
+{
+  if (lhs.size() != rhs.size() || lhs.format() != rhs.format())
+  {
+    return false;
+  }
+
+  const std::size_t num_row_bytes = std::size_t(lhs.width()) * lhs.depth() / 8;
+
+  for (int y = 0; y < lhs.height(); ++y)
+  {
+    if (std::memcmp(lhs.constScanLine(y), rhs.constScanLine(y), num_row_bytes) != 0)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::vector<int> atlasFindDuplicateImages(const std::vector<QImage>& images, const std::vector<std::size_t>& image_hashes)
+{
+  const int                                 num_images = int(images.size());
+  std::vector<int>                          result     = {};
+  std::unordered_multimap<std::size_t, int> unique_images;
+
+  result.reserve(num_images);
+  unique_images.reserve(num_images);
+
+  for (int i = 0; i < num_images; ++i)
+  {
+    const QImage& image     = images[i];
+    int           canonical = i;
+
+    if (!image.isNull())
+    {
+      // NOTE(SR): A hash hit still gets a full compare, a collision must never merge two different frames.
+      const auto range = unique_images.equal_range(image_hashes[i]);
+
+      for (auto it = range.first; it != range.second; ++it)
+      {
+        if (atlasImagesEqual(images[it->second], image))
+        {
+          canonical = it->second;
+          break;
+        }
+      }
+
+      if (canonical == i)
+      {
+        unique_images.emplace(image_hashes[i], i);
+      }
+    }
+
+    result.push_back(canonical);
+  }
+
+  return result;
+}
+
+QSize atlasFitFrameSize(const QSize& image_size, int frame_size)
+{
+  return aspectRatioDrawRegion(image_size.width(), image_size.height(), frame_size, frame_size).size();
+}
+
+QRect atlasAlphaBounds(const QImage& image)
+{
+  if (!image.hasAlphaChannel())
+  {
+    return image.rect();
+  }
+
+  const bool   is_argb32    = image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_ARGB32_Premultiplied;
+  const QImage argb32_image = is_argb32 ? image : image.convertToFormat(QImage::Format_ARGB32);
+  AlphaBounds  bounds;
+
+  if (!imageAlphaBounds(reinterpret_cast<const std::uint32_t*>(argb32_image.constBits()), argb32_image.width(), argb32_image.height(), argb32_image.bytesPerLine(), bounds))
+  {
+    return QRect();
+  }
+
+  return QRect(bounds.x, bounds.y, bounds.width, bounds.height);
+}
+
+QRect atlasTrimmedFrameRect(const QSize& image_size, const QRect& alpha_bounds, int frame_size)
+{
+  const QSize fit_size = atlasFitFrameSize(image_size, frame_size);
+
+  // NOTE(SR): A fully transparent frame keeps a single pixel so that it still has a valid UV rect.
+  if (alpha_bounds.isEmpty() || fit_size.isEmpty())
+  {
+    return QRect(0, 0, 1, 1);
+  }
+
+  const double scale_x = double(fit_size.width()) / double(image_size.width());
+  const double scale_y = double(fit_size.height()) / double(image_size.height());
+  const int    left    = std::clamp(int(std::floor(alpha_bounds.x() * scale_x)), 0, fit_size.width() - 1);
+  const int    top     = std::clamp(int(std::floor(alpha_bounds.y() * scale_y)), 0, fit_size.height() - 1);
+  const int    right   = std::clamp(int(std::ceil((alpha_bounds.x() + alpha_bounds.width()) * scale_x)), left + 1, fit_size.width());
+  const int    bottom  = std::clamp(int(std::ceil((alpha_bounds.y() + alpha_bounds.height()) * scale_y)), top + 1, fit_size.height());
+
+  return QRect(left, top, right - left, bottom - top);
+}
+
+std::vector<QSize> atlasLayoutFrames(AtlasPackingMode mode, const std::vector<QSize>& image_sizes, const std::vector<QRect>& trim_bounds, int frame_size, int atlas_width, int max_page_size, int padding, std::vector<QRect>& out_rects, std::vector<int>& out_pages, std::vector<AtlasFrameTrim>& out_trims)
+{
+  const int num_images = int(image_sizes.size());
+
+  std::vector<QSize> page_sizes = {};
+
+  out_rects.clear();
+  out_rects.reserve(num_images);
+  out_pages.clear();
+  out_pages.reserve(num_images);
+  out_trims.clear();
+  out_trims.reserve(num_images);
+
+  if (mode == AtlasPackingMode::Grid)
+  {
+    // TODO(SR): This policy is probably stupid and makes 'atlas_width' nearly useless from the user's perspective.
+    const int grid_width      = roundToUpperMultiple(atlas_width, frame_size);
+    const int num_frame_cols  = std::max(std::min(grid_width, max_page_size) / frame_size, 1);
+    const int rows_per_page   = std::max(max_page_size / frame_size, 1);
+    const int frames_per_page = num_frame_cols * rows_per_page;
+    const int num_frames      = int(std::count_if(image_sizes.begin(), image_sizes.end(), [](const QSize& size) { return !size.isEmpty(); }));
+    int       frame_index     = 0;
+
+    for (int frames_left = num_frames; frames_left > 0; frames_left -= frames_per_page)
+    {
+      const int num_page_rows = (std::min(frames_left, frames_per_page) + num_frame_cols - 1) / num_frame_cols;
+
+      page_sizes.emplace_back(num_frame_cols * frame_size, num_page_rows * frame_size);
+    }
+
+    for (const QSize& image_size : image_sizes)
+    {
+      if (image_size.isEmpty())
+      {
+        out_rects.emplace_back();
+        out_pages.push_back(0);
+        out_trims.push_back(AtlasFrameTrim{QPoint(0, 0), QSize(0, 0)});
+        continue;
+      }
+
+      const int page_frame_index = frame_index % frames_per_page;
+
+      // NOTE(SR): Trimming would not save any space since every cell is the same size.
+      out_rects.emplace_back((page_frame_index % num_frame_cols) * frame_size, (page_frame_index / num_frame_cols) * frame_size, frame_size, frame_size);
+      out_pages.push_back(frame_index / frames_per_page);
+      out_trims.push_back(AtlasFrameTrim{QPoint(0, 0), QSize(frame_size, frame_size)});
+
+      ++frame_index;
+    }
+
+    if (page_sizes.empty())
+    {
+      page_sizes.emplace_back(0, 0);
+    }
+
+    return page_sizes;
+  }
+
+  std::vector<PackerRect> packer_rects = {};
+  packer_rects.reserve(num_images);
+
+  for (int i = 0; i < num_images; ++i)
+  {
+    const QSize& image_size = image_sizes[i];
+
+    if (image_size.isEmpty())
+    {
+      packer_rects.push_back(PackerRect{0, 0, 0, 0, 0});
+      out_trims.push_back(AtlasFrameTrim{QPoint(0, 0), QSize(0, 0)});
+      continue;
+    }
+
+    const QSize fit_size   = atlasFitFrameSize(image_size, frame_size);
+    const QRect frame_rect = trim_bounds.empty() ? QRect(QPoint(0, 0), fit_size) : atlasTrimmedFrameRect(image_size, trim_bounds[i], frame_size);
+
+    packer_rects.push_back(PackerRect{0, 0, frame_rect.width(), frame_rect.height(), 0});
+    out_trims.push_back(AtlasFrameTrim{frame_rect.topLeft(), fit_size});
+  }
+
+  std::vector<PackerPage> packer_pages = {};
+
+  packRects(mode, packer_rects, std::min(atlas_width, max_page_size), max_page_size, padding, packer_pages);
+
+  for (const PackerRect& rect : packer_rects)
+  {
+    out_rects.emplace_back(rect.x, rect.y, rect.width, rect.height);
+    out_pages.push_back(rect.page);
+  }
+
+  for (const PackerPage& page : packer_pages)
+  {
+    page_sizes.emplace_back(page.width, page.height);
+  }
+
+  if (page_sizes.empty())
+  {
+    page_sizes.emplace_back(0, 0);
+  }
+
+  return page_sizes;
+}
+
+void atlasCompositeFrame(QPainter& painter, AtlasPackingMode mode, const QImage& image, const QRect& frame_rect, const AtlasFrameTrim& trim, int padding, const QRect& clip_rect)
+{
+  if (mode == AtlasPackingMode::Grid)
+  {
+    atlasCompositeFrame(painter, image, frame_rect.adjusted(0, 0, -padding, -padding), clip_rect);
+  }
+  else
+  {
+    // The packed rect is a region of the aspect fit frame so the source rect is
+    // that same region mapped back into image space, keeping the scale of an untrimmed frame.
+
+    const qreal  scale_x     = qreal(image.width()) / qreal(trim.source_size.width());
+    const qreal  scale_y     = qreal(image.height()) / qreal(trim.source_size.height());
+    const QRectF source_rect = QRectF(
+     trim.offset.x() * scale_x,
+     trim.offset.y() * scale_y,
+     frame_rect.width() * scale_x,
+     frame_rect.height() * scale_y);
+
+    drawResampledFrame(painter, image, source_rect, frame_rect, clip_rect);
+  }
+}
+
+void atlasLayoutImages(const AtlasDecodeResult& decoded_images, const AtlasBuildSettings& settings, AtlasLayout& out_layout)
+{
+  const std::vector<QImage>& images      = decoded_images.images;
+  const int                  num_images  = int(images.size());
+  const bool                 trim_frames = settings.trim_frames && settings.packing_mode != AtlasPackingMode::Grid;
+
+  // Dedup Stage
+
+  // NOTE(SR): Looping animations tend to reuse identical frames under different file names,
+  //           those share the first copy's rect and UV frame rather than getting one of their own.
+  out_layout.image_aliases = atlasFindDuplicateImages(images, decoded_images.image_hashes);
+
+  // Layout Stage
+
+  std::vector<QSize> image_sizes = {};
+  std::vector<QRect> trim_bounds = {};
+
+  image_sizes.reserve(num_images);
+
+  for (int image_index = 0; image_index < num_images; ++image_index)
+  {
+    const bool is_duplicate = out_layout.image_aliases[image_index] != image_index;
+
+    image_sizes.push_back(is_duplicate ? QSize() : images[image_index].size());
+  }
+
+  if (trim_frames)
+  {
+    trim_bounds.reserve(num_images);
+
+    for (int image_index = 0; image_index < num_images; ++image_index)
+    {
+      const bool is_laid_out = !image_sizes[image_index].isEmpty();
+
+      trim_bounds.push_back(is_laid_out ? atlasAlphaBounds(images[image_index]) : QRect());
+    }
+  }
+
+  out_layout.page_sizes = atlasLayoutFrames(
+   settings.packing_mode,
+   image_sizes,
+   trim_bounds,
+   settings.frame_size,
+   settings.atlas_width,
+   settings.max_page_size,
+   settings.padding,
+   out_layout.image_rects,
+   out_layout.image_pages,
+   out_layout.image_trims);
+  out_layout.is_trimmed = trim_frames;
+
+  out_layout.image_to_uv.clear();
+  out_layout.image_to_uv.reserve(num_images);
+  out_layout.uv_frame_images.clear();
+  out_layout.uv_frame_images.reserve(num_images);
+
+  for (int image_index = 0; image_index < num_images; ++image_index)
+  {
+    const int alias_index = out_layout.image_aliases[image_index];
+
+    if (alias_index == image_index)
+    {
+      out_layout.image_to_uv.push_back(std::uint32_t(out_layout.uv_frame_images.size()));
+      out_layout.uv_frame_images.push_back(image_index);
+    }
+    else
+    {
+      out_layout.image_rects[image_index] = out_layout.image_rects[alias_index];
+      out_layout.image_pages[image_index] = out_layout.image_pages[alias_index];
+      out_layout.image_trims[image_index] = out_layout.image_trims[alias_index];
+      out_layout.image_to_uv.push_back(out_layout.image_to_uv[alias_index]);
+    }
+  }
+}
+
+// Draws the frames of page `page_index` that overlap `region` (in page space) into `out_image`, which covers just `region`.
+// Returns false if `cancel` was set before every frame was drawn.
+static bool compositePageRegion(const std::vector<QImage>& images, const AtlasBuildSettings& settings, const AtlasLayout& layout, int page_index, const QRect& region, QImage& out_image, const std::function<void()>& on_frame, const std::atomic_bool* cancel)
+{
+  const int num_images = int(images.size());
+
+  out_image.fill(0x00000000);
+
+  QPainter painter(&out_image);
+  painter.setRenderHint(QPainter::Antialiasing, true);
+  painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+  // NOTE(SR): A whole pixel translation so a band gets exactly the pixels it would have had in the full page.
+  painter.translate(-region.topLeft());
+
+  for (int image_index = 0; image_index < num_images; ++image_index)
+  {
+    const QImage& image = images[image_index];
+
+    if (cancel && cancel->load(std::memory_order_relaxed))
+    {
+      return false;
+    }
+
+    if (image.isNull() || layout.image_aliases[image_index] != image_index || layout.image_pages[image_index] != page_index)
+    {
+      continue;
+    }
+
+    const QRect& frame_rect = layout.image_rects[image_index];
+
+    if (!frame_rect.intersects(region))
+    {
+      continue;
+    }
+
+    atlasCompositeFrame(painter, settings.packing_mode, image, frame_rect, layout.image_trims[image_index], settings.padding, region);
+
+    if (on_frame)
+    {
+      on_frame();
+    }
+  }
+
+  painter.end();
+
+  return true;
+}
+
+QImage atlasCompositePage(const std::vector<QImage>& images, const AtlasBuildSettings& settings, const AtlasLayout& layout, int page_index, const std::function<void()>& on_frame, const std::atomic_bool* cancel)
+{
+  QImage page_image(layout.page_sizes[page_index], QImage::Format_ARGB32_Premultiplied);
+
+  if (page_image.isNull())
+  {
+    return page_image;
+  }
+
+  if (!compositePageRegion(images, settings, layout, page_index, page_image.rect(), page_image, on_frame, cancel))
+  {
+    return QImage();
+  }
+
+  return page_image;
+}
+
+QImage atlasCompositeBand(const std::vector<QImage>& images, const AtlasBuildSettings& settings, const AtlasLayout& layout, int page_index, int band_y, int band_height)
+{
+  const QSize& page_size = layout.page_sizes[page_index];
+  const QRect  region    = QRect(0, band_y, page_size.width(), band_height).intersected(QRect(QPoint(0, 0), page_size));
+
+  QImage band_image(region.size(), QImage::Format_ARGB32_Premultiplied);
+
+  if (!band_image.isNull())
+  {
+    compositePageRegion(images, settings, layout, page_index, region, band_image, {}, nullptr);
+  }
+
+  return band_image;
+}
+
+bool atlasWritePageStreaming(const QString& file_path, const std::vector<QImage>& images, const AtlasBuildSettings& settings, const AtlasLayout& layout, int page_index, const PngEncodeOptions& png_options)
+{
+  const QSize& page_size = layout.page_sizes[page_index];
+  QFile        file(file_path);
+
+  // NOTE(SR): Removed rather than truncated since it may be a hard link into the build cache.
+  file.remove();
+
+  if (!file.open(QFile::WriteOnly))
+  {
+    return false;
+  }
+
+  PngStreamEncoder encoder(file, page_size, png_options);
+  const int        band_height = encoder.rowsPerBand();
+
+  for (int band_y = 0; band_y < page_size.height(); band_y += band_height)
+  {
+    const QImage band_image = atlasCompositeBand(images, settings, layout, page_index, band_y, band_height);
+
+    if (band_image.isNull() || !encoder.writeRows(band_image))
+    {
+      return false;
+    }
+  }
+
+  return encoder.finish();
+}
+
+std::unique_ptr<unsigned char[]> atlasBuildSpritesheetData(const QUuid& edit_uuid, const AtlasLayout& layout, const std::vector<AtlasAnimation>& animations, std::uint64_t& out_size)
+{
+  const auto&         uv_images     = layout.uv_frame_images;
+  const std::uint32_t num_uv_frames = std::uint32_t(uv_images.size());
+  const QSize         first_page    = layout.page_sizes.empty() ? QSize(0, 0) : layout.page_sizes[0];
+
+  std::vector<QByteArray> animation_names = {};
+  animation_names.reserve(animations.size());
+
+  SpriteAnim::SpritesheetDataSizeCalculator data_size = {};
+
+  for (const AtlasAnimation& animation : animations)
+  {
+    const QByteArray& animation_name = animation_names.emplace_back(animation.name.toLocal8Bit());
+
+    data_size.addAnimation(std::uint32_t(animation_name.size()), std::uint32_t(animation.frames.size()));
+  }
+
+  for (std::uint32_t i = 0; i < num_uv_frames; ++i)
+  {
+    data_size.addUVFrame();
+  }
+
+  out_size = SpriteAnim::Spritesheet::calcTotalSize(data_size);
+
+  std::unique_ptr<unsigned char[]> result = std::make_unique<unsigned char[]>(out_size);
+
+  static_assert(sizeof(QUuid) == sizeof(uuid128), "");
+
+  SpriteAnim::SpritesheetBuilder spritesheet_builder =
+   {
+    result.get(),
+    *(const uuid128*)&edit_uuid,
+    std::uint16_t(first_page.width()),
+    std::uint16_t(first_page.height()),
+    data_size,
+   };
+
+  for (std::size_t i = 0; i < animations.size(); ++i)
+  {
+    const AtlasAnimation& animation      = animations[i];
+    const QByteArray&     animation_name = animation_names[i];
+
+    auto animation_builder = spritesheet_builder.addAnimation(
+     string_range{animation_name.data(), std::size_t(animation_name.size())},
+     std::uint32_t(animation.frames.size()));
+
+    for (const AtlasAnimationFrame& frame : animation.frames)
+    {
+      animation_builder.addFrame(frame.uv_frame, frame.frame_time);
+    }
+  }
+
+  // NOTE(SR): Each UV frame is normalized to the page it is on, see the "PAGE" extension chunk.
+
+  for (std::uint32_t i = 0; i < num_uv_frames; ++i)
+  {
+    const QRect&  img_rect       = layout.image_rects[uv_images[i]];
+    const QSize&  page_size      = layout.page_sizes[layout.image_pages[uv_images[i]]];
+    const float32 image_width_f  = float32(page_size.width());
+    const float32 image_height_f = float32(page_size.height());
+
+    const uint32_t x = img_rect.x();
+    const uint32_t y = img_rect.y();
+    const uint32_t w = img_rect.width();
+    const uint32_t h = img_rect.height();
+
+    region2Df dst_uv_frame;
+    dst_uv_frame.min.x = float32(x + 0.0f) / image_width_f;
+    dst_uv_frame.min.y = float32(y + 0.0f) / image_height_f;
+    dst_uv_frame.max.x = float32(x + w) / image_width_f;
+    dst_uv_frame.max.y = float32(y + h) / image_height_f;
+
+    spritesheet_builder.addUVFrames(&dst_uv_frame, 1u);
+  }
+
+  spritesheet_builder.end();
+
+  return result;
+}
+
+QByteArray atlasBuildExtensionData(const AtlasLayout& layout, const AtlasBuildSettings& settings)
+{
+  const auto&         uv_images     = layout.uv_frame_images;
+  const std::uint32_t num_uv_frames = std::uint32_t(uv_images.size());
+
+  // Editor data the runtime's spritesheet format has no room for.
+
+  ExportExtensionWriter extension_writer = {};
+
+  if (layout.is_trimmed)
+  {
+    extension_writer.beginChunk("TRIM");
+    extension_writer.writeU32(num_uv_frames);
+
+    for (std::uint32_t i = 0; i < num_uv_frames; ++i)
+    {
+      const AtlasFrameTrim& trim = layout.image_trims[uv_images[i]];
+
+      extension_writer.writeI32(trim.offset.x());
+      extension_writer.writeI32(trim.offset.y());
+      extension_writer.writeU32(trim.source_size.width());
+      extension_writer.writeU32(trim.source_size.height());
+    }
+  }
+
+  if (layout.page_sizes.size() > 1)
+  {
+    extension_writer.beginChunk("PAGE");
+    extension_writer.writeU32(std::uint32_t(layout.page_sizes.size()));
+
+    for (const QSize& page_size : layout.page_sizes)
+    {
+      extension_writer.writeU32(page_size.width());
+      extension_writer.writeU32(page_size.height());
+    }
+
+    extension_writer.writeU32(num_uv_frames);
+
+    for (std::uint32_t i = 0; i < num_uv_frames; ++i)
+    {
+      extension_writer.writeU32(layout.image_pages[uv_images[i]]);
+    }
+  }
+
+  if (settings.premultiplied_alpha)
+  {
+    extension_writer.beginChunk("ALPH");
+    extension_writer.writeU32(k_AlphaModePremultiplied);
+  }
+
+  return extension_writer.end();
+}
+
+QString atlasPageFileName(const QString& name, int page_index)
+{
+  // NOTE(SR): The first page keeps the plain name so single page exports look the same as before.
+  return (page_index == 0 ? name : QString("%1_%2").arg(name).arg(page_index)) + ".png";
+}
+
+bool atlasWriteSpritesheetFile(const QString& file_path, const unsigned char* atlas_data, std::uint64_t atlas_data_size, const QByteArray& extension_data)
+{
+  QFile bytes_file = file_path;
+
+  // NOTE(SR): Removed rather than truncated since it may be a hard link into the build cache.
+  bytes_file.remove();
+
+  if (!bytes_file.open(QFile::WriteOnly))
+  {
+    return false;
+  }
+
+  bytes_file.write((const char*)atlas_data, atlas_data_size);
+  bytes_file.write(extension_data);
+  bytes_file.close();
+
+  return true;
+}
+
+bool atlasWriteExport(const QString& dir_path, const QString& name, const std::vector<QImage>& pages, const unsigned char* atlas_data, std::uint64_t atlas_data_size, const QByteArray& extension_data, const PngEncodeOptions& png_options)
+{
+  QDir root_dir      = dir_path;
+  bool is_successful = !pages.empty();
+
+  for (std::size_t page_index = 0; is_successful && page_index < pages.size(); ++page_index)
+  {
+    const QString page_path = root_dir.filePath(atlasPageFileName(name, int(page_index)));
+
+    QFile::remove(page_path);
+
+    is_successful = pngWriteFile(pages[page_index], page_path, png_options);
+  }
+
+  // Only write out bytes if we were able to save the png.
+  return is_successful && atlasWriteSpritesheetFile(root_dir.filePath(name + ".srsm.bytes"), atlas_data, atlas_data_size, extension_data);
+}
@@ -0,0 +1,209 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_atlas_builder.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_ATLAS_BUILDER_HPP
+#define SR_ATLAS_BUILDER_HPP
+
+#include "Data/sr_png_encoder.hpp"  // PngEncodeOptions
+#include "Data/sr_rect_packer.hpp"  // AtlasPackingMode
+
+#include <QByteArray>  // QByteArray
+#include <QImage>      // QImage
+#include <QPoint>      // QPoint
+#include <QRect>       // QRect
+#include <QSize>       // QSize
+#include <QString>     // QString
+#include <QUuid>       // QUuid
+#include <QVector>     // QVector<T>
+
+#include <atomic>      // atomic_bool, atomic_int
+#include <cstddef>     // size_t
+#include <cstdint>     // uint32_t, uint64_t
+#include <functional>  // function<T>
+#include <memory>      // unique_ptr<T>
+#include <vector>      // vector<T>
+
+class ImageCache;
+class QPainter;
+
+// NOTE(SR): The largest image QPainter can draw into [https://doc.qt.io/qt-6/qpainter.html#limitations].
+constexpr int k_MaxAtlasPageSize  = 32767;
+constexpr int k_AtlasFramePadding = 0;
+
+// NOTE(SR):
+//   Nothing in here is allowed to touch QWidget / QPixmap so that the
+//   stages can be run from a worker thread (or without a GUI at all).
+//
+//   Images are 'QImage::Format_ARGB32_Premultiplied' from decode to the finished pages, that is the format
+//   QPainter and the resampler blend in so no stage converts per draw. Straight alpha only comes back when a png is written.
+
+struct AtlasDecodeResult final
+{
+  std::vector<QImage>      images;          //!< Parallel to the list of paths passed in, a null image means the decode failed.
+  std::vector<std::size_t> image_hashes;    //!< Parallel to 'images', the 'atlasImageHash' of each.
+  qint64                   decode_time_ms;  //!< Wall time of the whole decode stage.
+  int                      num_threads;     //!< The number of threads that were actually used.
+  int                      num_cache_hits;  //!< The number of images that did not need to be read from disk.
+};
+
+// Where a (possibly trimmed) frame sits within its untrimmed frame.
+struct AtlasFrameTrim final
+{
+  QPoint offset;       //!< Top left of the packed frame within the untrimmed frame.
+  QSize  source_size;  //!< The untrimmed (aspect fit) frame size.
+};
+
+// The project's quality settings that affect the atlas.
+struct AtlasBuildSettings final
+{
+  AtlasPackingMode packing_mode;
+  int              frame_size;           //!< Each frame is scaled to fit in a square of this size.
+  int              atlas_width;          //!< The width of the atlas the layout aims for.
+  int              max_page_size;        //!< Frames that do not fit in a square of this size spill over onto another page.
+  int              padding;              //!< Empty pixels kept between neighboring frames.
+  bool             trim_frames;          //!< Only has an effect on the packing modes.
+  bool             premultiplied_alpha;  //!< Only affects the export, pages are always composited premultiplied.
+
+  // Whether the pages built with either would be the same, so 'premultiplied_alpha' is left out.
+  friend bool operator==(const AtlasBuildSettings& lhs, const AtlasBuildSettings& rhs)
+  {
+    return lhs.packing_mode == rhs.packing_mode &&
+           lhs.frame_size == rhs.frame_size &&
+           lhs.atlas_width == rhs.atlas_width &&
+           lhs.max_page_size == rhs.max_page_size &&
+           lhs.padding == rhs.padding &&
+           lhs.trim_frames == rhs.trim_frames;
+  }
+
+  friend bool operator!=(const AtlasBuildSettings& lhs, const AtlasBuildSettings& rhs)
+  {
+    return !(lhs == rhs);
+  }
+};
+
+// Each image list is parallel to the list of images that was laid out.
+struct AtlasLayout final
+{
+  std::vector<QSize>          page_sizes;       //!< There is always at least one page.
+  std::vector<QRect>          image_rects;      //!< A duplicate image shares the rect of the image it is a copy of, a null image gets an empty rect.
+  std::vector<int>            image_pages;      //!< The index into 'page_sizes' each rect is on.
+  std::vector<AtlasFrameTrim> image_trims;      //!< Where each frame sits in its untrimmed frame.
+  std::vector<int>            image_aliases;    //!< The index of the first image with identical pixels.
+  std::vector<std::uint32_t>  image_to_uv;      //!< The index into 'uv_frame_images' of each image.
+  std::vector<int>            uv_frame_images;  //!< The image index of each exported UV frame, duplicate images share one.
+  bool                        is_trimmed;       //!< Whether the transparent borders of 'image_trims' were cut off.
+};
+
+struct AtlasAnimationFrame final
+{
+  std::uint32_t uv_frame;    //!< Index into 'AtlasLayout::uv_frame_images'.
+  float         frame_time;  //!< Units are in seconds.
+};
+
+struct AtlasAnimation final
+{
+  QString                          name;
+  std::vector<AtlasAnimationFrame> frames;
+};
+
+// Math Helpers
+
+int   roundToUpperMultiple(int n, int grid_size);
+QRect aspectRatioDrawRegion(std::uint32_t aspect_w, std::uint32_t aspect_h, std::uint32_t window_w, std::uint32_t window_h);
+
+// Returns `requested_threads` clamped to a sane range, 0 or less means use `QThread::idealThreadCount`.
+int atlasResolveThreadCount(int requested_threads);
+
+// Decodes a single image (a null image if it failed) as 'QImage::Format_ARGB32_Premultiplied' along with its `atlasImageHash`, safe to call from any thread.
+void atlasDecodeImage(const QString& abs_image_path, QImage& out_image, std::size_t& out_hash);
+
+// Decodes every image in `abs_image_paths` across a pool of `num_threads` workers.
+// When a `cache` is passed in only images missing from it (or changed on disk) are decoded. The cache is only
+// accessed from the calling thread (never the workers) but other threads may use it at the same time, 'ImageCache' locks itself.
+// `num_decoded` (optional) is incremented as each image finishes so that a caller
+// can poll it for progress, `on_wait` (optional) is called on the calling thread while waiting.
+// Once `cancel` (optional) is set the images not yet started are skipped, the result is then incomplete and is not cached.
+void atlasDecodeImages(const QVector<QString>& abs_image_paths, int num_threads, ImageCache* cache, AtlasDecodeResult& result, std::atomic_int* num_decoded = nullptr, const std::function<void()>& on_wait = {}, const std::atomic_bool* cancel = nullptr);
+
+// Hash of the pixels (and size / format) of `image`, padding at the end of each scanline is not included.
+std::size_t atlasImageHash(const QImage& image);
+
+// Full comparison of the pixels (and size / format) of two images.
+bool atlasImagesEqual(const QImage& lhs, const QImage& rhs);
+
+// For each image the index of the first image with identical pixels (its own index if there is none),
+// `image_hashes` are the `atlasImageHash` of each image. Null images are never considered duplicates.
+std::vector<int> atlasFindDuplicateImages(const std::vector<QImage>& images, const std::vector<std::size_t>& image_hashes);
+
+// The size `image_size` is scaled to so that it fits (keeping the aspect ratio) in a `frame_size` square.
+QSize atlasFitFrameSize(const QSize& image_size, int frame_size);
+
+// The smallest rect containing all of the non-transparent pixels of `image`, empty if it is fully transparent.
+QRect atlasAlphaBounds(const QImage& image);
+
+// The region of the aspect fit `frame_size` frame that `alpha_bounds` (in image space) covers, rounded out to whole pixels.
+QRect atlasTrimmedFrameRect(const QSize& image_size, const QRect& alpha_bounds, int frame_size);
+
+// Lays out a rect for each of `image_sizes` (an empty size, such as a duplicate frame, gets an empty rect on page 0),
+// returns the size of each page of the atlas needed, there is always at least one page.
+// `AtlasPackingMode::Grid` gives each frame a `frame_size` square cell in rows of `atlas_width` rounded up to a whole cell,
+// the other modes pack each frame at its `atlasFitFrameSize` into an atlas no wider than `atlas_width`.
+// Frames that do not fit in a `max_page_size` square spill over onto another page, `out_pages` is the page of each rect.
+// `trim_bounds` is either empty or the `atlasAlphaBounds` of each image, the packing modes then only pack that region.
+std::vector<QSize> atlasLayoutFrames(AtlasPackingMode mode, const std::vector<QSize>& image_sizes, const std::vector<QRect>& trim_bounds, int frame_size, int atlas_width, int max_page_size, int padding, std::vector<QRect>& out_rects, std::vector<int>& out_pages, std::vector<AtlasFrameTrim>& out_trims);
+
+// Draws `image` scaled to fit (keeping the aspect ratio) and centered in `cell_rect`.
+// Returns the region of the atlas that the image actually covers.
+// When `clip_rect` is not null only the rows of the frame inside it are resampled and drawn (the same pixels as drawing all of it).
+QRect atlasCompositeFrame(QPainter& painter, const QImage& image, const QRect& cell_rect, const QRect& clip_rect = QRect());
+
+// Draws `image` into `frame_rect` for a layout from `atlasLayoutFrames` in `mode`, `clip_rect` is the same as above.
+void atlasCompositeFrame(QPainter& painter, AtlasPackingMode mode, const QImage& image, const QRect& frame_rect, const AtlasFrameTrim& trim, int padding, const QRect& clip_rect = QRect());
+
+// Build Stages
+//
+//   These are the stages shared by the editor and the command line builder:
+//     atlasDecodeImages -> atlasLayoutImages -> atlasCompositePage (per page) -> atlasBuildSpritesheetData / atlasBuildExtensionData -> atlasWriteExport
+//
+//   For pages too big to keep in memory 'atlasWritePageStreaming' does the composite and png encode together.
+//
+
+// Runs the dedup and layout stages over the images from `atlasDecodeImages`.
+void atlasLayoutImages(const AtlasDecodeResult& decoded_images, const AtlasBuildSettings& settings, AtlasLayout& out_layout);
+
+// Draws each unique image on page `page_index` of `layout`, `on_frame` (optional) is called after each frame is drawn.
+// Returns a null image if `cancel` (optional) was set before the page was finished.
+QImage atlasCompositePage(const std::vector<QImage>& images, const AtlasBuildSettings& settings, const AtlasLayout& layout, int page_index, const std::function<void()>& on_frame = {}, const std::atomic_bool* cancel = nullptr);
+
+// Draws rows [`band_y`, `band_y + band_height`) of page `page_index`, the pixels are the same as that region of 'atlasCompositePage'.
+// A frame that crosses the edge of the band is drawn clipped to it.
+QImage atlasCompositeBand(const std::vector<QImage>& images, const AtlasBuildSettings& settings, const AtlasLayout& layout, int page_index, int band_y, int band_height);
+
+// Composites page `page_index` a band at a time straight into a png at `file_path` (see 'PngStreamEncoder'),
+// so only a few bands of the page are ever in memory rather than the whole page. The file is the same as 'pngWriteFile' of 'atlasCompositePage'.
+bool atlasWritePageStreaming(const QString& file_path, const std::vector<QImage>& images, const AtlasBuildSettings& settings, const AtlasLayout& layout, int page_index, const PngEncodeOptions& png_options);
+
+// Writes the runtime's spritesheet data (the '.srsm.bytes' file minus the extension block) for `layout`,
+// the size of the data is returned through `out_size`.
+std::unique_ptr<unsigned char[]> atlasBuildSpritesheetData(const QUuid& edit_uuid, const AtlasLayout& layout, const std::vector<AtlasAnimation>& animations, std::uint64_t& out_size);
+
+// The extension block written after the spritesheet data for `layout` built with `settings`, empty if there is nothing to write.
+QByteArray atlasBuildExtensionData(const AtlasLayout& layout, const AtlasBuildSettings& settings);
+
+// '<name>.png' for the first page, '<name>_N.png' for page N.
+QString atlasPageFileName(const QString& name, int page_index);
+
+// Writes the '.srsm.bytes' file, `extension_data` directly follows `atlas_data`.
+bool atlasWriteSpritesheetFile(const QString& file_path, const unsigned char* atlas_data, std::uint64_t atlas_data_size, const QByteArray& extension_data);
+
+// Writes each page to `dir_path` (named by `atlasPageFileName`) and the data to '<name>.srsm.bytes',
+// `png_options.premultiplied_alpha` must match the settings `extension_data` was built with.
+// The data is only written if every page was saved.
+bool atlasWriteExport(const QString& dir_path, const QString& name, const std::vector<QImage>& pages, const unsigned char* atlas_data, std::uint64_t atlas_data_size, const QByteArray& extension_data, const PngEncodeOptions& png_options);
+
+#endif  // SR_ATLAS_BUILDER_HPP
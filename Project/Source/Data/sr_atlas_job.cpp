@@ -0,0 +1,97 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_atlas_job.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_atlas_job.hpp"
+
+int atlasJobProgressMaximum(int num_images)
+{
+  return num_images * 2 + 1;
+}
+
+bool atlasJobRun(AtlasJob& job, const std::function<void(int)>& on_progress)
+{
+  const int num_images = job.abs_image_paths.size();
+
+  // A job that was superseded before it got the thread does not even need to stat its images.
+  if (job.isCancelled())
+  {
+    return false;
+  }
+
+  // Decode Stage
+
+  std::atomic_int num_decoded = 0;
+
+  atlasDecodeImages(job.abs_image_paths, job.num_decode_threads, job.cache, job.decoded_images, &num_decoded, [&on_progress, &num_decoded]() {
+    if (on_progress)
+    {
+      on_progress(num_decoded.load(std::memory_order_relaxed));
+    }
+  }, &job.cancel);
+
+  if (job.isCancelled())
+  {
+    return false;
+  }
+
+  if (on_progress)
+  {
+    on_progress(num_images);
+  }
+
+  // Dedup + Layout Stage
+
+  atlasLayoutImages(job.decoded_images, job.settings, job.layout);
+
+  // Composite Stage
+
+  // NOTE(SR):
+  //   The layout keeps each page within the max page size (at most 'k_MaxAtlasPageSize')
+  //   so no page ever goes over what QPainter can draw into.
+  //
+  //   Pages are handed back as QImages, the QPixmaps are made by 'Project' since
+  //   a QPixmap can not be safely created off of the GUI thread.
+
+  int num_composited = 0;
+
+  job.pages.clear();
+  job.pages.reserve(job.layout.page_sizes.size());
+
+  for (int page_index = 0; page_index < int(job.layout.page_sizes.size()); ++page_index)
+  {
+    job.pages.push_back(atlasCompositePage(job.decoded_images.images, job.settings, job.layout, page_index, [&on_progress, &num_composited, num_images]() {
+      if (on_progress)
+      {
+        on_progress(num_images + ++num_composited);
+      }
+    }, &job.cancel));
+
+    if (job.isCancelled())
+    {
+      return false;
+    }
+  }
+
+  for (int image_index = 0; image_index < num_images; ++image_index)
+  {
+    if (job.decoded_images.images[image_index].isNull())
+    {
+      job.failed_images.push_back(job.abs_image_paths[image_index]);
+    }
+  }
+
+  // The decoded images are still held by the cache (if they fit) so there is no need to keep another reference past here.
+  job.decoded_images.images = {};
+
+  if (on_progress)
+  {
+    on_progress(atlasJobProgressMaximum(num_images));
+  }
+
+  return true;
+}
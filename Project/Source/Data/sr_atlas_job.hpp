@@ -0,0 +1,61 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_atlas_job.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_ATLAS_JOB_HPP
+#define SR_ATLAS_JOB_HPP
+
+#include "Data/sr_atlas_builder.hpp"  // AtlasBuildSettings, AtlasDecodeResult, AtlasLayout
+
+#include <QImage>   // QImage
+#include <QString>  // QString
+#include <QVector>  // QVector<T>
+
+#include <atomic>      // atomic_bool
+#include <cstdint>     // uint64_t
+#include <functional>  // function<T>
+#include <vector>      // vector<T>
+
+class ImageCache;
+
+// NOTE(SR):
+//   The editor rebuilds its atlas on a worker thread so that the UI stays responsive for big libraries.
+//   A job is handed a snapshot of the library and settings when it is started and never looks at the 'Project',
+//   so edits can keep coming in while it runs. Each job has a generation and 'Project' only swaps in the
+//   result of the newest one, an older job is cancelled as soon as a newer one is started.
+
+struct AtlasJob final
+{
+  // Set before the job is started, never written after.
+
+  std::uint64_t      generation;
+  QVector<QString>   abs_image_paths;     //!< Snapshot of 'ImageLibrary::loadedImageList'.
+  AtlasBuildSettings settings;            //!<
+  int                num_decode_threads;  //!<
+  ImageCache*        cache;               //!< Optional.
+
+  // Only valid once the job has finished without being cancelled.
+
+  AtlasDecodeResult   decoded_images;  //!< The images themselves are released once composited.
+  AtlasLayout         layout;          //!<
+  std::vector<QImage> pages;           //!< Parallel to 'layout.page_sizes'.
+  QVector<QString>    failed_images;   //!< The images that could not be decoded, the layout gave each an empty rect.
+
+  std::atomic_bool cancel;  //!< Set from any thread, the job stops at the next image / frame.
+
+  bool isCancelled() const { return cancel.load(std::memory_order_relaxed); }
+};
+
+// The progress reported by 'atlasJobRun' goes up to this for `num_images`.
+int atlasJobProgressMaximum(int num_images);
+
+// Runs the decode, layout and composite stages of `job` on the calling thread,
+// `on_progress` (optional) is called from that thread with the number of steps done out of 'atlasJobProgressMaximum'.
+// Returns false if the job was cancelled, its results are then incomplete.
+bool atlasJobRun(AtlasJob& job, const std::function<void(int)>& on_progress = {});
+
+#endif  // SR_ATLAS_JOB_HPP
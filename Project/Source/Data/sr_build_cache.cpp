@@ -0,0 +1,265 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_build_cache.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_build_cache.hpp"
+
+#include <QDateTime>       // QDateTime
+#include <QDir>            // QDir
+#include <QFile>           // QFile
+#include <QFileInfo>       // QFileInfo
+#include <QStandardPaths>  // QStandardPaths
+
+#include <algorithm>  // sort
+#include <vector>     // vector<T>
+
+#if defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>  // CreateHardLinkW
+#else
+#include <unistd.h>  // link
+#endif
+
+// NOTE(SR): Bump this whenever the export output changes for the same inputs so stale entries are not used.
+static constexpr int k_BuildCacheVersion = 2;
+
+static constexpr const char* const k_BuildCacheEntryName = "atlas";
+static constexpr qint64            k_StaleEntrySeconds   = 60 * 60;
+
+static bool hardLinkOrCopyFile(const QString& src_path, const QString& dst_path)
+{
+  // The destination must be removed first, writing into it could otherwise write through a hard link back into the cache.
+  QFile::remove(dst_path);
+
+#if defined(Q_OS_WIN)
+  if (CreateHardLinkW((LPCWSTR)QDir::toNativeSeparators(dst_path).utf16(), (LPCWSTR)QDir::toNativeSeparators(src_path).utf16(), nullptr))
+  {
+    return true;
+  }
+#else
+  if (::link(QFile::encodeName(src_path).constData(), QFile::encodeName(dst_path).constData()) == 0)
+  {
+    return true;
+  }
+#endif
+
+  // Links do not work across drives (or on some file systems).
+  return QFile::copy(src_path, dst_path);
+}
+
+BuildCacheKey::BuildCacheKey(const AtlasBuildSettings& settings, int png_compression_level, const QUuid& edit_uuid) :
+  m_Hash{QCryptographicHash::Sha1}
+{
+  const qint32 header[] =
+   {
+    k_BuildCacheVersion,
+    qint32(settings.packing_mode),
+    settings.frame_size,
+    settings.atlas_width,
+    settings.max_page_size,
+    settings.padding,
+    settings.trim_frames ? 1 : 0,
+    settings.premultiplied_alpha ? 1 : 0,
+    png_compression_level,
+   };
+
+  m_Hash.addData((const char*)header, sizeof(header));
+  m_Hash.addData(edit_uuid.toRfc4122());
+}
+
+bool BuildCacheKey::addImageFile(const QString& abs_image_path)
+{
+  QFile file(abs_image_path);
+
+  if (!file.open(QFile::ReadOnly))
+  {
+    return false;
+  }
+
+  const qint64 file_size = file.size();
+
+  // The size keeps the boundaries between files unambiguous.
+  m_Hash.addData((const char*)&file_size, sizeof(file_size));
+
+  return m_Hash.addData(&file);
+}
+
+void BuildCacheKey::addAnimation(const QString& name, int num_frames)
+{
+  const QByteArray name_utf8 = name.toUtf8();
+  const qint32     header[]  = {qint32(name_utf8.size()), qint32(num_frames)};
+
+  m_Hash.addData((const char*)header, sizeof(header));
+  m_Hash.addData(name_utf8);
+}
+
+void BuildCacheKey::addFrame(int image_index, float frame_time)
+{
+  const qint32 index = image_index;
+
+  m_Hash.addData((const char*)&index, sizeof(index));
+  m_Hash.addData((const char*)&frame_time, sizeof(frame_time));
+}
+
+void BuildCacheKey::addPageImage(const QImage& image)
+{
+  const qint32 header[]  = {image.width(), image.height(), qint32(image.format())};
+  const int    row_bytes = int((qint64(image.width()) * image.depth() + 7) / 8);
+
+  m_Hash.addData((const char*)header, sizeof(header));
+
+  // Row by row since the padding at the end of each scanline is not part of the image.
+  for (int y = 0; y < image.height(); ++y)
+  {
+    m_Hash.addData((const char*)image.constScanLine(y), row_bytes);
+  }
+}
+
+void BuildCacheKey::addBytes(const void* data, qint64 size)
+{
+  m_Hash.addData((const char*)&size, sizeof(size));
+  m_Hash.addData((const char*)data, size);
+}
+
+QString BuildCacheKey::result() const
+{
+  return QString::fromLatin1(m_Hash.result().toHex());
+}
+
+QString buildCacheDefaultDir()
+{
+  // NOTE(SR): Not 'CacheLocation' since that is per application and the command line builder should share this.
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)).filePath("BluFedora/SR-Spritesheet Manager/BuildCache");
+}
+
+bool buildCacheFetch(const QString& cache_dir, const QString& key, const QString& dir_path, const QString& name)
+{
+  const QDir entry_dir = QDir(cache_dir).filePath(key);
+  const QDir root_dir  = dir_path;
+
+  const QString bytes_path = entry_dir.filePath(QString(k_BuildCacheEntryName) + ".srsm.bytes");
+
+  if (cache_dir.isEmpty() || !QFileInfo::exists(bytes_path))
+  {
+    return false;
+  }
+
+  for (int page_index = 0;; ++page_index)
+  {
+    const QString page_path = entry_dir.filePath(atlasPageFileName(k_BuildCacheEntryName, page_index));
+
+    if (!QFileInfo::exists(page_path))
+    {
+      // An entry always has at least one page.
+      if (page_index == 0)
+      {
+        return false;
+      }
+
+      break;
+    }
+
+    if (!hardLinkOrCopyFile(page_path, root_dir.filePath(atlasPageFileName(name, page_index))))
+    {
+      return false;
+    }
+  }
+
+  if (!hardLinkOrCopyFile(bytes_path, root_dir.filePath(name + ".srsm.bytes")))
+  {
+    return false;
+  }
+
+  // Touch the entry so that trimming removes the least recently used ones.
+  QFile bytes_file(bytes_path);
+
+  if (bytes_file.open(QFile::ReadWrite))
+  {
+    bytes_file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+  }
+
+  return true;
+}
+
+QString buildCacheBeginEntry(const QString& cache_dir, const QString& key)
+{
+  if (cache_dir.isEmpty())
+  {
+    return {};
+  }
+
+  // NOTE(SR): Unique per process and thread so two builds of the same project can not write into each other.
+  const QString entry_path = QDir(cache_dir).filePath(QString("%1.tmp-%2").arg(key, QUuid::createUuid().toString(QUuid::Id128)));
+
+  if (!QDir().mkpath(entry_path))
+  {
+    return {};
+  }
+
+  return entry_path;
+}
+
+bool buildCacheCommitEntry(const QString& cache_dir, const QString& key, const QString& entry_dir, int max_entries)
+{
+  QDir root_dir = cache_dir;
+
+  // If another build got here first the entries are the same so keep theirs.
+  if (root_dir.exists(key) || !root_dir.rename(entry_dir, key))
+  {
+    QDir(entry_dir).removeRecursively();
+    return root_dir.exists(key);
+  }
+
+  struct CommittedEntry final
+  {
+    QString   path;
+    QDateTime last_used;
+  };
+
+  const QDateTime             now     = QDateTime::currentDateTime();
+  std::vector<CommittedEntry> entries = {};
+
+  for (const QFileInfo& info : root_dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+  {
+    if (info.fileName().contains(".tmp-"))
+    {
+      // Leftover from a build that crashed, recent ones may still be being written to.
+      if (info.lastModified().secsTo(now) > k_StaleEntrySeconds)
+      {
+        QDir(info.absoluteFilePath()).removeRecursively();
+      }
+
+      continue;
+    }
+
+    // 'buildCacheFetch' touches the bytes file, the directory's own time is only when it was created.
+    const QFileInfo bytes_info = QDir(info.absoluteFilePath()).filePath(QString(k_BuildCacheEntryName) + ".srsm.bytes");
+
+    entries.push_back(CommittedEntry{info.absoluteFilePath(), bytes_info.exists() ? bytes_info.lastModified() : info.lastModified()});
+  }
+
+  if (max_entries > 0 && int(entries.size()) > max_entries)
+  {
+    std::sort(entries.begin(), entries.end(), [](const CommittedEntry& lhs, const CommittedEntry& rhs) {
+      return lhs.last_used > rhs.last_used;
+    });
+
+    for (std::size_t i = max_entries; i < entries.size(); ++i)
+    {
+      QDir(entries[i].path).removeRecursively();
+    }
+  }
+
+  return true;
+}
+
+QString buildCacheEntryName()
+{
+  return k_BuildCacheEntryName;
+}
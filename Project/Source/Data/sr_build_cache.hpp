@@ -0,0 +1,66 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_build_cache.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_BUILD_CACHE_HPP
+#define SR_BUILD_CACHE_HPP
+
+#include "sr_atlas_builder.hpp"  // AtlasBuildSettings
+
+#include <QCryptographicHash>  // QCryptographicHash
+#include <QString>             // QString
+#include <QUuid>               // QUuid
+
+constexpr int k_BuildCacheMaxEntries = 64;
+
+// NOTE(SR):
+//   An on disk cache of exported spritesheets keyed by a hash of everything that affects the export,
+//   each entry is a directory named after the key holding 'atlas.png' (+ 'atlas_N.png') and 'atlas.srsm.bytes'.
+//   Entries are never modified once committed so they can be hard linked out rather than copied.
+
+// Hashes the inputs of an export, they must be added in the same order each time.
+// The project name is not part of the key since it only affects the file names.
+class BuildCacheKey final
+{
+ private:
+  QCryptographicHash m_Hash;
+
+ public:
+  BuildCacheKey(const AtlasBuildSettings& settings, int png_compression_level, const QUuid& edit_uuid);
+
+  // Hashes the contents (not the path) of the file, returns false if it could not be read.
+  bool addImageFile(const QString& abs_image_path);
+  void addAnimation(const QString& name, int num_frames);
+  void addFrame(int image_index, float frame_time);
+
+  // For keying by what is written rather than by the image files, each is prefixed by its size.
+  void addPageImage(const QImage& image);
+  void addBytes(const void* data, qint64 size);
+
+  QString result() const;
+};
+
+// Where the editor and 'srsm-build' share their cache by default.
+QString buildCacheDefaultDir();
+
+// If `cache_dir` has an entry for `key` its files are hard linked (or copied if that fails) into
+// `dir_path` named after `name` the same way 'atlasWriteExport' names them.
+// Returns false on a miss or if the files could not be placed.
+bool buildCacheFetch(const QString& cache_dir, const QString& key, const QString& dir_path, const QString& name);
+
+// Creates an empty directory to write a new entry into, the files should be
+// written with a name of 'buildCacheEntryName()'. Returns an empty string on failure.
+QString buildCacheBeginEntry(const QString& cache_dir, const QString& key);
+
+// Moves the directory from 'buildCacheBeginEntry' into the cache, the least recently used entries
+// are removed if there are more than `max_entries` (0 or less means no limit). On failure the directory is removed.
+bool buildCacheCommitEntry(const QString& cache_dir, const QString& key, const QString& entry_dir, int max_entries);
+
+// The name to export an entry's files with.
+QString buildCacheEntryName();
+
+#endif  // SR_BUILD_CACHE_HPP
@@ -0,0 +1,83 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_export_extension.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_export_extension.hpp"
+
+#include <QtEndian>  // qToLittleEndian
+
+#include <utility>  // exchange
+
+static constexpr qsizetype k_ChunkHeaderSize = 8;  // uint8[4] chunk_type + uint32 chunk_data_length
+static constexpr qsizetype k_FooterSize      = 12;
+
+static void appendU32(QByteArray& data, std::uint32_t value)
+{
+  const std::uint32_t value_le = qToLittleEndian(value);
+
+  data.append(reinterpret_cast<const char*>(&value_le), sizeof(value_le));
+}
+
+ExportExtensionWriter::ExportExtensionWriter() :
+  m_Data{},
+  m_ChunkStart{-1},
+  m_NumChunks{0u}
+{
+}
+
+void ExportExtensionWriter::beginChunk(const char (&chunk_type)[5])
+{
+  flushChunk();
+
+  m_ChunkStart = m_Data.size();
+  m_Data.append(chunk_type, 4);
+  appendU32(m_Data, 0u);  // Patched by 'flushChunk'.
+  ++m_NumChunks;
+}
+
+void ExportExtensionWriter::writeU32(std::uint32_t value)
+{
+  Q_ASSERT(m_ChunkStart >= 0 && "beginChunk must be called before writing data.");
+
+  appendU32(m_Data, value);
+}
+
+void ExportExtensionWriter::writeI32(std::int32_t value)
+{
+  writeU32(std::uint32_t(value));
+}
+
+QByteArray ExportExtensionWriter::end()
+{
+  flushChunk();
+
+  if (m_NumChunks == 0u)
+  {
+    return {};
+  }
+
+  const std::uint32_t block_size = std::uint32_t(m_Data.size() + k_FooterSize);
+
+  appendU32(m_Data, m_NumChunks);
+  appendU32(m_Data, block_size);
+  m_Data.append(k_Magic, 4);
+
+  m_NumChunks = 0u;
+
+  return std::exchange(m_Data, {});
+}
+
+void ExportExtensionWriter::flushChunk()
+{
+  if (m_ChunkStart >= 0)
+  {
+    const std::uint32_t chunk_data_length = qToLittleEndian(std::uint32_t(m_Data.size() - m_ChunkStart - k_ChunkHeaderSize));
+
+    m_Data.replace(m_ChunkStart + 4, sizeof(chunk_data_length), reinterpret_cast<const char*>(&chunk_data_length), sizeof(chunk_data_length));
+    m_ChunkStart = -1;
+  }
+}
@@ -0,0 +1,47 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_export_extension.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_EXPORT_EXTENSION_HPP
+#define SR_EXPORT_EXTENSION_HPP
+
+#include <QByteArray>  // QByteArray
+
+#include <cstdint>  // uint32_t, int32_t
+
+// NOTE(SR):
+//   The '.srsm.bytes' data is written by 'SpriteAnim::SpritesheetBuilder' from the runtime library
+//   so extra per-export data is appended after it as an extension block that older readers just ignore.
+//   See "Extension Block" in 'Documentation/spritesheet_generator.md' for the layout.
+
+class ExportExtensionWriter final
+{
+ public:
+  static constexpr char k_Magic[] = "SRSX";
+
+ private:
+  QByteArray    m_Data;
+  qsizetype     m_ChunkStart;  //!< Offset of the open chunk's header, -1 when there is no open chunk.
+  std::uint32_t m_NumChunks;
+
+ public:
+  ExportExtensionWriter();
+
+  // Chunk Building, each chunk is started with `beginChunk` and the data written until the next `beginChunk` / `end`.
+
+  void beginChunk(const char (&chunk_type)[5]);
+  void writeU32(std::uint32_t value);
+  void writeI32(std::int32_t value);
+
+  // Returns the whole block, empty if no chunks were written.
+  QByteArray end();
+
+ private:
+  void flushChunk();
+};
+
+#endif  // SR_EXPORT_EXTENSION_HPP
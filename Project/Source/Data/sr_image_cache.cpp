@@ -0,0 +1,121 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_image_cache.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_image_cache.hpp"
+
+#include <QDateTime>     // QDateTime
+#include <QFileInfo>     // QFileInfo
+#include <QMutexLocker>  // QMutexLocker
+
+#include <limits>  // numeric_limits
+
+ImageCacheKey ImageCacheKey::fromFile(const QString& abs_path)
+{
+  const QFileInfo file_info(abs_path);
+
+  if (!file_info.exists())
+  {
+    return ImageCacheKey{abs_path, -1, -1};
+  }
+
+  return ImageCacheKey{
+   abs_path,
+   file_info.size(),
+   file_info.lastModified().toMSecsSinceEpoch(),
+  };
+}
+
+ImageCache::ImageCache(qint64 memory_budget) :
+  m_Lock{},
+  m_Entries{},
+  m_NumHits{0},
+  m_NumMisses{0}
+{
+  setMemoryBudget(memory_budget);
+}
+
+qint64 ImageCache::memoryBudget() const
+{
+  const QMutexLocker lock(&m_Lock);
+  return m_Entries.maxCost();
+}
+
+qint64 ImageCache::memoryUsed() const
+{
+  const QMutexLocker lock(&m_Lock);
+  return m_Entries.totalCost();
+}
+
+int ImageCache::numEntries() const
+{
+  const QMutexLocker lock(&m_Lock);
+  return int(m_Entries.count());
+}
+
+qint64 ImageCache::numHits() const
+{
+  const QMutexLocker lock(&m_Lock);
+  return m_NumHits;
+}
+
+qint64 ImageCache::numMisses() const
+{
+  const QMutexLocker lock(&m_Lock);
+  return m_NumMisses;
+}
+
+void ImageCache::setMemoryBudget(qint64 num_bytes)
+{
+  const QMutexLocker lock(&m_Lock);
+
+  // NOTE(SR): QCache evicts the least recently used items as soon as the max cost shrinks.
+  m_Entries.setMaxCost(num_bytes > 0 ? num_bytes : std::numeric_limits<qsizetype>::max());
+}
+
+bool ImageCache::find(const ImageCacheKey& key, QImage& out_image, std::size_t& out_hash)
+{
+  const QMutexLocker lock(&m_Lock);
+  const Entry* const entry = m_Entries.object(key.abs_path);
+
+  if (entry && key.file_size >= 0 && entry->file_size == key.file_size && entry->mtime == key.mtime)
+  {
+    out_image = entry->image;
+    out_hash  = entry->hash;
+    ++m_NumHits;
+    return true;
+  }
+
+  ++m_NumMisses;
+  return false;
+}
+
+void ImageCache::insert(const ImageCacheKey& key, const QImage& image, std::size_t hash)
+{
+  const QMutexLocker lock(&m_Lock);
+
+  if (image.isNull() || key.file_size < 0)
+  {
+    m_Entries.remove(key.abs_path);
+    return;
+  }
+
+  // If the image is bigger than the whole budget QCache will just drop it which is what we want.
+  m_Entries.insert(key.abs_path, new Entry{key.file_size, key.mtime, image, hash}, image.sizeInBytes());
+}
+
+void ImageCache::remove(const QString& abs_path)
+{
+  const QMutexLocker lock(&m_Lock);
+  m_Entries.remove(abs_path);
+}
+
+void ImageCache::clear()
+{
+  const QMutexLocker lock(&m_Lock);
+  m_Entries.clear();
+}
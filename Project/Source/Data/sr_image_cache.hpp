@@ -0,0 +1,73 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_image_cache.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_IMAGE_CACHE_HPP
+#define SR_IMAGE_CACHE_HPP
+
+#include <QCache>   // QCache<K, T>
+#include <QImage>   // QImage
+#include <QMutex>   // QMutex
+#include <QString>  // QString
+
+#include <cstddef>  // size_t
+
+struct ImageCacheKey final
+{
+  QString abs_path;   //!< Absolute path to the image on disk.
+  qint64  file_size;  //!< Size of the file in bytes, -1 if the file does not exist.
+  qint64  mtime;      //!< Last modification time in ms since epoch.
+
+  // Stats the file at `abs_path`.
+  static ImageCacheKey fromFile(const QString& abs_path);
+};
+
+// Decoded images keyed by path, an entry is only valid while the
+// file size and modification time on disk still match what was decoded.
+//
+// The memory budget is the sum of `QImage::sizeInBytes` for all entries,
+// the least recently used images are evicted once it is exceeded.
+//
+// Safe to use from any thread, the editor's atlas is decoded on a worker while the library can still invalidate entries.
+class ImageCache final
+{
+ private:
+  struct Entry final
+  {
+    qint64      file_size;
+    qint64      mtime;
+    QImage      image;
+    std::size_t hash;  //!< 'atlasImageHash' of the image so that it does not need to be recomputed on a hit.
+  };
+
+ private:
+  mutable QMutex         m_Lock;
+  QCache<QString, Entry> m_Entries;
+  qint64                 m_NumHits;
+  qint64                 m_NumMisses;
+
+ public:
+  static constexpr qint64 k_DefaultMemoryBudget = qint64(1024) * 1024 * 1024;
+
+ public:
+  explicit ImageCache(qint64 memory_budget = k_DefaultMemoryBudget);
+
+  qint64 memoryBudget() const;
+  qint64 memoryUsed() const;
+  int    numEntries() const;
+  qint64 numHits() const;
+  qint64 numMisses() const;
+
+  // A budget of 0 or less means unlimited.
+  void setMemoryBudget(qint64 num_bytes);
+  bool find(const ImageCacheKey& key, QImage& out_image, std::size_t& out_hash);
+  void insert(const ImageCacheKey& key, const QImage& image, std::size_t hash);
+  void remove(const QString& abs_path);
+  void clear();
+};
+
+#endif  // SR_IMAGE_CACHE_HPP
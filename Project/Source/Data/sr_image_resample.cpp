@@ -0,0 +1,502 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_image_resample.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+// References:
+//   [https://en.wikipedia.org/wiki/Lanczos_resampling]
+//   [https://entropymine.com/imageworsener/resample/]
+//
+
+#include "sr_image_resample.hpp"
+
+#include <algorithm>  // clamp, max, min
+#include <cmath>      // abs, ceil, floor, sin
+#include <cstdint>    // uint8_t, uint32_t
+#include <cstring>    // memcpy
+#include <vector>     // vector<T>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SR_RESAMPLE_X86 1
+#include <immintrin.h>  // _mm_*, _mm256_*
+#else
+#define SR_RESAMPLE_X86 0
+#endif
+
+// NOTE(SR):
+//   The SIMD functions are compiled for their instruction set on their own (rather than the whole file)
+//   so the build does not need any extra flags and the scalar path still runs on any x86 CPU.
+//   MSVC allows any intrinsic without a flag so needs no attribute.
+#if SR_RESAMPLE_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SR_RESAMPLE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SR_RESAMPLE_TARGET(isa)
+#endif
+
+#if SR_RESAMPLE_X86 && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>  // __cpuid, __cpuidex
+#endif
+
+static constexpr double k_Pi           = 3.14159265358979323846;
+static constexpr double k_LanczosLobes = 3.0;
+static constexpr int    k_AlphaChannel = Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? 3 : 0;  //!< Of the bytes of a 'QImage::Format_ARGB32_Premultiplied' pixel.
+
+namespace
+{
+  // For each output pixel along one axis, the source pixels it is a weighted sum of.
+  struct ResampleAxis final
+  {
+    int                num_taps;  //!< The same for every output pixel so the loops have a fixed trip count, unused taps have a weight of 0.
+    std::vector<int>   first;     //!< Per output pixel, the first source pixel, never decreases.
+    std::vector<float> weights;   //!< 'num_taps' per output pixel, summing to 1.
+  };
+
+  struct ResampleCpuFeatures final
+  {
+    bool has_sse41;
+    bool has_avx2;  //!< Along with FMA and the OS saving the AVX registers.
+  };
+
+  using ResampleRowFn    = void (*)(const std::uint32_t* src, const ResampleAxis& axis, int dst_width, float* dst);
+  using ResampleColumnFn = void (*)(const float* const* rows, const float* weights, int num_taps, int dst_width, std::uint32_t* dst);
+}  // namespace
+
+static double sinc(double x)
+{
+  x *= k_Pi;
+
+  return x == 0.0 ? 1.0 : std::sin(x) / x;
+}
+
+static double lanczos(double x)
+{
+  return std::abs(x) < k_LanczosLobes ? sinc(x) * sinc(x / k_LanczosLobes) : 0.0;
+}
+
+// `src_offset` / `src_length` is the region of the `src_size` axis mapped onto `dst_size` pixels.
+static ResampleAxis buildAxis(int src_size, double src_offset, double src_length, int dst_size, ResampleFilter filter)
+{
+  const double scale        = src_length / double(dst_size);
+  const double filter_scale = std::max(scale, 1.0);  //!< Widening the kernel when shrinking is what makes every source pixel count.
+  const double support      = filter == ResampleFilter::Box ? 0.5 * filter_scale : k_LanczosLobes * filter_scale;
+
+  ResampleAxis axis = {};
+  axis.num_taps     = std::min(src_size, int(std::ceil(support * 2.0)) + 1);
+  axis.first.resize(dst_size);
+  axis.weights.resize(std::size_t(dst_size) * axis.num_taps, 0.0f);
+
+  std::vector<double> weights(axis.num_taps);
+
+  for (int x = 0; x < dst_size; ++x)
+  {
+    const double center = src_offset + (x + 0.5) * scale;
+    const int    lo     = int(std::floor(center - support));
+    const int    hi     = int(std::floor(center + support));
+    const int    first  = std::clamp(lo, 0, src_size - axis.num_taps);
+    double       sum    = 0.0;
+
+    std::fill(weights.begin(), weights.end(), 0.0);
+
+    for (int i = lo; i <= hi; ++i)
+    {
+      double weight = 0.0;
+
+      if (filter == ResampleFilter::Box)
+      {
+        weight = std::max(0.0, std::min(double(i + 1), center + support) - std::max(double(i), center - support));
+      }
+      else
+      {
+        weight = lanczos((i + 0.5 - center) / filter_scale);
+      }
+
+      // Samples off of the edge repeat the edge pixel.
+      const int src_index = std::clamp(i, 0, src_size - 1) - first;
+
+      if (src_index >= 0 && src_index < axis.num_taps)
+      {
+        weights[src_index] += weight;
+        sum += weight;
+      }
+    }
+
+    axis.first[x] = first;
+
+    float* const dst_weights = axis.weights.data() + std::size_t(x) * axis.num_taps;
+
+    if (sum == 0.0)
+    {
+      dst_weights[std::clamp(int(center) - first, 0, axis.num_taps - 1)] = 1.0f;
+      continue;
+    }
+
+    for (int t = 0; t < axis.num_taps; ++t)
+    {
+      dst_weights[t] = float(weights[t] / sum);
+    }
+  }
+
+  return axis;
+}
+
+// Rounds and clamps the 4 channels of `acc` into a premultiplied pixel, no color can be above its alpha.
+static std::uint32_t packPixel(const float* acc)
+{
+  std::uint8_t channels[4];
+
+  for (int c = 0; c < 4; ++c)
+  {
+    channels[c] = std::uint8_t(int(std::clamp(acc[c], 0.0f, 255.0f) + 0.5f));
+  }
+
+  const std::uint8_t alpha = channels[k_AlphaChannel];
+
+  for (int c = 0; c < 4; ++c)
+  {
+    channels[c] = std::min(channels[c], alpha);
+  }
+
+  std::uint32_t pixel;
+  std::memcpy(&pixel, channels, sizeof(pixel));
+
+  return pixel;
+}
+
+// Scalar
+
+static void resampleRowScalar(const std::uint32_t* src, const ResampleAxis& axis, int dst_width, float* dst)
+{
+  const int num_taps = axis.num_taps;
+
+  for (int x = 0; x < dst_width; ++x)
+  {
+    const std::uint8_t* const pixels  = reinterpret_cast<const std::uint8_t*>(src + axis.first[x]);
+    const float* const        weights = axis.weights.data() + std::size_t(x) * num_taps;
+    float                     acc[4]  = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    for (int t = 0; t < num_taps; ++t)
+    {
+      for (int c = 0; c < 4; ++c)
+      {
+        acc[c] += weights[t] * float(pixels[t * 4 + c]);
+      }
+    }
+
+    for (int c = 0; c < 4; ++c)
+    {
+      dst[x * 4 + c] = acc[c];
+    }
+  }
+}
+
+static void resampleColumnScalar(const float* const* rows, const float* weights, int num_taps, int dst_width, std::uint32_t* dst)
+{
+  for (int x = 0; x < dst_width; ++x)
+  {
+    float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    for (int t = 0; t < num_taps; ++t)
+    {
+      for (int c = 0; c < 4; ++c)
+      {
+        acc[c] += weights[t] * rows[t][x * 4 + c];
+      }
+    }
+
+    dst[x] = packPixel(acc);
+  }
+}
+
+#if SR_RESAMPLE_X86
+
+// SSE4.1, a pixel is one '__m128' so the math is the same as scalar in the same order.
+
+SR_RESAMPLE_TARGET("sse4.1")
+static __m128 loadPixelSSE41(std::uint32_t pixel)
+{
+  return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(int(pixel))));
+}
+
+SR_RESAMPLE_TARGET("sse4.1")
+static std::uint32_t packPixelSSE41(__m128 acc)
+{
+  const __m128  clamped = _mm_min_ps(_mm_max_ps(acc, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+  const __m128i rounded = _mm_cvttps_epi32(_mm_add_ps(clamped, _mm_set1_ps(0.5f)));
+  const __m128i colors  = _mm_min_epi32(rounded, _mm_shuffle_epi32(rounded, _MM_SHUFFLE(3, 3, 3, 3)));
+  const __m128i packed  = _mm_packus_epi16(_mm_packus_epi32(colors, colors), _mm_setzero_si128());
+
+  return std::uint32_t(_mm_cvtsi128_si32(packed));
+}
+
+SR_RESAMPLE_TARGET("sse4.1")
+static void resampleRowSSE41(const std::uint32_t* src, const ResampleAxis& axis, int dst_width, float* dst)
+{
+  const int num_taps = axis.num_taps;
+
+  for (int x = 0; x < dst_width; ++x)
+  {
+    const std::uint32_t* const pixels  = src + axis.first[x];
+    const float* const         weights = axis.weights.data() + std::size_t(x) * num_taps;
+    __m128                     acc     = _mm_setzero_ps();
+
+    for (int t = 0; t < num_taps; ++t)
+    {
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[t]), loadPixelSSE41(pixels[t])));
+    }
+
+    _mm_storeu_ps(dst + x * 4, acc);
+  }
+}
+
+SR_RESAMPLE_TARGET("sse4.1")
+static void resampleColumnSSE41(const float* const* rows, const float* weights, int num_taps, int dst_width, std::uint32_t* dst)
+{
+  for (int x = 0; x < dst_width; ++x)
+  {
+    __m128 acc = _mm_setzero_ps();
+
+    for (int t = 0; t < num_taps; ++t)
+    {
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(rows[t] + x * 4)));
+    }
+
+    dst[x] = packPixelSSE41(acc);
+  }
+}
+
+// AVX2, two taps (horizontal) or two pixels (vertical) per '__m256' with FMA.
+
+SR_RESAMPLE_TARGET("avx2,fma")
+static void resampleRowAVX2(const std::uint32_t* src, const ResampleAxis& axis, int dst_width, float* dst)
+{
+  const int num_taps = axis.num_taps;
+
+  for (int x = 0; x < dst_width; ++x)
+  {
+    const std::uint32_t* const pixels  = src + axis.first[x];
+    const float* const         weights = axis.weights.data() + std::size_t(x) * num_taps;
+    __m256                     acc     = _mm256_setzero_ps();
+    int                        t       = 0;
+
+    for (; t + 2 <= num_taps; t += 2)
+    {
+      const __m256 two_pixels  = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + t))));
+      const __m256 two_weights = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weights[t])), _mm_set1_ps(weights[t + 1]), 1);
+
+      acc = _mm256_fmadd_ps(two_weights, two_pixels, acc);
+    }
+
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+
+    if (t < num_taps)
+    {
+      sum = _mm_fmadd_ps(_mm_set1_ps(weights[t]), _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(int(pixels[t])))), sum);
+    }
+
+    _mm_storeu_ps(dst + x * 4, sum);
+  }
+}
+
+SR_RESAMPLE_TARGET("avx2,fma")
+static void resampleColumnAVX2(const float* const* rows, const float* weights, int num_taps, int dst_width, std::uint32_t* dst)
+{
+  const __m256 zero      = _mm256_setzero_ps();
+  const __m256 max_value = _mm256_set1_ps(255.0f);
+  const __m256 half      = _mm256_set1_ps(0.5f);
+  int          x         = 0;
+
+  for (; x + 2 <= dst_width; x += 2)
+  {
+    __m256 acc = _mm256_setzero_ps();
+
+    for (int t = 0; t < num_taps; ++t)
+    {
+      acc = _mm256_fmadd_ps(_mm256_set1_ps(weights[t]), _mm256_loadu_ps(rows[t] + x * 4), acc);
+    }
+
+    const __m256i rounded = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_min_ps(_mm256_max_ps(acc, zero), max_value), half));
+    const __m256i colors  = _mm256_min_epi32(rounded, _mm256_shuffle_epi32(rounded, _MM_SHUFFLE(3, 3, 3, 3)));
+    const __m128i lo      = _mm256_castsi256_si128(colors);
+    const __m128i hi      = _mm256_extracti128_si256(colors, 1);
+    const __m128i packed  = _mm_packus_epi16(_mm_packus_epi32(lo, hi), _mm_setzero_si128());
+
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), packed);
+  }
+
+  for (; x < dst_width; ++x)
+  {
+    __m128 acc = _mm_setzero_ps();
+
+    for (int t = 0; t < num_taps; ++t)
+    {
+      acc = _mm_fmadd_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(rows[t] + x * 4), acc);
+    }
+
+    dst[x] = packPixelSSE41(acc);
+  }
+}
+
+static ResampleCpuFeatures cpuFeatures()
+{
+  ResampleCpuFeatures result = {false, false};
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  int regs[4] = {};
+
+  __cpuid(regs, 0);
+
+  const int max_leaf = regs[0];
+
+  __cpuid(regs, 1);
+
+  const bool has_fma    = (regs[2] & (1 << 12)) != 0;
+  const bool has_os_avx = (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+  result.has_sse41 = (regs[2] & (1 << 19)) != 0;
+
+  if (max_leaf >= 7 && has_fma && has_os_avx)
+  {
+    __cpuidex(regs, 7, 0);
+    result.has_avx2 = (regs[1] & (1 << 5)) != 0;
+  }
+#else
+  // NOTE(SR): These also check that the OS saves the AVX registers.
+  __builtin_cpu_init();
+
+  result.has_sse41 = __builtin_cpu_supports("sse4.1");
+  result.has_avx2  = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+
+  return result;
+}
+
+#endif  // SR_RESAMPLE_X86
+
+ResampleIsa imageResampleBestIsa()
+{
+  static const ResampleIsa s_BestIsa = []() {
+    if (imageResampleIsaIsAvailable(ResampleIsa::AVX2))
+    {
+      return ResampleIsa::AVX2;
+    }
+
+    return imageResampleIsaIsAvailable(ResampleIsa::SSE41) ? ResampleIsa::SSE41 : ResampleIsa::Scalar;
+  }();
+
+  return s_BestIsa;
+}
+
+bool imageResampleIsaIsAvailable(ResampleIsa isa)
+{
+#if SR_RESAMPLE_X86
+  static const ResampleCpuFeatures s_Features = cpuFeatures();
+
+  switch (isa)
+  {
+    case ResampleIsa::Scalar: return true;
+    case ResampleIsa::SSE41: return s_Features.has_sse41;
+    case ResampleIsa::AVX2: return s_Features.has_avx2;
+  }
+
+  return false;
+#else
+  return isa == ResampleIsa::Scalar;
+#endif
+}
+
+const char* imageResampleIsaName(ResampleIsa isa)
+{
+  switch (isa)
+  {
+    case ResampleIsa::Scalar: return "scalar";
+    case ResampleIsa::SSE41: return "sse4.1";
+    case ResampleIsa::AVX2: return "avx2";
+  }
+
+  return "unknown";
+}
+
+QImage imageResample(const QImage& image, const QRectF& source_rect, const QSize& size, ResampleFilter filter, ResampleIsa isa)
+{
+  return imageResampleRows(image, source_rect, size, 0, size.height(), filter, isa);
+}
+
+QImage imageResampleRows(const QImage& image, const QRectF& source_rect, const QSize& size, int row_begin, int row_end, ResampleFilter filter, ResampleIsa isa)
+{
+  row_begin = std::max(row_begin, 0);
+  row_end   = std::min(row_end, size.height());
+
+  if (image.isNull() || size.isEmpty() || source_rect.isEmpty() || row_begin >= row_end)
+  {
+    return QImage();
+  }
+
+  const QImage source      = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  const int    num_rows    = row_end - row_begin;
+  const bool   is_all_rows = num_rows == size.height();
+
+  // Nothing to filter, a straight copy.
+  if (source_rect == QRectF(source.rect()) && size == source.size())
+  {
+    return is_all_rows ? source : source.copy(0, row_begin, size.width(), num_rows);
+  }
+
+  ResampleRowFn    row_fn    = &resampleRowScalar;
+  ResampleColumnFn column_fn = &resampleColumnScalar;
+
+#if SR_RESAMPLE_X86
+  if (isa == ResampleIsa::AVX2 && imageResampleIsaIsAvailable(ResampleIsa::AVX2))
+  {
+    row_fn    = &resampleRowAVX2;
+    column_fn = &resampleColumnAVX2;
+  }
+  else if (isa == ResampleIsa::SSE41 && imageResampleIsaIsAvailable(ResampleIsa::SSE41))
+  {
+    row_fn    = &resampleRowSSE41;
+    column_fn = &resampleColumnSSE41;
+  }
+#else
+  (void)isa;
+#endif
+
+  const ResampleAxis axis_x = buildAxis(source.width(), source_rect.x(), source_rect.width(), size.width(), filter);
+  const ResampleAxis axis_y = buildAxis(source.height(), source_rect.y(), source_rect.height(), size.height(), filter);
+
+  QImage result(size.width(), num_rows, QImage::Format_ARGB32_Premultiplied);
+
+  if (result.isNull())
+  {
+    return result;
+  }
+
+  // Horizontal Pass, only over the source rows that some of the wanted output rows read ('first' never decreases).
+
+  const int         src_row_begin = axis_y.first[row_begin];
+  const int         src_row_end   = axis_y.first[row_end - 1] + axis_y.num_taps;
+  const std::size_t row_stride    = std::size_t(size.width()) * 4u;
+
+  std::vector<float> rows(std::size_t(src_row_end - src_row_begin) * row_stride);
+
+  for (int y = src_row_begin; y < src_row_end; ++y)
+  {
+    row_fn(reinterpret_cast<const std::uint32_t*>(source.constScanLine(y)), axis_x, size.width(), rows.data() + std::size_t(y - src_row_begin) * row_stride);
+  }
+
+  // Vertical Pass
+
+  std::vector<const float*> tap_rows(axis_y.num_taps);
+
+  for (int y = row_begin; y < row_end; ++y)
+  {
+    for (int t = 0; t < axis_y.num_taps; ++t)
+    {
+      tap_rows[t] = rows.data() + std::size_t(axis_y.first[y] + t - src_row_begin) * row_stride;
+    }
+
+    column_fn(tap_rows.data(), axis_y.weights.data() + std::size_t(y) * axis_y.num_taps, axis_y.num_taps, size.width(), reinterpret_cast<std::uint32_t*>(result.scanLine(y - row_begin)));
+  }
+
+  return result;
+}
@@ -0,0 +1,49 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_image_resample.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_IMAGE_RESAMPLE_HPP
+#define SR_IMAGE_RESAMPLE_HPP
+
+#include <QImage>  // QImage
+#include <QRectF>  // QRectF
+#include <QSize>   // QSize
+
+// NOTE(SR):
+//   'QPainter' with 'SmoothPixmapTransform' is a bilinear filter, shrinking a frame by more than 2x with it
+//   just skips source pixels and so aliases. This is a separable resampler (a horizontal then a vertical pass)
+//   whose kernel is widened by the scale factor so every source pixel contributes when shrinking.
+//   The inner loops have SSE4.1 and AVX2 versions picked at runtime, the scalar one is used everywhere else.
+
+enum class ResampleFilter
+{
+  Box,       //!< Area average, never rings but is soft on small reductions.
+  Lanczos3,  //!< Sharp without visible aliasing, can ring slightly around hard edges.
+};
+
+enum class ResampleIsa
+{
+  Scalar,
+  SSE41,
+  AVX2,  //!< Along with FMA.
+};
+
+// The fastest instruction set that both the build and this CPU support.
+ResampleIsa imageResampleBestIsa();
+bool        imageResampleIsaIsAvailable(ResampleIsa isa);
+const char* imageResampleIsaName(ResampleIsa isa);
+
+// Scales the `source_rect` region (in image space, may be fractional) of `image` to `size` with `filter`.
+// The work is done in premultiplied alpha so the color of transparent pixels never bleeds into the edges of a frame,
+// the result is 'QImage::Format_ARGB32_Premultiplied'. Samples past the edges of `image` repeat the edge pixels.
+// An unavailable `isa` falls back to 'ResampleIsa::Scalar', the SIMD paths can be off from scalar by 1 (AVX2 uses fused multiply-adds).
+QImage imageResample(const QImage& image, const QRectF& source_rect, const QSize& size, ResampleFilter filter, ResampleIsa isa = imageResampleBestIsa());
+
+// Only rows [`row_begin`, `row_end`) of 'imageResample' (the same pixels), for when just a slice of the output is drawn.
+QImage imageResampleRows(const QImage& image, const QRectF& source_rect, const QSize& size, int row_begin, int row_end, ResampleFilter filter, ResampleIsa isa = imageResampleBestIsa());
+
+#endif  // SR_IMAGE_RESAMPLE_HPP
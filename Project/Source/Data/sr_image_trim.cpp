@@ -0,0 +1,154 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_image_trim.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_image_trim.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SR_IMAGE_TRIM_USE_SSE2 1
+#include <emmintrin.h>  // _mm_*
+#else
+#define SR_IMAGE_TRIM_USE_SSE2 0
+#endif
+
+static constexpr std::uint32_t k_AlphaMask = 0xFF000000u;
+
+static const std::uint32_t* rowAt(const std::uint32_t* pixels, std::ptrdiff_t row_stride, int y)
+{
+  return reinterpret_cast<const std::uint32_t*>(reinterpret_cast<const unsigned char*>(pixels) + row_stride * y);
+}
+
+// Returns the index of the first non-transparent pixel in [begin, end), `end` if there is none.
+static int rowFirstOpaque(const std::uint32_t* row, int begin, int end)
+{
+  int x = begin;
+
+#if SR_IMAGE_TRIM_USE_SSE2
+  const __m128i alpha_mask = _mm_set1_epi32(int(k_AlphaMask));
+  const __m128i zero       = _mm_setzero_si128();
+
+  // NOTE(SR): Checks 16 pixels at a time and lets the scalar loop below find the exact pixel.
+  for (; x + 16 <= end; x += 16)
+  {
+    const __m128i p0    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 0));
+    const __m128i p1    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 4));
+    const __m128i p2    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 8));
+    const __m128i p3    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 12));
+    const __m128i any   = _mm_and_si128(_mm_or_si128(_mm_or_si128(p0, p1), _mm_or_si128(p2, p3)), alpha_mask);
+    const int     clear = _mm_movemask_epi8(_mm_cmpeq_epi32(any, zero));
+
+    if (clear != 0xFFFF)
+    {
+      break;
+    }
+  }
+#endif
+
+  for (; x < end; ++x)
+  {
+    if (row[x] & k_AlphaMask)
+    {
+      return x;
+    }
+  }
+
+  return end;
+}
+
+// Returns one past the index of the last non-transparent pixel in [begin, end), `begin` if there is none.
+static int rowLastOpaque(const std::uint32_t* row, int begin, int end)
+{
+  int x = end;
+
+#if SR_IMAGE_TRIM_USE_SSE2
+  const __m128i alpha_mask = _mm_set1_epi32(int(k_AlphaMask));
+  const __m128i zero       = _mm_setzero_si128();
+
+  for (; x - 16 >= begin; x -= 16)
+  {
+    const __m128i p0    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 16));
+    const __m128i p1    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 12));
+    const __m128i p2    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 8));
+    const __m128i p3    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 4));
+    const __m128i any   = _mm_and_si128(_mm_or_si128(_mm_or_si128(p0, p1), _mm_or_si128(p2, p3)), alpha_mask);
+    const int     clear = _mm_movemask_epi8(_mm_cmpeq_epi32(any, zero));
+
+    if (clear != 0xFFFF)
+    {
+      break;
+    }
+  }
+#endif
+
+  for (; x > begin; --x)
+  {
+    if (row[x - 1] & k_AlphaMask)
+    {
+      return x;
+    }
+  }
+
+  return begin;
+}
+
+bool imageAlphaBounds(const std::uint32_t* pixels, int width, int height, std::ptrdiff_t row_stride, AlphaBounds& out_bounds)
+{
+  out_bounds = AlphaBounds{0, 0, 0, 0};
+
+  if (!pixels || width <= 0 || height <= 0)
+  {
+    return false;
+  }
+
+  int top = 0;
+
+  while (top < height && rowFirstOpaque(rowAt(pixels, row_stride, top), 0, width) == width)
+  {
+    ++top;
+  }
+
+  if (top == height)
+  {
+    return false;
+  }
+
+  int bottom = height;
+
+  while (rowFirstOpaque(rowAt(pixels, row_stride, bottom - 1), 0, width) == width)
+  {
+    --bottom;
+  }
+
+  // Each row only needs to be scanned up to the bounds found so far so
+  // for mostly transparent images only the transparent margins are touched.
+
+  int left  = width;
+  int right = 0;
+
+  for (int y = top; y < bottom && (left > 0 || right < width); ++y)
+  {
+    const std::uint32_t* const row = rowAt(pixels, row_stride, y);
+
+    const int row_left = rowFirstOpaque(row, 0, left);
+
+    if (row_left < left)
+    {
+      left = row_left;
+    }
+
+    const int row_right = rowLastOpaque(row, right, width);
+
+    if (row_right > right)
+    {
+      right = row_right;
+    }
+  }
+
+  out_bounds = AlphaBounds{left, top, right - left, bottom - top};
+
+  return true;
+}
@@ -0,0 +1,32 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_image_trim.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_IMAGE_TRIM_HPP
+#define SR_IMAGE_TRIM_HPP
+
+#include <cstddef>  // ptrdiff_t
+#include <cstdint>  // uint32_t
+
+struct AlphaBounds final
+{
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// Finds the smallest rect containing every pixel with a non-zero alpha.
+//
+// `pixels` is a 32bpp image where the alpha is the top byte of each (native endian) pixel,
+// this matches 'QImage::Format_ARGB32' and 'QImage::Format_ARGB32_Premultiplied'.
+// `row_stride` is in bytes.
+//
+// Returns false (with an empty `out_bounds`) if the whole image is transparent.
+bool imageAlphaBounds(const std::uint32_t* pixels, int width, int height, std::ptrdiff_t row_stride, AlphaBounds& out_bounds);
+
+#endif  // SR_IMAGE_TRIM_HPP
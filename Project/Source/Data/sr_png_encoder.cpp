@@ -0,0 +1,495 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_png_encoder.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+// References:
+//   [https://www.w3.org/TR/png/]
+//   [https://github.com/madler/pigz/blob/master/pigz.c]
+//
+
+#include "sr_png_encoder.hpp"
+
+#include <QFile>        // QFile
+#include <QIODevice>    // QIODevice
+#include <QThread>      // QThread
+#include <QThreadPool>  // QThreadPool
+
+#include <zlib.h>  // deflate, adler32, adler32_combine, crc32
+
+#include <algorithm>  // clamp, min, max
+#include <cstdint>    // uint8_t, uint32_t
+#include <cstdlib>    // abs
+#include <cstring>    // memcpy
+#include <vector>     // vector<T>
+
+static constexpr int         k_MaxEncodeThreads = 64;
+static constexpr std::size_t k_DeflateWindow    = 32768;        //!< The most history a deflate stream can reference.
+static constexpr std::size_t k_TargetStripBytes = 1024 * 1024;  //!< Enough to keep the per strip overhead (dictionary + flush) negligible.
+static constexpr int         k_BytesPerPixel    = 4;
+
+namespace
+{
+  enum PngFilter : std::uint8_t
+  {
+    PngFilter_None    = 0,
+    PngFilter_Sub     = 1,
+    PngFilter_Up      = 2,
+    PngFilter_Average = 3,
+    PngFilter_Paeth   = 4,
+
+    PngFilter_Count,
+  };
+
+  // A strip's rows are [0, num_context_rows) from the bottom of 'context' then all of 'rows'.
+  // 'context' is the end of the previous band so a strip at the top of a band can still be filtered and primed.
+  struct PngRows final
+  {
+    const QImage* context;
+    const QImage* rows;
+    int           num_context_rows;
+
+    const uchar* scanLine(int y) const
+    {
+      return y < num_context_rows ? context->constScanLine(context->height() - num_context_rows + y) : rows->constScanLine(y - num_context_rows);
+    }
+  };
+
+  struct PngStrip final
+  {
+    int                       row_begin;
+    int                       row_end;
+    std::vector<std::uint8_t> compressed;
+    uLong                     adler;
+    uLong                     num_filtered_bytes;
+    bool                      is_successful;
+  };
+}  // namespace
+
+static std::uint8_t paethPredictor(int a, int b, int c)
+{
+  const int p  = a + b - c;
+  const int pa = std::abs(p - a);
+  const int pb = std::abs(p - b);
+  const int pc = std::abs(p - c);
+
+  if (pa <= pb && pa <= pc)
+  {
+    return std::uint8_t(a);
+  }
+
+  return std::uint8_t(pb <= pc ? b : c);
+}
+
+// 'QImage::Format_ARGB32' (and the premultiplied one) is a native endian 0xAARRGGBB, png wants the bytes in RGBA order.
+static void convertRowToRGBA(const uchar* src_row, int width, std::uint8_t* dst_row)
+{
+  const std::uint32_t* const src_pixels = reinterpret_cast<const std::uint32_t*>(src_row);
+
+  for (int x = 0; x < width; ++x)
+  {
+    const std::uint32_t pixel = src_pixels[x];
+
+    dst_row[x * 4 + 0] = std::uint8_t(pixel >> 16);
+    dst_row[x * 4 + 1] = std::uint8_t(pixel >> 8);
+    dst_row[x * 4 + 2] = std::uint8_t(pixel >> 0);
+    dst_row[x * 4 + 3] = std::uint8_t(pixel >> 24);
+  }
+}
+
+// NOTE(SR): Each filter gets its own loop (rather than a switch per byte) so the compiler can vectorize the simple ones.
+static void applyFilter(PngFilter filter, const std::uint8_t* row, const std::uint8_t* prev_row, std::size_t row_size, std::uint8_t* dst)
+{
+  // The first pixel has nothing to its left (a = c = 0).
+  const std::size_t first_pixel = std::min(row_size, std::size_t(k_BytesPerPixel));
+
+  switch (filter)
+  {
+    case PngFilter_None:
+    {
+      std::memcpy(dst, row, row_size);
+      break;
+    }
+    case PngFilter_Sub:
+    {
+      std::memcpy(dst, row, first_pixel);
+
+      for (std::size_t i = first_pixel; i < row_size; ++i)
+      {
+        dst[i] = std::uint8_t(row[i] - row[i - k_BytesPerPixel]);
+      }
+      break;
+    }
+    case PngFilter_Up:
+    {
+      for (std::size_t i = 0; i < row_size; ++i)
+      {
+        dst[i] = std::uint8_t(row[i] - prev_row[i]);
+      }
+      break;
+    }
+    case PngFilter_Average:
+    {
+      for (std::size_t i = 0; i < first_pixel; ++i)
+      {
+        dst[i] = std::uint8_t(row[i] - prev_row[i] / 2);
+      }
+
+      for (std::size_t i = first_pixel; i < row_size; ++i)
+      {
+        dst[i] = std::uint8_t(row[i] - (row[i - k_BytesPerPixel] + prev_row[i]) / 2);
+      }
+      break;
+    }
+    case PngFilter_Paeth:
+    {
+      // paeth(0, b, 0) is always b.
+      for (std::size_t i = 0; i < first_pixel; ++i)
+      {
+        dst[i] = std::uint8_t(row[i] - prev_row[i]);
+      }
+
+      for (std::size_t i = first_pixel; i < row_size; ++i)
+      {
+        dst[i] = std::uint8_t(row[i] - paethPredictor(row[i - k_BytesPerPixel], prev_row[i], prev_row[i - k_BytesPerPixel]));
+      }
+      break;
+    }
+    case PngFilter_Count:
+    {
+      break;
+    }
+  }
+}
+
+static std::uint64_t filterCost(const std::uint8_t* filtered, std::size_t row_size)
+{
+  std::uint64_t cost = 0u;
+
+  // The "minimum sum of absolute differences" heuristic from the png spec (and libpng).
+  for (std::size_t i = 0; i < row_size; ++i)
+  {
+    cost += std::abs(int(std::int8_t(filtered[i])));
+  }
+
+  return cost;
+}
+
+// Writes the filter type byte followed by the filtered row to `dst`, `scratch` needs to be 'row_size' bytes.
+// The choice only depends on `row` and `prev_row` so re-filtering a row always gives the same bytes.
+static void filterRow(int compression_level, const std::uint8_t* row, const std::uint8_t* prev_row, std::size_t row_size, std::uint8_t* dst, std::uint8_t* scratch)
+{
+  if (compression_level == 0)
+  {
+    // Nothing would be compressed anyway.
+    dst[0] = PngFilter_None;
+    std::memcpy(dst + 1, row, row_size);
+    return;
+  }
+
+  std::uint64_t best_cost = ~std::uint64_t(0u);
+
+  for (int filter = PngFilter_None; filter < PngFilter_Count; ++filter)
+  {
+    applyFilter(PngFilter(filter), row, prev_row, row_size, scratch);
+
+    const std::uint64_t cost = filterCost(scratch, row_size);
+
+    if (cost < best_cost)
+    {
+      best_cost = cost;
+      dst[0]    = std::uint8_t(filter);
+      std::memcpy(dst + 1, scratch, row_size);
+    }
+  }
+}
+
+// `strip`'s rows index into `rows`, only the rows up to 32KiB before the strip are read.
+static void encodeStrip(const PngRows& rows, int width, int compression_level, bool is_last_strip, PngStrip& strip)
+{
+  const std::size_t row_size      = std::size_t(width) * k_BytesPerPixel;
+  const std::size_t filtered_size = row_size + 1u;
+  const int         num_dict_rows = std::min(strip.row_begin, int((k_DeflateWindow + filtered_size - 1) / filtered_size));
+  const int         first_row     = strip.row_begin - num_dict_rows;
+  const std::size_t num_rows      = std::size_t(strip.row_end - first_row);
+  const std::size_t data_offset   = std::size_t(num_dict_rows) * filtered_size;
+  const std::size_t dict_size     = std::min(data_offset, k_DeflateWindow);
+  const std::size_t dict_offset   = data_offset - dict_size;
+
+  std::vector<std::uint8_t> filtered(num_rows * filtered_size);
+  std::vector<std::uint8_t> rgba_rows[2] = {std::vector<std::uint8_t>(row_size, 0u), std::vector<std::uint8_t>(row_size, 0u)};
+  std::vector<std::uint8_t> scratch(row_size);
+
+  // The row above the first one filtered, rows above the image are all zero.
+  if (first_row > 0)
+  {
+    convertRowToRGBA(rows.scanLine(first_row - 1), width, rgba_rows[1].data());
+  }
+
+  // Rows before the strip are re-filtered (rather than shared with the strip above) to prime the deflate window.
+  for (int y = first_row; y < strip.row_end; ++y)
+  {
+    std::vector<std::uint8_t>& row      = rgba_rows[(y - first_row) & 1];
+    std::vector<std::uint8_t>& prev_row = rgba_rows[(y - first_row + 1) & 1];
+
+    convertRowToRGBA(rows.scanLine(y), width, row.data());
+    filterRow(compression_level, row.data(), prev_row.data(), row_size, filtered.data() + std::size_t(y - first_row) * filtered_size, scratch.data());
+  }
+
+  strip.num_filtered_bytes = uLong(filtered.size() - data_offset);
+  strip.adler              = adler32(adler32(0L, Z_NULL, 0), filtered.data() + data_offset, uInt(strip.num_filtered_bytes));
+
+  z_stream stream = {};
+
+  // Negative window bits gives a raw deflate stream, the zlib header + trailer are written once for the whole image.
+  if (deflateInit2(&stream, compression_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+  {
+    strip.is_successful = false;
+    return;
+  }
+
+  if (dict_size != 0u)
+  {
+    deflateSetDictionary(&stream, filtered.data() + dict_offset, uInt(dict_size));
+  }
+
+  // A sync flush can add a few bytes on top of the bound (an empty stored block).
+  strip.compressed.resize(deflateBound(&stream, strip.num_filtered_bytes) + 16u);
+
+  stream.next_in   = filtered.data() + data_offset;
+  stream.avail_in  = uInt(strip.num_filtered_bytes);
+  stream.next_out  = strip.compressed.data();
+  stream.avail_out = uInt(strip.compressed.size());
+
+  // The last strip ends the stream, every other one must end on a byte boundary without marking the final block.
+  const int flush_mode = is_last_strip ? Z_FINISH : Z_SYNC_FLUSH;
+  int       status     = deflate(&stream, flush_mode);
+
+  // Only happens if the bound was not enough, deflate then needs to be called again with more room.
+  while ((status == Z_OK || status == Z_BUF_ERROR) && stream.avail_out == 0u)
+  {
+    const std::size_t num_written = strip.compressed.size() - stream.avail_out;
+
+    strip.compressed.resize(strip.compressed.size() * 2u);
+    stream.next_out  = strip.compressed.data() + num_written;
+    stream.avail_out = uInt(strip.compressed.size() - num_written);
+    status           = deflate(&stream, flush_mode);
+  }
+
+  strip.is_successful = is_last_strip ? status == Z_STREAM_END : (status == Z_OK && stream.avail_in == 0u && stream.avail_out != 0u);
+  strip.compressed.resize(strip.compressed.size() - stream.avail_out);
+
+  deflateEnd(&stream);
+}
+
+static void writeU32BE(QByteArray& dst, std::uint32_t value)
+{
+  const char bytes[] =
+   {
+    char(value >> 24),
+    char(value >> 16),
+    char(value >> 8),
+    char(value >> 0),
+   };
+
+  dst.append(bytes, sizeof(bytes));
+}
+
+static bool writeChunk(QIODevice& out, const char (&chunk_type)[5], const std::uint8_t* data, std::size_t data_size)
+{
+  QByteArray header = {};
+  writeU32BE(header, std::uint32_t(data_size));
+  header.append(chunk_type, 4);
+
+  uLong crc = crc32(0L, Z_NULL, 0);
+  crc       = crc32(crc, reinterpret_cast<const Bytef*>(chunk_type), 4);
+
+  // NOTE(SR): Must be skipped for no data, 'crc32' with a null buffer returns the initial value instead.
+  if (data_size != 0u)
+  {
+    crc = crc32(crc, data, uInt(data_size));
+  }
+
+  QByteArray footer = {};
+  writeU32BE(footer, std::uint32_t(crc));
+
+  return out.write(header) == header.size() &&
+         (data_size == 0u || out.write(reinterpret_cast<const char*>(data), qint64(data_size)) == qint64(data_size)) &&
+         out.write(footer) == footer.size();
+}
+
+// The rows of a strip, kept to about 'k_TargetStripBytes' of filtered data.
+static int pngRowsPerStrip(int width)
+{
+  return std::max(1, int(k_TargetStripBytes / (std::size_t(width) * k_BytesPerPixel + 1u)));
+}
+
+// Rows before a strip needed for its filter + dictionary, see 'encodeStrip'.
+static int pngNumContextRows(int width)
+{
+  const std::size_t filtered_size = std::size_t(width) * k_BytesPerPixel + 1u;
+
+  return int((k_DeflateWindow + filtered_size - 1) / filtered_size) + 1;
+}
+
+PngStreamEncoder::PngStreamEncoder(QIODevice& out, const QSize& size, const PngEncodeOptions& options) :
+  m_Out{out},
+  m_Size{size},
+  m_CompressionLevel{std::clamp(options.compression_level, 0, 9)},
+  m_NumThreads{std::clamp(options.num_threads <= 0 ? QThread::idealThreadCount() : options.num_threads, 1, k_MaxEncodeThreads)},
+  m_RowsPerStrip{pngRowsPerStrip(size.width())},
+  m_NumRowsWritten{0},
+  m_RowFormat{options.premultiplied_alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_ARGB32},
+  m_Adler{adler32(0L, Z_NULL, 0)},
+  m_Context{},
+  m_IsSuccessful{!size.isEmpty()}
+{
+  static const std::uint8_t k_Signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+  if (!m_IsSuccessful)
+  {
+    return;
+  }
+
+  QByteArray ihdr = {};
+  writeU32BE(ihdr, std::uint32_t(size.width()));
+  writeU32BE(ihdr, std::uint32_t(size.height()));
+  ihdr.append(char(8));  // Bit Depth
+  ihdr.append(char(6));  // Color Type: RGBA
+  ihdr.append(char(0));  // Compression Method: Deflate
+  ihdr.append(char(0));  // Filter Method: Adaptive
+  ihdr.append(char(0));  // Interlace Method: None
+
+  // The zlib header, 32KiB window with the level hint. [https://www.rfc-editor.org/rfc/rfc1950]
+  const int          level_hint  = m_CompressionLevel < 2 ? 0 : m_CompressionLevel < 6 ? 1 : m_CompressionLevel == 6 ? 2 : 3;
+  const std::uint8_t cmf         = 0x78;
+  const std::uint8_t flg_no_chk  = std::uint8_t(level_hint << 6);
+  const std::uint8_t zlib_head[] = {cmf, std::uint8_t(flg_no_chk + (31 - (cmf * 256 + flg_no_chk) % 31))};
+
+  m_IsSuccessful = m_Out.write(reinterpret_cast<const char*>(k_Signature), sizeof(k_Signature)) == sizeof(k_Signature) &&
+                   writeChunk(m_Out, "IHDR", reinterpret_cast<const std::uint8_t*>(ihdr.constData()), ihdr.size()) &&
+                   writeChunk(m_Out, "IDAT", zlib_head, sizeof(zlib_head));
+}
+
+int PngStreamEncoder::rowsPerBand() const
+{
+  return m_RowsPerStrip * m_NumThreads;
+}
+
+bool PngStreamEncoder::writeRows(const QImage& rows)
+{
+  if (!m_IsSuccessful || rows.isNull() || rows.width() != m_Size.width() || m_NumRowsWritten + rows.height() > m_Size.height())
+  {
+    m_IsSuccessful = false;
+    return false;
+  }
+
+  const QImage  source      = rows.format() == m_RowFormat ? rows : rows.convertToFormat(m_RowFormat);
+  const int     width       = source.width();
+  const int     height      = source.height();
+  const PngRows strip_rows  = {&m_Context, &source, m_Context.height()};
+  const int     num_strips  = (height + m_RowsPerStrip - 1) / m_RowsPerStrip;
+  const int     num_threads = std::min(m_NumThreads, num_strips);
+  const bool    is_last     = m_NumRowsWritten + height == m_Size.height();
+
+  std::vector<PngStrip> strips(num_strips);
+
+  for (int i = 0; i < num_strips; ++i)
+  {
+    strips[i].row_begin     = strip_rows.num_context_rows + i * m_RowsPerStrip;
+    strips[i].row_end       = strip_rows.num_context_rows + std::min(height, (i + 1) * m_RowsPerStrip);
+    strips[i].is_successful = false;
+  }
+
+  const auto encode_strip = [this, &strip_rows, &strips, width, num_strips, is_last](int i) {
+    encodeStrip(strip_rows, width, m_CompressionLevel, is_last && i == num_strips - 1, strips[i]);
+  };
+
+  if (num_threads == 1)
+  {
+    for (int i = 0; i < num_strips; ++i)
+    {
+      encode_strip(i);
+    }
+  }
+  else
+  {
+    // NOTE(SR): A private pool for the same reasons as 'atlasDecodeImages'.
+    QThreadPool pool;
+    pool.setMaxThreadCount(num_threads);
+
+    for (int i = 0; i < num_strips; ++i)
+    {
+      pool.start([&encode_strip, i]() { encode_strip(i); });
+    }
+
+    pool.waitForDone();
+  }
+
+  // Any number of consecutive IDAT chunks make up the one zlib stream so each strip gets its own.
+  for (std::size_t i = 0; m_IsSuccessful && i < strips.size(); ++i)
+  {
+    const PngStrip& strip = strips[i];
+
+    m_IsSuccessful = strip.is_successful && writeChunk(m_Out, "IDAT", strip.compressed.data(), strip.compressed.size());
+    m_Adler        = adler32_combine(m_Adler, strip.adler, z_off_t(strip.num_filtered_bytes));
+  }
+
+  // Only the last few rows are kept for the next band, not the band itself.
+  const int num_context_rows = std::min(pngNumContextRows(width), strip_rows.num_context_rows + height);
+  QImage    context          = QImage(width, num_context_rows, m_RowFormat);
+
+  for (int y = 0; y < num_context_rows; ++y)
+  {
+    std::memcpy(context.scanLine(y), strip_rows.scanLine(strip_rows.num_context_rows + height - num_context_rows + y), std::size_t(width) * k_BytesPerPixel);
+  }
+
+  m_Context = std::move(context);
+  m_NumRowsWritten += height;
+
+  return m_IsSuccessful;
+}
+
+bool PngStreamEncoder::finish()
+{
+  if (!m_IsSuccessful || m_NumRowsWritten != m_Size.height())
+  {
+    m_IsSuccessful = false;
+    return false;
+  }
+
+  QByteArray zlib_tail = {};
+  writeU32BE(zlib_tail, std::uint32_t(m_Adler));
+
+  m_IsSuccessful = writeChunk(m_Out, "IDAT", reinterpret_cast<const std::uint8_t*>(zlib_tail.constData()), zlib_tail.size()) &&
+                   writeChunk(m_Out, "IEND", nullptr, 0u);
+
+  return m_IsSuccessful;
+}
+
+bool pngEncode(const QImage& image, const PngEncodeOptions& options, QIODevice& out)
+{
+  if (image.isNull())
+  {
+    return false;
+  }
+
+  // The whole image as a single band, the strips come out the same as streaming it in bands of 'rowsPerBand'.
+  PngStreamEncoder encoder(out, image.size(), options);
+
+  return encoder.writeRows(image) && encoder.finish();
+}
+
+bool pngWriteFile(const QImage& image, const QString& file_path, const PngEncodeOptions& options)
+{
+  QFile file(file_path);
+
+  if (!file.open(QFile::WriteOnly | QFile::Truncate))
+  {
+    return false;
+  }
+
+  return pngEncode(image, options, file);
+}
@@ -0,0 +1,71 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_png_encoder.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_PNG_ENCODER_HPP
+#define SR_PNG_ENCODER_HPP
+
+#include <QImage>   // QImage
+#include <QSize>    // QSize
+#include <QString>  // QString
+
+class QIODevice;
+
+// NOTE(SR):
+//   'QImage::save' deflates the whole image on one thread which is most of the export time for big atlases.
+//   This splits the image into horizontal strips that are filtered + deflated in parallel (the way pigz does it),
+//   each strip is primed with the 32KiB before it so the ratio is close to a single stream and is flushed
+//   to a byte boundary so the strips can be joined back into one valid zlib stream ('adler32_combine' for the checksum).
+
+constexpr int k_PngDefaultCompressionLevel = 6;  //!< What zlib (and so 'QImage::save') uses by default.
+
+struct PngEncodeOptions final
+{
+  int  compression_level;    //!< 0 (store) to 9 (smallest), the same as zlib's.
+  int  num_threads;          //!< 0 or less uses one per core.
+  bool premultiplied_alpha;  //!< Write the color channels premultiplied by alpha rather than straight.
+};
+
+// Writes a png a band of rows at a time so that the whole image never has to be in memory,
+// the output is byte for byte the same as 'pngEncode' of the whole image when each band is a multiple of 'rowsPerBand'.
+class PngStreamEncoder final
+{
+ private:
+  QIODevice&     m_Out;
+  QSize          m_Size;
+  int            m_CompressionLevel;
+  int            m_NumThreads;
+  int            m_RowsPerStrip;
+  int            m_NumRowsWritten;
+  QImage::Format m_RowFormat;     //!< What each band is converted to before it is filtered, either of the ARGB32 formats.
+  unsigned long  m_Adler;         //!< zlib's 'uLong', of every filtered row written so far.
+  QImage         m_Context;       //!< The last rows written, what the first strip of the next band is filtered against.
+  bool           m_IsSuccessful;  //!< Sticky, once anything fails the rest of the calls do nothing.
+
+ public:
+  // Writes the png header right away.
+  PngStreamEncoder(QIODevice& out, const QSize& size, const PngEncodeOptions& options);
+
+  // A band this tall (or the rest of the image) keeps every thread busy.
+  int rowsPerBand() const;
+
+  // Appends `rows` below the last band, it must be as wide as the image and not go past the bottom of it.
+  bool writeRows(const QImage& rows);
+
+  // Ends the png, false if every row was not written or anything before failed.
+  bool finish();
+};
+
+// Writes `image` as an 8-bit RGBA png, any other format is converted to 'QImage::Format_ARGB32' first
+// (or 'QImage::Format_ARGB32_Premultiplied' with 'PngEncodeOptions::premultiplied_alpha').
+// Returns false if the image is null or writing to `out` failed.
+bool pngEncode(const QImage& image, const PngEncodeOptions& options, QIODevice& out);
+
+// Same as 'pngEncode' but into a (truncated) file.
+bool pngWriteFile(const QImage& image, const QString& file_path, const PngEncodeOptions& options);
+
+#endif  // SR_PNG_ENCODER_HPP
@@ -8,20 +8,28 @@
 
 #include "sr_project.hpp"
 
+#include "Data/sr_atlas_builder.hpp"         // atlasDecodeImages, atlasCompositeFrame
+#include "Data/sr_atlas_job.hpp"             // AtlasJob, atlasJobRun
+#include "Data/sr_build_cache.hpp"           // BuildCacheKey, buildCacheFetch
+#include "Data/sr_project_binary.hpp"        // ProjectBinaryFile, projectBinaryFromJson
 #include "Data/sr_settings.hpp"              // Settings
 #include "Server/sr_live_reload_server.hpp"  // g_Server
 #include "UI/sr_image_library.hpp"           // ImageLibrary
 #include "sr_main_window.hpp"
 
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFileDialog>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QMessageBox>
-#include <QProgressDialog>
 
-#include <cmath>  // ceil
+#include <algorithm>  // clamp, count
+#include <memory>     // make_shared
+
+// How often a running atlas job posts its progress back to the GUI thread.
+static constexpr qint64 k_AtlasProgressIntervalMs = 50;
 
 Project::Project(MainWindow* main_window, const QString& name) :
   m_Name{name},
@@ -29,17 +37,41 @@ Project::Project(MainWindow* main_window, const QString& name) :
   m_ProjectFile{nullptr},
   m_ImageLibrary{nullptr},
   m_HistoryStack{new QUndoStack(main_window)},
+  m_HistorySpillFile{},
+  m_HistoryBudget{qint64(Settings::undoHistoryBudgetMB()) * 1024 * 1024},
   m_AnimationList{},
   m_UI{*main_window},
   m_Export{},
   m_SelectedAnimation{-1},
   m_SpriteSheetImageSize{2048},
   m_SpriteSheetFrameSize{256},
+  m_AtlasPackingMode{AtlasPackingMode::Grid},
+  m_MaxPageSize{8192},
+  m_TrimTransparentBorders{false},
+  m_PremultipliedAlpha{false},
   m_AtlasModified{false},
-  m_IsRegeneratingAtlas{false}
+  m_AtlasJob{nullptr},
+  m_AtlasGeneration{0u},
+  m_AtlasJobPool{},
+  m_IsBinaryFile{false}
 {
-  m_Export.atlas_data      = std::make_unique<unsigned char[]>(0);
-  m_Export.atlas_data_size = 0u;
+  m_Export.atlas_data         = std::make_unique<unsigned char[]>(0);
+  m_Export.atlas_data_size    = 0u;
+  m_Export.decode_time_ms     = 0;
+  m_Export.decode_num_threads = 0;
+  m_Export.decode_cache_hits  = 0;
+
+  m_AtlasJobPool.setMaxThreadCount(1);
+}
+
+Project::~Project()
+{
+  if (m_AtlasJob)
+  {
+    m_AtlasJob->cancel.store(true, std::memory_order_relaxed);
+  }
+
+  m_AtlasJobPool.waitForDone();
 }
 
 void Project::newAnimation(const QString& name, int frame_rate)
@@ -104,7 +136,7 @@ void Project::removeAnimation(QModelIndex index)
 
 void Project::importImageUrls(const QList<QUrl>& urls)
 {
-  recordAction(tr("Import Dragged Images"), UndoActionFlag_ModifiedAtlas, [this, &urls]() {
+  recordAction(tr("Import Dragged Images"), UndoActionFlag_ModifiedLibrary | UndoActionFlag_ModifiedAtlas, [this, &urls]() {
     m_ImageLibrary->addUrls(urls);
   });
 }
@@ -122,7 +154,7 @@ void Project::setAnimationName(Animation* anim, const QString& new_name)
       }
     }
 
-    recordAction(tr("Renamed Animation"), UndoActionFlag_ModifiedAnimation, [anim, &new_name]() {
+    recordAnimationAction(tr("Renamed Animation"), anim, [anim, &new_name]() {
       anim->setName(new_name);
     });
   }
@@ -155,12 +187,80 @@ void Project::onUndoRedoIndexChanged(int idx)
   regenerateAtlasExport();
 }
 
+void Project::handleHistoryReadFailure(const QString& action_name)
+{
+  qWarning() << "Failed to read back the undo history of" << action_name << "so it can not be restored.";
+
+  // The stack has already moved its index past the action, the history can not be trusted after that so all of it is dropped.
+  // Queued since this is called from inside the stack's undo / redo.
+  QMetaObject::invokeMethod(
+   this, [this, action_name]() {
+     m_HistoryStack->clear();
+     m_HistorySpillFile.clear();
+
+     // Clearing marks the stack clean but the document was not saved.
+     m_UI.setWindowModified(true);
+
+     QMessageBox::warning(&m_UI, tr("Undo History"), tr("The undo history of \"%1\" could not be read back so the undo history was cleared, the project itself is unchanged.").arg(action_name));
+   },
+   Qt::QueuedConnection);
+}
+
+void Project::trimHistory()
+{
+  // Actions this close to the current index are the likeliest to be undone / redone next so are left as is.
+  static constexpr int k_NumUncompressedActions = 8;
+
+  if (m_HistoryBudget <= 0)
+  {
+    return;
+  }
+
+  const int num_actions = m_HistoryStack->count();
+  const int index       = m_HistoryStack->index();
+
+  // 'QUndoStack' only hands out const commands but every one of them was pushed by 'recordActionImpl'.
+  const auto action_at = [this](int i) { return static_cast<UndoAction*>(const_cast<QUndoCommand*>(m_HistoryStack->command(i))); };
+  const auto is_cold   = [index](int i) { return (i < index ? index - 1 - i : i - index) >= k_NumUncompressedActions; };
+
+  for (int i = 0; i < num_actions; ++i)
+  {
+    if (is_cold(i))
+    {
+      action_at(i)->state().compress();
+    }
+  }
+
+  qint64 memory_used = qint64(historyMemoryUsage());
+
+  for (int i = 0; i < num_actions && memory_used > m_HistoryBudget; ++i)
+  {
+    UndoAction* const action      = action_at(i);
+    const qint64      memory_held = qint64(action->memoryUsage());
+
+    if (is_cold(i) && action->state().spill(m_HistorySpillFile))
+    {
+      memory_used += qint64(action->memoryUsage()) - memory_held;
+    }
+  }
+}
+
 void Project::handleImageLibraryChange()
 {
   markAtlasModifed();
   regenerateAtlasExport();
 }
 
+void Project::handleImageFilesChanged()
+{
+  const QVector<QString> changed_images = m_ImageLibrary->takeChangedImages();
+
+  if (!repaintAtlasImages(changed_images))
+  {
+    handleImageLibraryChange();
+  }
+}
+
 void Project::onTimelineFpsChange(int value)
 {
   Animation* const animation = animationAt(m_SelectedAnimation);
@@ -177,7 +277,7 @@ void Project::onTimelineFpsChange(int value)
 
 void Project::onCreateNewFolder()
 {
-  recordAction(tr("Created New Folder"), UndoActionFlag_ModifiedSettings, [this]() {
+  recordAction(tr("Created New Folder"), UndoActionFlag_ModifiedLibrary, [this]() {
     m_ImageLibrary->addNewFolder();
   });
 }
@@ -188,7 +288,7 @@ void Project::onImportImages()
 
   if (!files.isEmpty())
   {
-    recordAction("Import Images", UndoActionFlag_ModifiedAtlas, [this, &files]() {
+    recordAction("Import Images", UndoActionFlag_ModifiedLibrary | UndoActionFlag_ModifiedAtlas, [this, &files]() {
       m_ImageLibrary->addDirectory(files);
     });
   }
@@ -200,7 +300,7 @@ void Project::setSpritesheetImageSize(int value)
   {
     recordAction(
      tr("Image Quality Set To %1 px").arg(value),
-     UndoActionFlag_ModifiedAtlas,
+     UndoActionFlag_ModifiedSettings | UndoActionFlag_ModifiedAtlas,
      [this, value]() {
        m_SpriteSheetImageSize = value;
      });
@@ -213,13 +313,73 @@ void Project::setSpritesheetFrameSize(int value)
   {
     recordAction(
      tr("Frame Quality Set To %1").arg(value),
-     UndoActionFlag_ModifiedAtlas,
+     UndoActionFlag_ModifiedSettings | UndoActionFlag_ModifiedAtlas,
      [this, value]() {
        m_SpriteSheetFrameSize = value;
      });
   }
 }
 
+void Project::setAtlasPackingMode(int value)
+{
+  const AtlasPackingMode mode = atlasPackingModeFromInt(value);
+
+  if (m_AtlasPackingMode != mode)
+  {
+    recordAction(
+     tr("Packing Mode Set To %1").arg(atlasPackingModeName(mode)),
+     UndoActionFlag_ModifiedSettings | UndoActionFlag_ModifiedAtlas,
+     [this, mode]() {
+       m_AtlasPackingMode = mode;
+     });
+  }
+}
+
+void Project::setMaxPageSize(int value)
+{
+  value = std::clamp(value, 1, k_MaxAtlasPageSize);
+
+  if (m_MaxPageSize != unsigned(value))
+  {
+    recordAction(
+     tr("Max Page Size Set To %1 px").arg(value),
+     UndoActionFlag_ModifiedSettings | UndoActionFlag_ModifiedAtlas,
+     [this, value]() {
+       m_MaxPageSize = value;
+     });
+  }
+}
+
+void Project::setTrimTransparentBorders(bool value)
+{
+  if (m_TrimTransparentBorders != value)
+  {
+    recordAction(
+     value ? tr("Enabled Frame Trimming") : tr("Disabled Frame Trimming"),
+     UndoActionFlag_ModifiedSettings | UndoActionFlag_ModifiedAtlas,
+     [this, value]() {
+       m_TrimTransparentBorders = value;
+     });
+  }
+}
+
+void Project::setPremultipliedAlpha(bool value)
+{
+  if (m_PremultipliedAlpha != value)
+  {
+    recordAction(
+     value ? tr("Enabled Premultiplied Alpha") : tr("Disabled Premultiplied Alpha"),
+     UndoActionFlag_ModifiedSettings,
+     [this, value]() {
+       m_PremultipliedAlpha = value;
+
+       // The pages do not change, only the "ALPH" chunk of the spritesheet data.
+       m_UI.setWindowModified(true);
+       regenerateAnimationExport();
+     });
+  }
+}
+
 void Project::setProjectName(const QString& value)
 {
   if (value != m_Name)
@@ -259,28 +419,53 @@ void Project::setup(ImageLibrary* img_library)
   m_ImageLibrary->m_Project = this;
 
   QObject::connect(img_library, &ImageLibrary::signalImagesAdded, this, &Project::handleImageLibraryChange);
-  QObject::connect(img_library, &ImageLibrary::signalImagesChanged, this, &Project::handleImageLibraryChange);
+  QObject::connect(img_library, &ImageLibrary::signalImagesChanged, this, &Project::handleImageFilesChanged);
   QObject::connect(m_HistoryStack, &QUndoStack::indexChanged, this, &Project::onUndoRedoIndexChanged);
+  QObject::connect(m_HistoryStack, &QUndoStack::indexChanged, this, &Project::trimHistory);
 }
 
 bool Project::exportAtlas(const QString& dir_path)
 {
-  QDir    root_dir      = dir_path;
-  QString image_path    = root_dir.filePath(m_Name + ".png");
-  QString bytes_path    = root_dir.filePath(m_Name + ".srsm.bytes");
-  QFile   bytes_file    = bytes_path;
-  bool    is_successful = m_Export.image.save(image_path, "PNG", -1);
+  // The export must match what the user is looking at so any pending edit is built first.
+  waitForAtlasExport();
 
-  // Only write out bytes if we were able to save the png.
-  is_successful = is_successful && bytes_file.open(QFile::WriteOnly);
+  const PngEncodeOptions png_options = {Settings::pngCompressionLevel(), Settings::encodeThreadCount(), m_Export.settings.premultiplied_alpha};
+  const QString          cache_dir   = Settings::buildCacheDir();
+  const QString          cache_key   = cache_dir.isEmpty() ? QString() : atlasBuildCacheKey();
 
-  if (is_successful)
+  // Nothing that affects the output changed since it was last exported (by anyone), the png encode can be skipped.
+  if (!cache_key.isEmpty() && buildCacheFetch(cache_dir, cache_key, dir_path, m_Name))
   {
-    bytes_file.write((const char*)m_Export.atlas_data.get(), m_Export.atlas_data_size);
-    bytes_file.close();
+    return true;
   }
 
-  return is_successful;
+  std::vector<QImage> page_images = {};
+  page_images.reserve(m_Export.pages.size());
+
+  for (const AtlasPage& page : m_Export.pages)
+  {
+    page_images.push_back(page.image);
+  }
+
+  if (!cache_key.isEmpty())
+  {
+    const QString entry_dir = buildCacheBeginEntry(cache_dir, cache_key);
+
+    if (!entry_dir.isEmpty())
+    {
+      if (atlasWriteExport(entry_dir, buildCacheEntryName(), page_images, m_Export.atlas_data.get(), m_Export.atlas_data_size, m_Export.extension_data, png_options) &&
+          buildCacheCommitEntry(cache_dir, cache_key, entry_dir, k_BuildCacheMaxEntries) &&
+          buildCacheFetch(cache_dir, cache_key, dir_path, m_Name))
+      {
+        return true;
+      }
+
+      QDir(entry_dir).removeRecursively();
+    }
+  }
+
+  // NOTE(SR): The cache is only an optimization, if it could not be used just write straight to the destination.
+  return atlasWriteExport(dir_path, m_Name, page_images, m_Export.atlas_data.get(), m_Export.atlas_data_size, m_Export.extension_data, png_options);
 }
 
 static bool loadJson(QString file_name, QJsonDocument& out)
@@ -299,6 +484,11 @@ static bool loadJson(QString file_name, QJsonDocument& out)
 
 bool Project::open(const QString& file_path)
 {
+  if (ProjectBinaryFile::isBinaryProject(file_path))
+  {
+    return openBinary(file_path);
+  }
+
   QJsonDocument json_doc;
 
   if (loadJson(file_path, json_doc))
@@ -342,6 +532,47 @@ bool Project::open(const QString& file_path)
   return false;
 }
 
+// Same as 'open' but the project is read straight out of the mapped file.
+bool Project::openBinary(const QString& file_path)
+{
+  ProjectBinaryFile file;
+  QString           error;
+
+  if (!file.open(file_path, error))
+  {
+    qWarning() << error;
+    return false;
+  }
+
+  m_ProjectFile = std::make_unique<QDir>(QFileInfo{file_path}.dir());
+
+  if (file.hasFields(ProjectBinField_EditUUID))
+  {
+    m_EditUUID = file.editUUID();
+  }
+
+  if (m_EditUUID.isNull())
+  {
+    m_EditUUID = QUuid::createUuid();
+  }
+
+  // A file whose library / animations ended up in the extra json is read through the json path so they are not dropped.
+  if (file.requiresJson() ? deserialize(projectBinaryToJson(file)) : deserialize(file))
+  {
+    m_IsBinaryFile = true;
+
+    Settings::addRecentFile(name(), m_ProjectFile->absoluteFilePath(m_Name + k_ProjectBinaryExtension));
+
+    regenerateAtlasExport();
+    m_UI.setWindowModified(false);
+
+    return true;
+  }
+
+  m_ProjectFile.reset();
+  return false;
+}
+
 bool Project::save()
 {
   if (!m_ProjectFile)
@@ -362,10 +593,10 @@ bool Project::save()
     m_EditUUID = QUuid::createUuid();
   }
 
-  const QString& json_file_path = m_ProjectFile->absoluteFilePath(m_Name + ".srsmproj.json");
-  QJsonObject    project_data   = serialize();
+  const QString& project_file_path = m_ProjectFile->absoluteFilePath(m_Name + (m_IsBinaryFile ? k_ProjectBinaryExtension : ".srsmproj.json"));
+  QJsonObject    project_data      = serialize();
 
-  Settings::addRecentFile(name(), json_file_path);
+  Settings::addRecentFile(name(), project_file_path);
 
   // This data should not be saved to file.
   project_data["m_SelectedAnimation"] = -1;
@@ -375,14 +606,14 @@ bool Project::save()
 
   project_data["m_EditUUID"] = m_EditUUID.toString(QUuid::WithoutBraces);
 
-  const QByteArray& json_as_bytes = QJsonDocument(project_data).toJson(QJsonDocument::Indented);
+  const QByteArray& project_as_bytes = m_IsBinaryFile ? projectBinaryFromJson(project_data) : QJsonDocument(project_data).toJson(QJsonDocument::Indented);
 
-  QFile jsonFile(json_file_path);
+  QFile projectFile(project_file_path);
 
-  if (jsonFile.open(QFile::WriteOnly))
+  if (projectFile.open(QFile::WriteOnly))
   {
-    jsonFile.write(json_as_bytes);
-    jsonFile.close();
+    projectFile.write(project_as_bytes);
+    projectFile.close();
 
     m_UI.setWindowModified(false);
 
@@ -430,85 +661,264 @@ QJsonObject Project::serialize()
    {"m_SelectedAnimation", m_SelectedAnimation},
    {"m_SpriteSheetImageSize", int(m_SpriteSheetImageSize)},
    {"m_SpriteSheetFrameSize", int(m_SpriteSheetFrameSize)},
+   {"m_AtlasPackingMode", int(m_AtlasPackingMode)},
+   {"m_MaxPageSize", int(m_MaxPageSize)},
+   {"m_TrimTransparentBorders", m_TrimTransparentBorders},
+   {"m_PremultipliedAlpha", m_PremultipliedAlpha},
   };
 }
 
-bool Project::deserialize(const QJsonObject& data, UndoActionFlags flags)
+bool Project::deserialize(const QJsonObject& data)
 {
   if (data.contains("name") && data.contains("image_library") && data.contains("animations"))
   {
-    if (flags & UndoActionFlag_ModifiedSettings)
+    setProjectNameRaw(data.value("name").toString());
+
+    m_ImageLibrary->deserialize(*this, data.value("image_library").toObject());
+
+    m_SpriteSheetImageSize   = data.value("m_SpriteSheetImageSize").toInt(m_SpriteSheetImageSize);
+    m_SpriteSheetFrameSize   = data.value("m_SpriteSheetFrameSize").toInt(m_SpriteSheetFrameSize);
+    m_AtlasPackingMode       = atlasPackingModeFromInt(data.value("m_AtlasPackingMode").toInt(int(AtlasPackingMode::Grid)));
+    m_MaxPageSize            = std::clamp(data.value("m_MaxPageSize").toInt(int(m_MaxPageSize)), 1, k_MaxAtlasPageSize);
+    m_TrimTransparentBorders = data.value("m_TrimTransparentBorders").toBool(false);
+    m_PremultipliedAlpha     = data.value("m_PremultipliedAlpha").toBool(false);
+
+    markAtlasModifed();
+
+    selectAnimation(QModelIndex());
+    m_AnimationList.removeRows(0, m_AnimationList.rowCount());
+
+    const QJsonObject animation_data = data["animations"].toObject();
+
+    for (const auto& animation_data_key : animation_data.keys())
     {
-      setProjectNameRaw(data.value("name").toString());
+      const auto   anim               = animation_data[animation_data_key];
+      const int    anim_index         = newAnimationRaw(animation_data_key, anim["frame_rate"].toInt());
+      Animation*   anim_obj           = (Animation*)m_AnimationList.item(anim_index, 0);
+      QJsonArray   frames_data        = anim["frames"].toArray();
+      const double default_frame_time = anim_obj->frameTime();
 
-      m_UI.setWindowModified(true);
+      for (const auto& frame : frames_data)
+      {
+        const QJsonObject frame_data = frame.toObject();
+        const QString     rel_path   = frame_data["rel_path"].toString();
+        const QString     abs_path   = m_ProjectFile->absoluteFilePath(rel_path);
+        const auto        frame_src  = m_ImageLibrary->findFrameSource(abs_path);
+
+#if 0
+        if (rel_path.isEmpty())
+        {
+            // TODO(SR): Error message.
+            continue;
+        }
+#endif
+
+        if (!frame_src)
+        {
+          // TODO(SR): Error message.
+          continue;
+        }
+
+        anim_obj->addFrame(AnimationFrameInstance(frame_src, (float)frame_data["frame_time"].toDouble(default_frame_time)));
+      }
     }
 
-    if (flags & UndoActionFlag_ModifiedAtlas)
+    const int selected_anim = data.value("m_SelectedAnimation").toInt(-1);
+
+    selectAnimation(selected_anim);
+    m_UI.animationListView().setCurrentIndex(m_AnimationList.index(selected_anim, 0, QModelIndex()));
+
+    m_UI.setWindowModified(true);
+
+    return true;
+  }
+
+  return false;
+}
+
+bool Project::deserialize(const ProjectBinaryFile& data)
+{
+  const ProjectBinHeader& header = data.header();
+
+  if (!data.hasFields(ProjectBinField_Name | ProjectBinField_ImageLibrary | ProjectBinField_Animations))
+  {
+    return false;
+  }
+
+  setProjectNameRaw(data.string(header.name));
+
+  m_ImageLibrary->deserialize(*this, data);
+
+  m_SpriteSheetImageSize   = data.hasFields(ProjectBinField_SpriteSheetImageSize) ? header.sprite_sheet_image_size : m_SpriteSheetImageSize;
+  m_SpriteSheetFrameSize   = data.hasFields(ProjectBinField_SpriteSheetFrameSize) ? header.sprite_sheet_frame_size : m_SpriteSheetFrameSize;
+  m_AtlasPackingMode       = atlasPackingModeFromInt(data.hasFields(ProjectBinField_AtlasPackingMode) ? header.atlas_packing_mode : int(AtlasPackingMode::Grid));
+  m_MaxPageSize            = std::clamp(data.hasFields(ProjectBinField_MaxPageSize) ? header.max_page_size : int(m_MaxPageSize), 1, k_MaxAtlasPageSize);
+  m_TrimTransparentBorders = data.hasFields(ProjectBinField_TrimTransparentBorders) && header.trim_transparent_borders != 0u;
+  m_PremultipliedAlpha     = data.hasFields(ProjectBinField_PremultipliedAlpha) && header.premultiplied_alpha != 0u;
+
+  markAtlasModifed();
+
+  selectAnimation(QModelIndex());
+  m_AnimationList.removeRows(0, m_AnimationList.rowCount());
+
+  std::uint32_t                    num_animations = 0u;
+  const ProjectBinAnimation* const animations     = data.elements(header.animations, num_animations);
+
+  for (std::uint32_t i = 0; i < num_animations; ++i)
+  {
+    std::uint32_t                num_frames = 0u;
+    const ProjectBinFrame* const frames     = data.elements(animations[i].frames, num_frames);
+    const int                    anim_index = newAnimationRaw(data.string(animations[i].name), animations[i].frame_rate);
+    Animation*                   anim_obj   = (Animation*)m_AnimationList.item(anim_index, 0);
+
+    for (std::uint32_t j = 0; j < num_frames; ++j)
     {
-      m_ImageLibrary->deserialize(*this, data.value("image_library").toObject());
+      const QString abs_path  = m_ProjectFile->absoluteFilePath(data.string(frames[j].rel_path));
+      const auto    frame_src = m_ImageLibrary->findFrameSource(abs_path);
+
+      if (frame_src)
+      {
+        anim_obj->addFrame(AnimationFrameInstance(frame_src, float(frames[j].frame_time)));
+      }
+    }
+  }
 
-      m_SpriteSheetImageSize = data.value("m_SpriteSheetImageSize").toInt(m_SpriteSheetImageSize);
-      m_SpriteSheetFrameSize = data.value("m_SpriteSheetFrameSize").toInt(m_SpriteSheetFrameSize);
+  const int selected_anim = data.hasFields(ProjectBinField_SelectedAnimation) ? header.selected_animation : -1;
 
-      markAtlasModifed();
+  selectAnimation(selected_anim);
+  m_UI.animationListView().setCurrentIndex(m_AnimationList.index(selected_anim, 0, QModelIndex()));
 
-      m_UI.setWindowModified(true);
+  m_UI.setWindowModified(true);
+
+  return !data.isCorrupt();
+}
+
+void Project::captureUndoState(UndoActionFlags flags, int animation_row, UndoState& out_state)
+{
+  out_state.flags         = flags & UndoActionFlag_ModifiedAll;
+  out_state.animation_row = animation_row;
+
+  if (flags & UndoActionFlag_ModifiedSettings)
+  {
+    out_state.name                     = m_Name;
+    out_state.sprite_sheet_image_size  = m_SpriteSheetImageSize;
+    out_state.sprite_sheet_frame_size  = m_SpriteSheetFrameSize;
+    out_state.atlas_packing_mode       = m_AtlasPackingMode;
+    out_state.max_page_size            = m_MaxPageSize;
+    out_state.trim_transparent_borders = m_TrimTransparentBorders;
+    out_state.premultiplied_alpha      = m_PremultipliedAlpha;
+  }
+
+  if (flags & UndoActionFlag_ModifiedLibrary)
+  {
+    out_state.image_library = QJsonDocument(m_ImageLibrary->serialize(*this)).toJson(QJsonDocument::Compact);
+  }
+
+  if (flags & UndoActionFlag_ModifiedAnimation)
+  {
+    const int first_row = animation_row == -1 ? 0 : animation_row;
+    const int end_row   = animation_row == -1 ? numAnimations() : animation_row + 1;
+
+    out_state.selected_animation = m_SelectedAnimation;
+    out_state.animations.reserve(std::size_t(end_row - first_row));
+
+    for (int i = first_row; i < end_row; ++i)
+    {
+      const Animation* const animation = animationAt(i);
+
+      out_state.animations.push_back(UndoAnimationState{animation->name(), animation->frame_rate, animation->frames});
     }
+  }
+}
+
+void Project::restoreUndoState(const UndoState& state)
+{
+  if (state.flags & UndoActionFlag_ModifiedSettings)
+  {
+    setProjectNameRaw(state.name);
+
+    m_SpriteSheetImageSize   = state.sprite_sheet_image_size;
+    m_SpriteSheetFrameSize   = state.sprite_sheet_frame_size;
+    m_AtlasPackingMode       = state.atlas_packing_mode;
+    m_MaxPageSize            = state.max_page_size;
+    m_TrimTransparentBorders = state.trim_transparent_borders;
 
-    // A modifed atlas implies a modified animation since the frame indices may change.
-    if (flags & (UndoActionFlag_ModifiedAnimation | UndoActionFlag_ModifiedAtlas))
+    if (m_PremultipliedAlpha != state.premultiplied_alpha)
     {
-      selectAnimation(QModelIndex());
-      m_AnimationList.removeRows(0, m_AnimationList.rowCount());
+      m_PremultipliedAlpha = state.premultiplied_alpha;
+      regenerateAnimationExport();
+    }
+  }
 
-      const QJsonObject animation_data = data["animations"].toObject();
+  if (state.flags & UndoActionFlag_ModifiedLibrary)
+  {
+    m_ImageLibrary->deserialize(*this, QJsonDocument::fromJson(state.image_library).object());
 
-      for (const auto& animation_data_key : animation_data.keys())
+    // Every frame source was just recreated so the animations that are not being restored below need to point at the new ones.
+    if (!(state.flags & UndoActionFlag_ModifiedAnimation) || state.animation_row != -1)
+    {
+      for (int i = 0; i < numAnimations(); ++i)
       {
-        const auto   anim               = animation_data[animation_data_key];
-        const int    anim_index         = newAnimationRaw(animation_data_key, anim["frame_rate"].toInt());
-        Animation*   anim_obj           = (Animation*)m_AnimationList.item(anim_index, 0);
-        QJsonArray   frames_data        = anim["frames"].toArray();
-        const double default_frame_time = anim_obj->frameTime();
+        Animation* const animation = animationAt(i);
 
-        for (const auto& frame : frames_data)
-        {
-          const QJsonObject frame_data = frame.toObject();
-          const QString     rel_path   = frame_data["rel_path"].toString();
-          const QString     abs_path   = m_ProjectFile->absoluteFilePath(rel_path);
-          const auto        frame_src  = m_ImageLibrary->findFrameSource(abs_path);
+        animation->frames = resolveFrameSources(animation->frames);
+      }
+    }
+  }
 
-#if 0
-          if (rel_path.isEmpty())
-          {
-              // TODO(SR): Error message.
-              continue;
-          }
-#endif
+  if (state.flags & UndoActionFlag_ModifiedAnimation)
+  {
+    if (state.animation_row == -1)
+    {
+      selectAnimation(QModelIndex());
+      m_AnimationList.removeRows(0, m_AnimationList.rowCount());
 
-          if (!frame_src)
-          {
-            // TODO(SR): Error message.
-            continue;
-          }
+      for (const UndoAnimationState& src_animation : state.animations)
+      {
+        Animation* const animation = animationAt(newAnimationRaw(src_animation.name, src_animation.frame_rate));
 
-          anim_obj->addFrame(AnimationFrameInstance(frame_src, (float)frame_data["frame_time"].toDouble(default_frame_time)));
-        }
+        animation->frames = resolveFrameSources(src_animation.frames);
       }
 
-      const int selected_anim = data.value("m_SelectedAnimation").toInt(-1);
+      selectAnimation(state.selected_animation);
+      m_UI.animationListView().setCurrentIndex(m_AnimationList.index(state.selected_animation, 0, QModelIndex()));
+    }
+    else
+    {
+      const UndoAnimationState& src_animation = state.animations.front();
+      Animation* const          animation     = animationAt(state.animation_row);
+
+      animation->setName(src_animation.name);
+      animation->frame_rate = src_animation.frame_rate;
+      animation->frames     = resolveFrameSources(src_animation.frames);
 
-      selectAnimation(selected_anim);
-      m_UI.animationListView().setCurrentIndex(m_AnimationList.index(selected_anim, 0, QModelIndex()));
+      // Re-selecting resets the timeline's selection which may have pointed past the restored frames.
+      if (state.animation_row == m_SelectedAnimation)
+      {
+        m_UI.timelineFpsSpinbox().setValue(animation->frame_rate);
 
-      m_UI.setWindowModified(true);
+        emit animationSelected(animation, m_SelectedAnimation);
+      }
     }
+  }
+}
 
-    return true;
+std::size_t Project::historyMemoryUsage() const
+{
+  std::size_t result = 0u;
+
+  for (int i = 0; i < m_HistoryStack->count(); ++i)
+  {
+    result += static_cast<const UndoAction*>(m_HistoryStack->command(i))->memoryUsage();
   }
 
-  return false;
+  return result;
+}
+
+qint64 Project::historyDiskUsage() const
+{
+  // The whole file, blocks of states that were read back stay reserved for when they are spilled again.
+  return m_HistorySpillFile.size();
 }
 
 int Project::numAnimations() const
@@ -516,13 +926,8 @@ int Project::numAnimations() const
   return m_AnimationList.rowCount();
 }
 
-extern QRect aspectRatioDrawRegion(std::uint32_t aspect_w, std::uint32_t aspect_h, std::uint32_t window_w, std::uint32_t window_h);
-extern int   roundToUpperMultiple(int n, int grid_size);
-
 void Project::regenerateAtlasExport()
 {
-  static constexpr int k_FramePadding = 0;
-
   if (!m_AtlasModified)
   {
     return;
@@ -530,270 +935,385 @@ void Project::regenerateAtlasExport()
 
   m_AtlasModified = false;
 
-  if (m_IsRegeneratingAtlas)
+  // Whatever a running job is building is already out of date.
+  if (m_AtlasJob)
   {
-    return;
+    m_AtlasJob->cancel.store(true, std::memory_order_relaxed);
+    m_AtlasJob.reset();
   }
 
+  ++m_AtlasGeneration;
+
   const int num_images = m_ImageLibrary->numImages();
 
-  if (num_images)
+  if (!num_images)
   {
-    m_IsRegeneratingAtlas = true;
+    emit atlasProgress(0, 0);
+    return;
+  }
 
-    const auto&                  loaded_images_keys = m_ImageLibrary->loadedImageList();
-    QMap<QString, std::uint32_t> frame_to_index     = {};
-    const unsigned int           atlas_width        = roundToUpperMultiple(m_SpriteSheetImageSize, m_SpriteSheetFrameSize);  // TODO(SR): This policy is probably stupid and makes 'm_SpriteSheetImageSize' nearly useless from the user's perspectiv.e
-    const unsigned int           num_frame_cols     = atlas_width / m_SpriteSheetFrameSize;
-    const unsigned int           num_frame_rows     = std::ceil(static_cast<float>(num_images) / static_cast<float>(num_frame_cols));
-    const unsigned int           atlas_height       = num_frame_rows * m_SpriteSheetFrameSize;
-    unsigned int                 current_x          = 0;
-    unsigned int                 current_y          = 0;
-    std::uint32_t                current_frame      = 0;
-    std::vector<QRect>           frame_rects        = {};
-    auto&                        image_rects        = m_Export.image_rectangles;
+  const std::shared_ptr<AtlasJob> job = std::make_shared<AtlasJob>();
 
-    QProgressDialog progress("Generating Spritesheet", "Cancel", 0, num_images + 1, &m_UI);
-    progress.setWindowModality(Qt::ApplicationModal);
-    progress.setMinimumDuration(0);
+  job->generation         = m_AtlasGeneration;
+  job->abs_image_paths    = m_ImageLibrary->loadedImageList();
+  job->settings           = atlasBuildSettings();
+  job->num_decode_threads = Settings::decodeThreadCount();
+  job->cache              = &m_ImageLibrary->imageCache();
 
-    // TODO(Shareef): THE MAX SIZE OF QPixmap is '32767'x'32767'. This is buggy....
-    // [https://doc.qt.io/qt-6/qpainter.html#limitations]
+  m_AtlasJob = job;
 
-    QImage atlas_image((int)atlas_width, (int)atlas_height, QImage::Format_ARGB32);
-    atlas_image.fill(0x00000000);
+  const int progress_maximum = atlasJobProgressMaximum(job->abs_image_paths.size());
 
-    QPainter painter(&atlas_image);
-    painter.setRenderHint(QPainter::Antialiasing, true);
-    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+  emit atlasProgress(0, progress_maximum);
 
-    image_rects.clear();
-    frame_rects.reserve(loaded_images_keys.size());
+  // NOTE(SR):
+  //   The worker only ever posts back to this thread, everything on 'Project' is touched from the queued calls.
+  //   '~Project' waits on the pool so `this` outlives the job, any call still queued is dropped along with it.
 
-    for (const QString& abs_image_path : loaded_images_keys)
-    {
-#define OPTIMIZE_USE_SLOW_SCALING 0
-#define OPTIMIZE_USE_PIXMAP 1
+  m_AtlasJobPool.start([this, job, progress_maximum]() {
+    QElapsedTimer progress_timer;
+    progress_timer.start();
 
-#if OPTIMIZE_USE_PIXMAP
-      const QPixmap image(abs_image_path);
-#else
-      const QImage image(abs_image_path);
-#endif
-      if (!image.isNull())
+    const bool is_done = atlasJobRun(*job, [this, &job, &progress_timer, progress_maximum](int value) {
+      if (progress_timer.hasExpired(k_AtlasProgressIntervalMs))
       {
-        const auto  frame_src   = m_ImageLibrary->findFrameSource(abs_image_path);
-        const QSize scaled_size = QSize(m_SpriteSheetFrameSize - k_FramePadding, m_SpriteSheetFrameSize - k_FramePadding);
-
-#if OPTIMIZE_USE_SLOW_SCALING
-#if OPTIMIZE_USE_PIXMAP
-        const QPixmap scaled_image = image.scaled(scaled_size.width(), scaled_size.height(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-#else
-        const QImage scaled_image = image.scaled(scaled_size.width(), scaled_size.height(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-#endif
-        const auto offset_x = (m_SpriteSheetFrameSize - scaled_image.width()) / 2;
-        const auto offset_y = (m_SpriteSheetFrameSize - scaled_image.height()) / 2;
-#else
-        const QRect  scaled_image = aspectRatioDrawRegion(image.width(), image.height(), scaled_size.width(), scaled_size.height());
-        const auto   offset_x     = scaled_image.x();
-        const auto   offset_y     = scaled_image.y();
-#endif
-
-#if OPTIMIZE_USE_SLOW_SCALING
-        const auto draw_point = QPoint(current_x + offset_x, current_y + offset_y);
+        progress_timer.restart();
 
-#if OPTIMIZE_USE_PIXMAP
-        painter.drawPixmap(draw_point, scaled_image);
-#else
-        painter.drawImage(draw_point, scaled_image);
-#endif
-#else
-        const QPoint target_loc   = QPoint(current_x + offset_x, current_y + offset_y);
-        const QRect  target_rect  = QRect(target_loc, scaled_image.size());
-        const QRect  source_rect  = QRect(0, 0, image.width(), image.height());
-
-#if OPTIMIZE_USE_PIXMAP
-        painter.drawPixmap(target_rect, image, source_rect);
-#else
-        painter.drawImage(target_rect, image, source_rect, Qt::AutoColor);
-#endif
-#endif
-        const std::uint32_t image_drawn_x = current_x;
-        const std::uint32_t image_drawn_y = current_y;
-        const std::uint32_t image_drawn_w = m_SpriteSheetFrameSize;
-        const std::uint32_t image_drawn_h = m_SpriteSheetFrameSize;
+        QMetaObject::invokeMethod(this, [this, generation = job->generation, value, progress_maximum]() {
+          if (generation == m_AtlasGeneration)
+          {
+            emit atlasProgress(value, progress_maximum);
+          }
+        }, Qt::QueuedConnection);
+      }
+    });
 
-        image_rects.emplace_back(image_drawn_x, image_drawn_y, image_drawn_w, image_drawn_h);
+    if (is_done)
+    {
+      QMetaObject::invokeMethod(this, [this, job]() { finishAtlasJob(job); }, Qt::QueuedConnection);
+    }
+  });
+}
 
-        const QRect frame_rect = QRect(image_drawn_x + offset_x, image_drawn_y + offset_y, scaled_image.width(), scaled_image.height());
+void Project::waitForAtlasExport()
+{
+  regenerateAtlasExport();
 
-        frame_rects.emplace_back(frame_rect);
+  if (m_AtlasJob)
+  {
+    m_AtlasJobPool.waitForDone();
+    finishAtlasJob(m_AtlasJob);
+  }
+}
 
-        current_x += m_SpriteSheetFrameSize;
+void Project::finishAtlasJob(std::shared_ptr<AtlasJob> job)
+{
+  // Either a newer edit came in after this job was started (its own job is the one to apply) or 'waitForAtlasExport' already applied it.
+  if (job != m_AtlasJob)
+  {
+    return;
+  }
 
-        if (current_x >= atlas_width)
-        {
-          current_x = 0;
-          current_y += m_SpriteSheetFrameSize;
-        }
+  m_AtlasJob.reset();
 
-        frame_to_index[abs_image_path] = current_frame;
-        ++current_frame;
-      }
-      else
-      {
-        QMessageBox::warning(&m_UI, "Error", "Failed to load image: \'" + abs_image_path + "\'");
-      }
+  const int                    num_images     = job->abs_image_paths.size();
+  std::vector<AtlasPage>       atlas_pages    = {};
+  QMap<QString, std::uint32_t> frame_to_index = {};
 
-      progress.setValue(current_frame);
-    }
+  atlas_pages.reserve(job->pages.size());
 
-    painter.end();
+  for (QImage& page_image : job->pages)
+  {
+    AtlasPage& page = atlas_pages.emplace_back();
 
-    progress.setValue(progress.value() + 1);
+    page.image  = std::move(page_image);
+    page.pixmap = QPixmap::fromImage(page.image);
+  }
 
-    m_Export.frame_to_index = std::move(frame_to_index);
-    m_Export.image          = atlas_image;
-    m_Export.pixmap         = QPixmap::fromImage(m_Export.image);
+  for (int image_index = 0; image_index < num_images; ++image_index)
+  {
+    frame_to_index[job->abs_image_paths[image_index]] = job->layout.image_to_uv[image_index];
+  }
 
-    m_AtlasModified = false;
+  m_Export.frame_to_index     = std::move(frame_to_index);
+  m_Export.pages              = std::move(atlas_pages);
+  m_Export.layout             = std::move(job->layout);
+  m_Export.decode_time_ms     = job->decoded_images.decode_time_ms;
+  m_Export.decode_num_threads = job->decoded_images.num_threads;
+  m_Export.decode_cache_hits  = job->decoded_images.num_cache_hits;
+  m_Export.settings           = job->settings;
+  m_Export.image_hashes       = std::move(job->decoded_images.image_hashes);
 
-    if (g_Server)
+  if (g_Server)
+  {
+    if (m_EditUUID.isNull())
     {
-      if (m_EditUUID.isNull())
-      {
-        m_EditUUID = QUuid::createUuid();
-      }
+      m_EditUUID = QUuid::createUuid();
+    }
 
-      const QString    guid_str  = m_EditUUID.toString(QUuid::WithoutBraces);
-      const QByteArray guid_cstr = guid_str.toLocal8Bit();
+    // NOTE(SR): The live reload protocol only knows about a single texture so only the first page is sent.
+    g_Server->sendAtlasTextureChanged(m_EditUUID, m_Export.pages[0].image);
+  }
 
-      g_Server->sendAtlasTextureChanged(m_EditUUID, m_Export.image);
-    }
+  // An atlas regen implies an animation regen
+  regenerateAnimationExport();
 
-    // An atlas regen implies an animation regen
-    regenerateAnimationExport();
+  const int progress_maximum = atlasJobProgressMaximum(num_images);
 
-    emit atlasModified(m_Export);
+  emit atlasProgress(progress_maximum, progress_maximum);
+  emit atlasModified(m_Export);
 
-    m_IsRegeneratingAtlas = false;
+  // Reported last since the message box runs its own event loop, 'm_Export' is consistent by now.
+  for (const QString& abs_image_path : job->failed_images)
+  {
+    // The layout gave this image an empty rect to keep 'image_rects' parallel to the library's image indices.
+    QMessageBox::warning(&m_UI, "Error", "Failed to load image: '" + abs_image_path + "'");
   }
 }
 
 void Project::regenerateAnimationExport()
 {
-  const auto&         image_rects    = m_Export.image_rectangles;
   const std::uint32_t num_animations = std::uint32_t(m_AnimationList.rowCount());
-  const std::uint32_t num_uv_frames  = std::uint32_t(image_rects.size());
 
   if (m_EditUUID.isNull())
   {
     m_EditUUID = QUuid::createUuid();
   }
 
-  SpriteAnim::SpritesheetDataSizeCalculator data_size = {};
+  std::vector<AtlasAnimation> animations = {};
+  animations.reserve(num_animations);
 
   for (std::uint32_t i = 0; i < num_animations; ++i)
   {
-    Animation* const    animation      = animationAt(i);
-    const QString       animation_name = animation->name();
-    const auto          anim_name_8bit = animation_name.toLocal8Bit();
-    const std::uint32_t name_length    = std::uint32_t(animation_name.length());
+    Animation* const    animation  = animationAt(i);
+    const std::uint32_t num_frames = animation->numFrames();
+    AtlasAnimation&     dst_anim   = animations.emplace_back();
 
-    data_size.addAnimation(name_length, animation->numFrames());
+    dst_anim.name = animation->name();
+    dst_anim.frames.reserve(num_frames);
+
+    for (std::uint32_t j = 0; j < num_frames; ++j)
+    {
+      AnimationFrameInstance* const src_frame = animation->frameAt(j);
+      const auto                    uv_index  = m_Export.frame_to_index.constFind(src_frame->full_path());
+
+      // Added after the atlas in flight was started, the frame is picked up once that job's result is applied.
+      if (uv_index == m_Export.frame_to_index.cend())
+      {
+        continue;
+      }
+
+      dst_anim.frames.push_back(AtlasAnimationFrame{*uv_index, src_frame->frame_time});
+    }
   }
 
-  for (std::uint32_t i = 0; i < num_uv_frames; ++i)
+  // Not part of what the pages were built with so it is picked up here rather than by an atlas regen.
+  m_Export.settings.premultiplied_alpha = m_PremultipliedAlpha;
+
+  m_Export.atlas_data     = atlasBuildSpritesheetData(m_EditUUID, m_Export.layout, animations, m_Export.atlas_data_size);
+  m_Export.extension_data = atlasBuildExtensionData(m_Export.layout, m_Export.settings);
+
+  if (g_Server && m_SelectedAnimation != -1)
   {
-    data_size.addUVFrame();
+    g_Server->sendAnimationFramesChanged(m_EditUUID, *animationAt(m_SelectedAnimation), m_Export.frame_to_index);
   }
 
-  const std::uint64_t spritesheet_chunk_size = SpriteAnim::Spritesheet::calcTotalSize(data_size);
+  notifyAnimationChanged(m_SelectedAnimation != -1 ? animationAt(m_SelectedAnimation) : nullptr);
+}
+
+QString Project::atlasBuildCacheKey() const
+{
+  // NOTE(SR):
+  //   Keyed by what is written rather than by the image files, a file can change on disk before the watcher's
+  //   signal is handled and 'm_Export' would then be cached under the key of contents it was not built from.
+  //   Still far cheaper than the png encode, 'srsm-build' keys by the files since it decodes those same bytes.
+  BuildCacheKey key = {m_Export.settings, Settings::pngCompressionLevel(), m_EditUUID};
 
-  m_Export.atlas_data      = std::make_unique<unsigned char[]>(spritesheet_chunk_size);
-  m_Export.atlas_data_size = spritesheet_chunk_size;
+  for (const AtlasPage& page : m_Export.pages)
+  {
+    key.addPageImage(page.image);
+  }
 
-  static_assert(sizeof(m_EditUUID) == sizeof(uuid128), "");
+  key.addBytes(m_Export.atlas_data.get(), qint64(m_Export.atlas_data_size));
+  key.addBytes(m_Export.extension_data.constData(), m_Export.extension_data.size());
 
-  SpriteAnim::SpritesheetBuilder spritesheet_builder =
-   {
-    m_Export.atlas_data.get(),
-    *(const uuid128*)&m_EditUUID,
-    std::uint16_t(m_Export.image.width()),
-    std::uint16_t(m_Export.image.height()),
-    data_size,
-   };
+  return key.result();
+}
 
-  for (std::uint32_t i = 0; i < num_animations; ++i)
+bool Project::hasAnimation(const QString& name)
+{
+  const int num_anims = m_AnimationList.rowCount();
+
+  for (int i = 0; i < num_anims; ++i)
   {
-    Animation* const    animation      = animationAt(i);
-    const QByteArray    animation_name = animation->name().toLocal8Bit();
-    const std::uint32_t num_frames     = animation->numFrames();
+    const auto index_at_i = m_AnimationList.index(i, 0);
+    const auto anim_name  = m_AnimationList.data(index_at_i, Qt::DisplayRole);
 
-    auto animation_builder = spritesheet_builder.addAnimation(
-     string_range{animation_name.data(), std::size_t(animation_name.size())},
-     num_frames);
+    if (anim_name.toString() == name)
+    {
+      return true;
+    }
+  }
 
-    for (std::uint32_t j = 0; j < num_frames; ++j)
+  return false;
+}
+
+bool Project::repaintAtlasImages(const QVector<QString>& changed_images)
+{
+  const auto&        loaded_images_keys = m_ImageLibrary->loadedImageList();
+  const AtlasLayout& layout             = m_Export.layout;
+  const auto&        image_rects        = layout.image_rects;
+  const auto&        image_pages        = layout.image_pages;
+
+  // Any other pending change or a different layout requires a full rebuild.
+  if (changed_images.isEmpty() ||
+      m_AtlasModified ||
+      isRegeneratingAtlas() ||
+      m_Export.pages.empty() ||
+      m_Export.pages[0].image.isNull() ||
+      image_rects.size() != std::size_t(loaded_images_keys.size()) ||
+      m_Export.settings != atlasBuildSettings())
+  {
+    return false;
+  }
+
+  std::vector<int> cell_indices = {};
+  cell_indices.reserve(changed_images.size());
+
+  for (const QString& abs_image_path : changed_images)
+  {
+    const AnimationFrameSourcePtr frame_src = m_ImageLibrary->findFrameSource(abs_image_path);
+
+    if (!frame_src || frame_src->index < 0 || std::size_t(frame_src->index) >= image_rects.size() || image_rects[frame_src->index].isEmpty())
     {
-      AnimationFrameInstance* const src_frame = animation->frameAt(j);
+      return false;
+    }
 
-      animation_builder.addFrame(
-       m_Export.frame_to_index[src_frame->full_path()],
-       src_frame->frame_time);
+    // A cell shared by duplicate frames has to be split apart by the layout.
+    if (std::count(layout.image_aliases.begin(), layout.image_aliases.end(), layout.image_aliases[frame_src->index]) > 1)
+    {
+      return false;
     }
+
+    cell_indices.push_back(frame_src->index);
   }
 
-  const float32 image_width_f  = float32(m_Export.image.width());
-  const float32 image_height_f = float32(m_Export.image.height());
+  AtlasDecodeResult decoded_images = {};
+
+  atlasDecodeImages(changed_images, Settings::decodeThreadCount(), &m_ImageLibrary->imageCache(), decoded_images);
 
-  for (std::uint32_t i = 0; i < num_uv_frames; ++i)
+  for (std::size_t i = 0; i < cell_indices.size(); ++i)
   {
-    const QRect& img_rect = image_rects[i];
+    const QImage& image = decoded_images.images[i];
 
-    const uint32_t x = img_rect.x();
-    const uint32_t y = img_rect.y();
-    const uint32_t w = img_rect.width();
-    const uint32_t h = img_rect.height();
+    // The full rebuild will report the error to the user.
+    if (image.isNull())
+    {
+      return false;
+    }
 
-    region2Df dst_uv_frame;
-    dst_uv_frame.min.x = float32(x + 0.0f) / image_width_f;
-    dst_uv_frame.min.y = float32(y + 0.0f) / image_height_f;
-    dst_uv_frame.max.x = float32(x + 1.0f) / image_width_f;
-    dst_uv_frame.max.y = float32(y + 1.0f) / image_height_f;
+    // The new image may now be a duplicate of another frame.
+    for (std::size_t j = 0; j < m_Export.image_hashes.size(); ++j)
+    {
+      if (int(j) != cell_indices[i] && m_Export.image_hashes[j] == decoded_images.image_hashes[i])
+      {
+        return false;
+      }
+    }
+
+    // A packed frame can only be repainted in place if it still has the same aspect ratio (and trimmed bounds).
+    if (m_AtlasPackingMode != AtlasPackingMode::Grid)
+    {
+      const AtlasFrameTrim& trim       = layout.image_trims[cell_indices[i]];
+      const QSize           fit_size   = atlasFitFrameSize(image.size(), m_SpriteSheetFrameSize);
+      const QRect           frame_rect = layout.is_trimmed ? atlasTrimmedFrameRect(image.size(), atlasAlphaBounds(image), m_SpriteSheetFrameSize) : QRect(QPoint(0, 0), fit_size);
 
-    spritesheet_builder.addUVFrames(&dst_uv_frame, 1u);
+      if (fit_size != trim.source_size || frame_rect != QRect(trim.offset, image_rects[cell_indices[i]].size()))
+      {
+        return false;
+      }
+    }
   }
 
-  SpriteAnim::Spritesheet* const spritesheet = spritesheet_builder.end();
+  // Each cell is painted on the page it was laid out on, only the touched cells need to be copied over to the pixmap.
 
-  if (g_Server && m_SelectedAnimation != -1)
+  for (std::size_t i = 0; i < cell_indices.size(); ++i)
   {
-    g_Server->sendAnimationFramesChanged(m_EditUUID, *animationAt(m_SelectedAnimation), m_Export.frame_to_index);
+    const QRect& cell_rect = image_rects[cell_indices[i]];
+    AtlasPage&   page      = m_Export.pages[image_pages[cell_indices[i]]];
+
+    QPainter painter(&page.image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(cell_rect, Qt::transparent);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+    atlasCompositeFrame(painter, m_AtlasPackingMode, decoded_images.images[i], cell_rect, layout.image_trims[cell_indices[i]], k_AtlasFramePadding);
+
+    painter.end();
+
+    QPainter pixmap_painter(&page.pixmap);
+    pixmap_painter.setCompositionMode(QPainter::CompositionMode_Source);
+    pixmap_painter.drawImage(cell_rect.topLeft(), page.image, cell_rect);
+    pixmap_painter.end();
   }
 
-  notifyAnimationChanged(m_SelectedAnimation != -1 ? animationAt(m_SelectedAnimation) : nullptr);
+  for (std::size_t i = 0; i < cell_indices.size(); ++i)
+  {
+    m_Export.image_hashes[cell_indices[i]] = decoded_images.image_hashes[i];
+  }
+
+  m_Export.decode_time_ms     = decoded_images.decode_time_ms;
+  m_Export.decode_num_threads = decoded_images.num_threads;
+  m_Export.decode_cache_hits  = decoded_images.num_cache_hits;
+
+  m_UI.setWindowModified(true);
+
+  if (g_Server)
+  {
+    g_Server->sendAtlasTextureChanged(m_EditUUID, m_Export.pages[0].image);
+  }
+
+  emit atlasModified(m_Export);
+
+  return true;
 }
 
-bool Project::hasAnimation(const QString& name)
+AtlasBuildSettings Project::atlasBuildSettings() const
 {
-  const int num_anims = m_AnimationList.rowCount();
+  return AtlasBuildSettings{
+   m_AtlasPackingMode,
+   int(m_SpriteSheetFrameSize),
+   int(m_SpriteSheetImageSize),
+   int(m_MaxPageSize),
+   k_AtlasFramePadding,
+   m_TrimTransparentBorders,
+   m_PremultipliedAlpha,
+  };
+}
 
-  for (int i = 0; i < num_anims; ++i)
+// Frames whose image is no longer in the library are dropped, the same as when a project is opened.
+std::vector<AnimationFrameInstance> Project::resolveFrameSources(const std::vector<AnimationFrameInstance>& frames) const
+{
+  std::vector<AnimationFrameInstance> result = {};
+  result.reserve(frames.size());
+
+  for (const AnimationFrameInstance& frame : frames)
   {
-    const auto index_at_i = m_AnimationList.index(i, 0);
-    const auto anim_name  = m_AnimationList.data(index_at_i, Qt::DisplayRole);
+    const AnimationFrameSourcePtr frame_src = m_ImageLibrary->findFrameSource(frame.full_path());
 
-    if (anim_name.toString() == name)
+    if (frame_src)
     {
-      return true;
+      result.emplace_back(frame_src, frame.frame_time);
     }
   }
 
-  return false;
+  return result;
 }
 
-void Project::recordActionImpl(const QString& name, QUndoCommand* action)
+void Project::recordActionImpl(const QString& name, UndoAction* action)
 {
   action->setText(name);
   historyStack().push(action);
@@ -809,3 +1329,52 @@ Animation* Project::animationAt(QModelIndex index) const
 {
   return index.isValid() ? (Animation*)m_AnimationList.itemFromIndex(index) : nullptr;
 }
+
+void UndoAction::redo()
+{
+  if (m_Flags.testFlag(UndoActionFlag_FirstTime))
+  {
+    m_Flags.setFlag(UndoActionFlag_FirstTime, false);
+
+    if (m_Flags & UndoActionFlag_ModifiedAtlas)
+    {
+      m_Project->markAtlasModifed();
+      m_Project->regenerateAtlasExport();
+    }
+
+    if (m_Flags & UndoActionFlag_ModifiedAnimation)
+    {
+      m_Project->regenerateAnimationExport();
+    }
+
+    return;
+  }
+
+  swapStates();
+}
+
+void UndoAction::swapStates()
+{
+  // Nothing is applied, a half swap would leave the history out of sync with the document.
+  if (!m_State.load(m_Project->historySpillFile()))
+  {
+    m_Project->handleHistoryReadFailure(text());
+    return;
+  }
+
+  UndoState right_before_restore = {};
+
+  m_Project->captureUndoState(m_Flags, m_AnimationRow, right_before_restore);
+  m_Project->restoreUndoState(m_State.state());
+  m_State.state() = std::move(right_before_restore);
+
+  // An atlas regen (once the undo stack's index changes) also regenerates the animations.
+  if (m_Flags & UndoActionFlag_ModifiedAtlas)
+  {
+    m_Project->markAtlasModifed();
+  }
+  else if (m_Flags & UndoActionFlag_ModifiedAnimation)
+  {
+    m_Project->regenerateAnimationExport();
+  }
+}
@@ -9,56 +9,67 @@
 #ifndef SRSM_PROJECT_HPP
 #define SRSM_PROJECT_HPP
 
-#include "sr_animation.hpp"  // Animation
+#include "sr_animation.hpp"      // Animation
+#include "sr_atlas_builder.hpp"  // AtlasBuildSettings, AtlasLayout
+#include "sr_rect_packer.hpp"    // AtlasPackingMode
+#include "sr_undo_history.hpp"   // UndoActionFlags, UndoStateStorage, UndoSpillFile
 
 #include <QBuffer>      // QBuffer
 #include <QDir>         // QDir
 #include <QJsonObject>  // QJsonObject
 #include <QString>      // QString
+#include <QThreadPool>  // QThreadPool
 #include <QUndoStack>   // QUndoStack
 #include <QUuid>        // QUuid
 
-#include <memory>  // unique_ptr<T>
-#include <vector>  // vector<T>
+#include <cstdint>  // uint64_t
+#include <memory>   // shared_ptr<T>, unique_ptr<T>
+#include <vector>   // vector<T>
 
 class Project;
 class ImageLibrary;
 class MainWindow;
+class ProjectBinaryFile;
+struct AtlasJob;
 
-struct AtlasExport final
+struct AtlasPage final
 {
-  QPixmap                          pixmap;            //!< For fast drawing.
-  QImage                           image;             //!< For fast manipulation.
-  std::unique_ptr<unsigned char[]> atlas_data;        //!< For saving.
-  std::uint64_t                    atlas_data_size;   //!<
-  std::vector<QRect>               image_rectangles;  //!< For regenerating the the atlas.
-  QMap<QString, std::uint32_t>     frame_to_index;    //!<
+  QPixmap pixmap;  //!< For fast drawing.
+  QImage  image;   //!< For fast manipulation.
 };
 
-using ProjectPtr = std::unique_ptr<Project>;
-
-enum UndoActionFlag
+struct AtlasExport final
 {
-  UndoActionFlag_ModifiedSettings  = (1u << 0),
-  UndoActionFlag_ModifiedAnimation = (1u << 1),
-  UndoActionFlag_ModifiedAtlas     = (1u << 2),
-  UndoActionFlag_ModifiedAll       = UndoActionFlag_ModifiedSettings | UndoActionFlag_ModifiedAtlas | UndoActionFlag_ModifiedAnimation,
-  UndoActionFlag_FirstTime         = (1u << 3),
+  std::vector<AtlasPage>           pages;               //!< Parallel to 'layout.page_sizes'.
+  std::unique_ptr<unsigned char[]> atlas_data;          //!< For saving.
+  std::uint64_t                    atlas_data_size;     //!<
+  QByteArray                       extension_data;      //!< Written after 'atlas_data', see 'ExportExtensionWriter'.
+  AtlasBuildSettings               settings;            //!< The settings 'layout' was built with.
+  AtlasLayout                      layout;              //!< For regenerating the the atlas, each image list is parallel to 'ImageLibrary::loadedImageList'.
+  std::vector<std::size_t>         image_hashes;        //!< Parallel to 'ImageLibrary::loadedImageList', the 'atlasImageHash' of each image.
+  QMap<QString, std::uint32_t>     frame_to_index;      //!<
+  qint64                           decode_time_ms;      //!< How long the last decode stage took, for profiling.
+  int                              decode_num_threads;  //!< How many threads the last decode stage used.
+  int                              decode_cache_hits;   //!< How many images the last decode stage did not have to read from disk.
 };
 
-Q_DECLARE_FLAGS(UndoActionFlags, UndoActionFlag)
-Q_DECLARE_OPERATORS_FOR_FLAGS(UndoActionFlags)
+using ProjectPtr = std::unique_ptr<Project>;
 
-template<typename FRedo>
 class UndoAction final : public QUndoCommand
 {
  private:
-  Project*        m_Project;
-  QJsonObject     m_SerializedState;
-  UndoActionFlags m_Flags;
+  Project*         m_Project;
+  UndoStateStorage m_State;
+  UndoActionFlags  m_Flags;
+  int              m_AnimationRow;  //!< The only animation captured, -1 for the whole list.
 
  public:
-  UndoAction(Project* project, UndoActionFlags flags, FRedo&& do_action);
+  template<typename FRedo>
+  UndoAction(Project* project, UndoActionFlags flags, int animation_row, FRedo&& do_action);
+
+  UndoStateStorage&       state() { return m_State; }
+  const UndoStateStorage& state() const { return m_State; }
+  std::size_t             memoryUsage() const { return sizeof(*this) - sizeof(m_State) + m_State.memoryUsage(); }
 
   void undo() override final { swapStates(); }
   void redo() override final;
@@ -72,22 +83,32 @@ class Project final : public QObject
   Q_OBJECT
 
  private:
-  QString               m_Name;
-  QUuid                 m_EditUUID;
-  std::unique_ptr<QDir> m_ProjectFile;
-  ImageLibrary*         m_ImageLibrary;
-  QUndoStack*           m_HistoryStack;
-  QStandardItemModel    m_AnimationList;
-  MainWindow&           m_UI;
-  AtlasExport           m_Export;
-  int                   m_SelectedAnimation;
-  unsigned int          m_SpriteSheetImageSize;
-  unsigned int          m_SpriteSheetFrameSize;
-  bool                  m_AtlasModified;
-  bool                  m_IsRegeneratingAtlas;
+  QString                   m_Name;
+  QUuid                     m_EditUUID;
+  std::unique_ptr<QDir>     m_ProjectFile;
+  ImageLibrary*             m_ImageLibrary;
+  QUndoStack*               m_HistoryStack;
+  UndoSpillFile             m_HistorySpillFile;
+  qint64                    m_HistoryBudget;    //!< In bytes, 0 or less means unlimited.
+  QStandardItemModel        m_AnimationList;
+  MainWindow&               m_UI;
+  AtlasExport               m_Export;
+  int                       m_SelectedAnimation;
+  unsigned int              m_SpriteSheetImageSize;
+  unsigned int              m_SpriteSheetFrameSize;
+  AtlasPackingMode          m_AtlasPackingMode;
+  unsigned int              m_MaxPageSize;
+  bool                      m_TrimTransparentBorders;
+  bool                      m_PremultipliedAlpha;
+  bool                      m_AtlasModified;
+  std::shared_ptr<AtlasJob> m_AtlasJob;         //!< The newest atlas job, null once it has been applied to 'm_Export'.
+  std::uint64_t             m_AtlasGeneration;  //!< Bumped for each job started, a finished job from an older generation is dropped.
+  QThreadPool               m_AtlasJobPool;     //!< A single thread, a cancelled job bails out quickly so the next one is not held up.
+  bool                      m_IsBinaryFile;     //!< Opened from a binary project so it is saved as one too.
 
  public:
   explicit Project(MainWindow* main_window, const QString& name);
+  ~Project();
 
   // Accessors
 
@@ -98,16 +119,35 @@ class Project final : public QObject
   QStandardItemModel& animations() { return m_AnimationList; }
   unsigned int        spritesheetImageSize() const { return m_SpriteSheetImageSize; }
   unsigned int        spritesheetFrameSize() const { return m_SpriteSheetFrameSize; }
+  AtlasPackingMode    atlasPackingMode() const { return m_AtlasPackingMode; }
+  unsigned int        maxPageSize() const { return m_MaxPageSize; }
+  bool                trimTransparentBorders() const { return m_TrimTransparentBorders; }
+  bool                premultipliedAlpha() const { return m_PremultipliedAlpha; }
   Animation*          selectedAnimation() const { return m_SelectedAnimation == -1 ? nullptr : animationAt(m_SelectedAnimation); }
+  bool                isRegeneratingAtlas() const { return m_AtlasJob != nullptr; }
 
   // Undo-able Document Action API
 
   template<typename FRedo>
   void recordAction(const QString& name, UndoActionFlags flags, FRedo&& callback)
   {
-    recordActionImpl(name, new UndoAction<FRedo>(this, flags | UndoActionFlag_FirstTime, std::forward<FRedo>(callback)));
+    recordActionImpl(name, new UndoAction(this, flags | UndoActionFlag_FirstTime, -1, std::forward<FRedo>(callback)));
   }
 
+  // For an action that only changes `animation`, just it is captured rather than the whole animation list.
+  template<typename FRedo>
+  void recordAnimationAction(const QString& name, Animation* animation, FRedo&& callback)
+  {
+    recordActionImpl(name, new UndoAction(this, UndoActionFlag_ModifiedAnimation | UndoActionFlag_FirstTime, animation->row(), std::forward<FRedo>(callback)));
+  }
+
+  std::size_t    historyMemoryUsage() const;
+  qint64         historyDiskUsage() const;
+  UndoSpillFile& historySpillFile() { return m_HistorySpillFile; }
+
+  // For an action whose state could not be loaded back, the whole history is cleared and the user told.
+  void handleHistoryReadFailure(const QString& action_name);
+
   void newAnimation(const QString& name, int frame_rate);
   void selectAnimation(QModelIndex index);
   void selectAnimation(int index);
@@ -123,6 +163,7 @@ class Project final : public QObject
   void animationChanged(Animation* anim);
   void animationSelected(Animation* anim, int index);
   void atlasModified(AtlasExport& atlas);
+  void atlasProgress(int value, int maximum);  //!< Done once `value` reaches `maximum`.
   void renamed(const QString& name);
   void signalPreviewFrameSelected(Animation* anim);
 
@@ -132,6 +173,10 @@ class Project final : public QObject
   void onImportImages();
   void setSpritesheetImageSize(int value);
   void setSpritesheetFrameSize(int value);
+  void setAtlasPackingMode(int value);
+  void setMaxPageSize(int value);
+  void setTrimTransparentBorders(bool value);
+  void setPremultipliedAlpha(bool value);
   void setProjectName(const QString& value);
   void regenerateAtlasExport();
   void regenerateAnimationExport();
@@ -139,17 +184,23 @@ class Project final : public QObject
  private slots:
   void markAnimationsModifed();
   void onUndoRedoIndexChanged(int idx);
+  void trimHistory();
   void handleImageLibraryChange();
+  void handleImageFilesChanged();
 
  public:
   void markAtlasModifed();
   void setup(ImageLibrary* img_library);
+  void waitForAtlasExport();
 
   bool        exportAtlas(const QString& dir_path);
   bool        open(const QString& file_path);
   bool        save();
   QJsonObject serialize();
-  bool        deserialize(const QJsonObject& data, UndoActionFlags flags = UndoActionFlag_ModifiedAll);
+  bool        deserialize(const QJsonObject& data);
+  bool        deserialize(const ProjectBinaryFile& data);
+  void        captureUndoState(UndoActionFlags flags, int animation_row, UndoState& out_state);
+  void        restoreUndoState(const UndoState& state);
 
   int        numAnimations() const;
   Animation* animationAt(int index) const;
@@ -163,56 +214,26 @@ class Project final : public QObject
 
   // Helpers
 
-  bool hasAnimation(const QString& name);
-  void recordActionImpl(const QString& name, QUndoCommand* action);
+  bool                                openBinary(const QString& file_path);
+  bool                                hasAnimation(const QString& name);
+  AtlasBuildSettings                  atlasBuildSettings() const;
+  QString                             atlasBuildCacheKey() const;
+  bool                                repaintAtlasImages(const QVector<QString>& changed_images);
+  void                                finishAtlasJob(std::shared_ptr<AtlasJob> job);
+  std::vector<AnimationFrameInstance> resolveFrameSources(const std::vector<AnimationFrameInstance>& frames) const;
+  void                                recordActionImpl(const QString& name, UndoAction* action);
 };
 
 template<typename FRedo>
-UndoAction<FRedo>::UndoAction(Project* project, UndoActionFlags flags, FRedo&& do_action) :
+UndoAction::UndoAction(Project* project, UndoActionFlags flags, int animation_row, FRedo&& do_action) :
   QUndoCommand(),
   m_Project{project},
-  m_SerializedState{},
-  m_Flags{flags}
+  m_State{},
+  m_Flags{flags},
+  m_AnimationRow{animation_row}
 {
-  m_SerializedState = m_Project->serialize();
+  m_Project->captureUndoState(m_Flags, m_AnimationRow, m_State.state());
   do_action();
 }
 
-template<typename FRedo>
-void UndoAction<FRedo>::redo()
-{
-  if (m_Flags.testFlag(UndoActionFlag_FirstTime))
-  {
-    m_Flags.setFlag(UndoActionFlag_FirstTime, false);
-
-    if (m_Flags & UndoActionFlag_ModifiedAtlas)
-    {
-      m_Project->markAtlasModifed();
-      m_Project->regenerateAtlasExport();
-    }
-
-    if (m_Flags & UndoActionFlag_ModifiedAnimation)
-    {
-      m_Project->regenerateAnimationExport();
-    }
-
-    return;
-  }
-
-  swapStates();
-}
-
-template<typename FRedo>
-void UndoAction<FRedo>::swapStates()
-{
-  auto right_before_restore = m_Project->serialize();
-  m_Project->deserialize(m_SerializedState, m_Flags);
-  m_SerializedState = std::move(right_before_restore);
-
-  if (m_Flags & UndoActionFlag_ModifiedAtlas)
-  {
-    m_Project->markAtlasModifed();
-  }
-}
-
 #endif  // SRSM_PROJECT_HPP
@@ -0,0 +1,610 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_project_binary.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_project_binary.hpp"
+
+#include <QHash>          // QHash<K, V>
+#include <QJsonArray>     // QJsonArray
+#include <QJsonDocument>  // QJsonDocument
+
+#include <cmath>    // signbit
+#include <cstddef>  // offsetof
+#include <cstring>  // memcpy, memcmp
+#include <limits>   // numeric_limits
+#include <utility>  // move
+#include <vector>   // vector<T>
+
+namespace
+{
+  struct LibraryNodeRecord final
+  {
+    std::uint32_t type;
+    std::uint32_t is_expanded;
+    QByteArray    text;
+    std::uint32_t num_children;
+  };
+
+  struct FrameRecord final
+  {
+    QByteArray rel_path;
+    double     frame_time;
+  };
+
+  struct AnimationRecord final
+  {
+    QByteArray               name;
+    std::int32_t             frame_rate;
+    std::vector<FrameRecord> frames;
+  };
+}  // namespace
+
+static constexpr qsizetype k_ArrayAlignment = 8;
+
+static qsizetype alignArray(qsizetype offset)
+{
+  return (offset + k_ArrayAlignment - 1) & ~(k_ArrayAlignment - 1);
+}
+
+// Only strings that come back the same from utf-8 can be stored (lone surrogates can not).
+static bool losslessUtf8(const QJsonValue& value, QByteArray& out_utf8)
+{
+  if (!value.isString())
+  {
+    return false;
+  }
+
+  const QString string = value.toString();
+  QByteArray    utf8   = string.toUtf8();
+
+  if (QString::fromUtf8(utf8) != string)
+  {
+    return false;
+  }
+
+  out_utf8 = std::move(utf8);
+
+  return true;
+}
+
+static bool losslessInt32(const QJsonValue& value, std::int32_t& out_value)
+{
+  if (!value.isDouble())
+  {
+    return false;
+  }
+
+  const double number = value.toDouble();
+
+  if (!(number >= double(std::numeric_limits<std::int32_t>::min()) && number <= double(std::numeric_limits<std::int32_t>::max())) ||
+      double(std::int32_t(number)) != number ||
+      (number == 0.0 && std::signbit(number)))
+  {
+    return false;
+  }
+
+  out_value = std::int32_t(number);
+
+  return true;
+}
+
+// Mirrors 'ImageLibrary::serializeImpl', false if `data` (or anything under it) is not exactly what it writes.
+static bool flattenImageLibrary(const QJsonObject& data, std::vector<LibraryNodeRecord>& out_nodes)
+{
+  const QJsonValue type = data.value("type");
+
+  if (type == QJsonValue("folder"))
+  {
+    QByteArray name = {};
+
+    if (data.size() != 4 || !losslessUtf8(data.value("name"), name) || !data.value("items").isArray() || !data.value("isExpanded").isBool())
+    {
+      return false;
+    }
+
+    const QJsonArray items = data.value("items").toArray();
+
+    out_nodes.push_back(LibraryNodeRecord{ProjectBinNodeType_Folder, data.value("isExpanded").toBool() ? 1u : 0u, name, std::uint32_t(items.size())});
+
+    for (const auto& item : items)
+    {
+      if (!item.isObject() || !flattenImageLibrary(item.toObject(), out_nodes))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  QByteArray rel_path = {};
+
+  if (type == QJsonValue("image") && data.size() == 2 && losslessUtf8(data.value("rel_path"), rel_path))
+  {
+    out_nodes.push_back(LibraryNodeRecord{ProjectBinNodeType_Image, 0u, rel_path, 0u});
+    return true;
+  }
+
+  return false;
+}
+
+// Mirrors 'Project::serialize', false if `data` is not exactly what it writes.
+static bool flattenAnimations(const QJsonObject& data, std::vector<AnimationRecord>& out_animations)
+{
+  for (auto it = data.begin(); it != data.end(); ++it)
+  {
+    AnimationRecord& animation = out_animations.emplace_back();
+
+    if (!losslessUtf8(it.key(), animation.name) || !it.value().isObject())
+    {
+      return false;
+    }
+
+    const QJsonObject animation_data = it.value().toObject();
+
+    if (animation_data.size() != 2 || !losslessInt32(animation_data.value("frame_rate"), animation.frame_rate) || !animation_data.value("frames").isArray())
+    {
+      return false;
+    }
+
+    const QJsonArray frames_data = animation_data.value("frames").toArray();
+
+    animation.frames.reserve(frames_data.size());
+
+    for (const auto& frame : frames_data)
+    {
+      const QJsonObject frame_data = frame.toObject();
+      FrameRecord&      dst_frame  = animation.frames.emplace_back();
+
+      if (!frame.isObject() || frame_data.size() != 2 || !losslessUtf8(frame_data.value("rel_path"), dst_frame.rel_path) || !frame_data.value("frame_time").isDouble())
+      {
+        return false;
+      }
+
+      dst_frame.frame_time = frame_data.value("frame_time").toDouble();
+    }
+  }
+
+  return true;
+}
+
+template<typename T>
+static ProjectBinArray<T> makeArray(qsizetype field_offset, qsizetype elements_offset, std::size_t num_elements)
+{
+  if (num_elements == 0)
+  {
+    return ProjectBinArray<T>{0u, 0u};
+  }
+
+  return ProjectBinArray<T>{std::uint32_t(elements_offset - field_offset), std::uint32_t(num_elements)};
+}
+
+template<typename T>
+static void writeAt(QByteArray& data, qsizetype offset, const T& value)
+{
+  std::memcpy(data.data() + offset, &value, sizeof(value));
+}
+
+QByteArray projectBinaryFromJson(const QJsonObject& project_json)
+{
+  ProjectBinHeader header = {};
+
+  std::memcpy(header.magic, ProjectBinHeader::k_Magic, sizeof(header.magic));
+  header.version = ProjectBinHeader::k_Version;
+
+  // Every key stored in a field is taken out, what is left over is kept as json.
+  QJsonObject                    extra_json      = project_json;
+  QByteArray                     name            = {};
+  QByteArray                     last_saved_path = {};
+  std::vector<LibraryNodeRecord> library_nodes   = {};
+  std::vector<AnimationRecord>   animations      = {};
+
+  const auto take_string = [&](const QString& key, ProjectBinField field, QByteArray& out_utf8) {
+    if (losslessUtf8(extra_json.value(key), out_utf8))
+    {
+      header.fields |= field;
+      extra_json.remove(key);
+    }
+  };
+
+  const auto take_int32 = [&](const QString& key, ProjectBinField field, std::int32_t& out_value) {
+    if (losslessInt32(extra_json.value(key), out_value))
+    {
+      header.fields |= field;
+      extra_json.remove(key);
+    }
+  };
+
+  take_string("name", ProjectBinField_Name, name);
+  take_string("last_saved_path", ProjectBinField_LastSavedPath, last_saved_path);
+  take_int32("m_SelectedAnimation", ProjectBinField_SelectedAnimation, header.selected_animation);
+  take_int32("m_SelectedFrame", ProjectBinField_SelectedFrame, header.selected_frame);
+  take_int32("m_SpriteSheetImageSize", ProjectBinField_SpriteSheetImageSize, header.sprite_sheet_image_size);
+  take_int32("m_SpriteSheetFrameSize", ProjectBinField_SpriteSheetFrameSize, header.sprite_sheet_frame_size);
+  take_int32("m_AtlasPackingMode", ProjectBinField_AtlasPackingMode, header.atlas_packing_mode);
+  take_int32("m_MaxPageSize", ProjectBinField_MaxPageSize, header.max_page_size);
+
+  if (extra_json.value("m_TrimTransparentBorders").isBool())
+  {
+    header.trim_transparent_borders = extra_json.value("m_TrimTransparentBorders").toBool() ? 1u : 0u;
+    header.fields |= ProjectBinField_TrimTransparentBorders;
+    extra_json.remove("m_TrimTransparentBorders");
+  }
+
+  if (extra_json.value("m_PremultipliedAlpha").isBool())
+  {
+    header.premultiplied_alpha = extra_json.value("m_PremultipliedAlpha").toBool() ? 1u : 0u;
+    header.fields |= ProjectBinField_PremultipliedAlpha;
+    extra_json.remove("m_PremultipliedAlpha");
+  }
+
+  const QJsonValue edit_uuid = extra_json.value("m_EditUUID");
+
+  if (edit_uuid.isString() && QUuid(edit_uuid.toString()).toString(QUuid::WithoutBraces) == edit_uuid.toString())
+  {
+    const QByteArray uuid_bytes = QUuid(edit_uuid.toString()).toRfc4122();
+
+    std::memcpy(header.edit_uuid, uuid_bytes.constData(), sizeof(header.edit_uuid));
+    header.fields |= ProjectBinField_EditUUID;
+    extra_json.remove("m_EditUUID");
+  }
+
+  if (extra_json.value("image_library").isObject() && flattenImageLibrary(extra_json.value("image_library").toObject(), library_nodes))
+  {
+    header.fields |= ProjectBinField_ImageLibrary;
+    extra_json.remove("image_library");
+  }
+  else
+  {
+    library_nodes.clear();
+  }
+
+  if (extra_json.value("animations").isObject() && flattenAnimations(extra_json.value("animations").toObject(), animations))
+  {
+    header.fields |= ProjectBinField_Animations;
+    extra_json.remove("animations");
+  }
+  else
+  {
+    animations.clear();
+  }
+
+  // Layout, the fixed size arrays first then every string (each distinct string once) with the extra json last.
+
+  const qsizetype        nodes_offset      = alignArray(sizeof(ProjectBinHeader));
+  const qsizetype        animations_offset = alignArray(nodes_offset + qsizetype(library_nodes.size() * sizeof(ProjectBinLibraryNode)));
+  qsizetype              strings_offset    = alignArray(animations_offset + qsizetype(animations.size() * sizeof(ProjectBinAnimation)));
+  std::vector<qsizetype> frames_offsets    = {};
+
+  frames_offsets.reserve(animations.size());
+
+  for (const AnimationRecord& animation : animations)
+  {
+    frames_offsets.push_back(strings_offset);
+    strings_offset = alignArray(strings_offset + qsizetype(animation.frames.size() * sizeof(ProjectBinFrame)));
+  }
+
+  QByteArray                   data           = QByteArray(strings_offset, '\0');
+  QHash<QByteArray, qsizetype> string_offsets = {};
+
+  // Returns the array for `string` stored in the field at `field_offset`.
+  const auto add_string = [&data, &string_offsets](qsizetype field_offset, const QByteArray& string) {
+    qsizetype string_offset = string_offsets.value(string, -1);
+
+    if (string_offset < 0)
+    {
+      string_offset = data.size();
+      string_offsets.insert(string, string_offset);
+      data.append(string);
+      data.append('\0');
+    }
+
+    return makeArray<char>(field_offset, string_offset, std::size_t(string.size()));
+  };
+
+  header.name            = add_string(offsetof(ProjectBinHeader, name), name);
+  header.last_saved_path = add_string(offsetof(ProjectBinHeader, last_saved_path), last_saved_path);
+  header.image_library   = makeArray<ProjectBinLibraryNode>(offsetof(ProjectBinHeader, image_library), nodes_offset, library_nodes.size());
+  header.animations      = makeArray<ProjectBinAnimation>(offsetof(ProjectBinHeader, animations), animations_offset, animations.size());
+
+  for (std::size_t i = 0; i < library_nodes.size(); ++i)
+  {
+    const LibraryNodeRecord& src_node    = library_nodes[i];
+    const qsizetype          node_offset = nodes_offset + qsizetype(i * sizeof(ProjectBinLibraryNode));
+    ProjectBinLibraryNode    node        = {};
+
+    node.type         = src_node.type;
+    node.is_expanded  = src_node.is_expanded;
+    node.text         = add_string(node_offset + offsetof(ProjectBinLibraryNode, text), src_node.text);
+    node.num_children = src_node.num_children;
+
+    writeAt(data, node_offset, node);
+  }
+
+  for (std::size_t i = 0; i < animations.size(); ++i)
+  {
+    const AnimationRecord& src_animation    = animations[i];
+    const qsizetype        animation_offset = animations_offset + qsizetype(i * sizeof(ProjectBinAnimation));
+    ProjectBinAnimation    animation        = {};
+
+    animation.name       = add_string(animation_offset + offsetof(ProjectBinAnimation, name), src_animation.name);
+    animation.frames     = makeArray<ProjectBinFrame>(animation_offset + offsetof(ProjectBinAnimation, frames), frames_offsets[i], src_animation.frames.size());
+    animation.frame_rate = src_animation.frame_rate;
+
+    writeAt(data, animation_offset, animation);
+
+    for (std::size_t j = 0; j < src_animation.frames.size(); ++j)
+    {
+      const qsizetype frame_offset = frames_offsets[i] + qsizetype(j * sizeof(ProjectBinFrame));
+      ProjectBinFrame frame        = {};
+
+      frame.rel_path   = add_string(frame_offset + offsetof(ProjectBinFrame, rel_path), src_animation.frames[j].rel_path);
+      frame.frame_time = src_animation.frames[j].frame_time;
+
+      writeAt(data, frame_offset, frame);
+    }
+  }
+
+  if (!extra_json.isEmpty())
+  {
+    header.extra_json = add_string(offsetof(ProjectBinHeader, extra_json), QJsonDocument(extra_json).toJson(QJsonDocument::Compact));
+  }
+
+  header.file_size = std::uint32_t(data.size());
+
+  writeAt(data, 0, header);
+
+  return data;
+}
+
+// Reads the node at `index` and its children, `index` is left one past the last of them.
+static QJsonObject imageLibraryToJson(const ProjectBinaryFile& project, const ProjectBinLibraryNode* nodes, std::uint32_t num_nodes, std::uint32_t& index)
+{
+  const ProjectBinLibraryNode& node = nodes[index++];
+
+  if (node.type == ProjectBinNodeType_Folder)
+  {
+    QJsonArray items = {};
+
+    for (std::uint32_t i = 0; i < node.num_children && index < num_nodes; ++i)
+    {
+      items.push_back(imageLibraryToJson(project, nodes, num_nodes, index));
+    }
+
+    return QJsonObject{
+     {"type", "folder"},
+     {"name", project.string(node.text)},
+     {"items", items},
+     {"isExpanded", node.is_expanded != 0u},
+    };
+  }
+
+  return QJsonObject{
+   {"type", "image"},
+   {"rel_path", project.string(node.text)},
+  };
+}
+
+QJsonObject projectBinaryToJson(const ProjectBinaryFile& project)
+{
+  const ProjectBinHeader& header = project.header();
+
+  std::uint32_t     num_extra_bytes = 0u;
+  const char* const extra_bytes     = project.elements(header.extra_json, num_extra_bytes);
+  QJsonObject       result          = extra_bytes ? QJsonDocument::fromJson(QByteArray::fromRawData(extra_bytes, num_extra_bytes)).object() : QJsonObject{};
+
+  const auto put_int32 = [&](const QString& key, ProjectBinField field, std::int32_t value) {
+    if (project.hasFields(field))
+    {
+      result[key] = int(value);
+    }
+  };
+
+  if (project.hasFields(ProjectBinField_Name))
+  {
+    result["name"] = project.string(header.name);
+  }
+
+  if (project.hasFields(ProjectBinField_LastSavedPath))
+  {
+    result["last_saved_path"] = project.string(header.last_saved_path);
+  }
+
+  put_int32("m_SelectedAnimation", ProjectBinField_SelectedAnimation, header.selected_animation);
+  put_int32("m_SelectedFrame", ProjectBinField_SelectedFrame, header.selected_frame);
+  put_int32("m_SpriteSheetImageSize", ProjectBinField_SpriteSheetImageSize, header.sprite_sheet_image_size);
+  put_int32("m_SpriteSheetFrameSize", ProjectBinField_SpriteSheetFrameSize, header.sprite_sheet_frame_size);
+  put_int32("m_AtlasPackingMode", ProjectBinField_AtlasPackingMode, header.atlas_packing_mode);
+  put_int32("m_MaxPageSize", ProjectBinField_MaxPageSize, header.max_page_size);
+
+  if (project.hasFields(ProjectBinField_TrimTransparentBorders))
+  {
+    result["m_TrimTransparentBorders"] = header.trim_transparent_borders != 0u;
+  }
+
+  if (project.hasFields(ProjectBinField_PremultipliedAlpha))
+  {
+    result["m_PremultipliedAlpha"] = header.premultiplied_alpha != 0u;
+  }
+
+  if (project.hasFields(ProjectBinField_EditUUID))
+  {
+    result["m_EditUUID"] = project.editUUID().toString(QUuid::WithoutBraces);
+  }
+
+  if (project.hasFields(ProjectBinField_ImageLibrary))
+  {
+    std::uint32_t                      num_nodes = 0u;
+    const ProjectBinLibraryNode* const nodes     = project.elements(header.image_library, num_nodes);
+    std::uint32_t                      index     = 0u;
+
+    result["image_library"] = num_nodes != 0u ? imageLibraryToJson(project, nodes, num_nodes, index) : QJsonObject{};
+  }
+
+  if (project.hasFields(ProjectBinField_Animations))
+  {
+    std::uint32_t                    num_animations = 0u;
+    const ProjectBinAnimation* const animations     = project.elements(header.animations, num_animations);
+    QJsonObject                      animations_data;
+
+    for (std::uint32_t i = 0; i < num_animations; ++i)
+    {
+      std::uint32_t                num_frames = 0u;
+      const ProjectBinFrame* const frames     = project.elements(animations[i].frames, num_frames);
+      QJsonArray                   frames_data;
+
+      for (std::uint32_t j = 0; j < num_frames; ++j)
+      {
+        frames_data.push_back(QJsonObject{
+         {"rel_path", project.string(frames[j].rel_path)},
+         {"frame_time", frames[j].frame_time},
+        });
+      }
+
+      animations_data[project.string(animations[i].name)] = QJsonObject{
+       {"frames", frames_data},
+       {"frame_rate", int(animations[i].frame_rate)},
+      };
+    }
+
+    result["animations"] = animations_data;
+  }
+
+  return result;
+}
+
+ProjectBinaryFile::ProjectBinaryFile() :
+  m_File{},
+  m_Bytes{nullptr},
+  m_Data{nullptr},
+  m_Size{0},
+  m_IsCorrupt{false}
+{
+}
+
+bool ProjectBinaryFile::isBinaryProject(const QString& file_path)
+{
+  QFile file(file_path);
+
+  return file.open(QFile::ReadOnly) && file.read(sizeof(ProjectBinHeader::magic)) == QByteArray(ProjectBinHeader::k_Magic, sizeof(ProjectBinHeader::magic));
+}
+
+bool ProjectBinaryFile::open(const QString& file_path, QString& out_error)
+{
+  m_File.setFileName(file_path);
+
+  if (!m_File.open(QFile::ReadOnly))
+  {
+    out_error = QString("Failed to open '%1': %2").arg(file_path, m_File.errorString());
+    return false;
+  }
+
+  const qint64 file_size = m_File.size();
+  uchar* const data      = file_size >= qint64(sizeof(ProjectBinHeader)) ? m_File.map(0, file_size) : nullptr;
+
+  if (!data)
+  {
+    out_error = QString("Failed to map '%1': %2").arg(file_path, file_size < qint64(sizeof(ProjectBinHeader)) ? QString("the file is too small") : m_File.errorString());
+    return false;
+  }
+
+  return openView(data, file_size, out_error);
+}
+
+bool ProjectBinaryFile::openData(const QByteArray& data, QString& out_error)
+{
+  const qsizetype num_words = (data.size() + qsizetype(sizeof(std::uint64_t)) - 1) / qsizetype(sizeof(std::uint64_t));
+
+  m_Bytes = std::make_unique<std::uint64_t[]>(std::size_t(num_words));
+  std::memcpy(m_Bytes.get(), data.constData(), std::size_t(data.size()));
+
+  return openView(reinterpret_cast<const uchar*>(m_Bytes.get()), data.size(), out_error);
+}
+
+QUuid ProjectBinaryFile::editUUID() const
+{
+  return QUuid::fromRfc4122(QByteArray::fromRawData(reinterpret_cast<const char*>(header().edit_uuid), sizeof(header().edit_uuid)));
+}
+
+bool ProjectBinaryFile::requiresJson() const
+{
+  if (hasFields(ProjectBinField_ImageLibrary | ProjectBinField_Animations))
+  {
+    return false;
+  }
+
+  const QJsonObject extra_json = QJsonDocument::fromJson(string(header().extra_json).toUtf8()).object();
+
+  return extra_json.contains("image_library") || extra_json.contains("animations");
+}
+
+QString ProjectBinaryFile::string(const ProjectBinArray<char>& array) const
+{
+  std::uint32_t     num_bytes = 0u;
+  const char* const bytes     = elements(array, num_bytes);
+
+  return QString::fromUtf8(bytes, num_bytes);
+}
+
+ProjectBinaryFile::~ProjectBinaryFile()
+{
+  if (m_Data && !m_Bytes)
+  {
+    m_File.unmap(const_cast<uchar*>(m_Data));
+  }
+}
+
+bool ProjectBinaryFile::openView(const uchar* data, qsizetype size, QString& out_error)
+{
+  m_Data      = data;
+  m_Size      = size;
+  m_IsCorrupt = false;
+
+  if (size < qsizetype(sizeof(ProjectBinHeader)) || std::memcmp(header().magic, ProjectBinHeader::k_Magic, sizeof(header().magic)) != 0)
+  {
+    out_error = "Not a binary project.";
+    return false;
+  }
+
+  if (header().version != ProjectBinHeader::k_Version)
+  {
+    out_error = QString("Binary project version %1 is not supported (expected %2).").arg(header().version).arg(ProjectBinHeader::k_Version);
+    return false;
+  }
+
+  if (qsizetype(header().file_size) != size)
+  {
+    out_error = QString("Binary project is %1 bytes but should be %2, it was cut off or appended to.").arg(size).arg(header().file_size);
+    return false;
+  }
+
+  return true;
+}
+
+const void* ProjectBinaryFile::checkedElements(const void* array, std::uint32_t offset, std::uint32_t num_elements, std::size_t element_size, std::size_t alignment, std::uint32_t& out_num_elements) const
+{
+  out_num_elements = 0u;
+
+  if (num_elements == 0u)
+  {
+    return nullptr;
+  }
+
+  const quint64 array_offset    = quint64(static_cast<const uchar*>(array) - m_Data);
+  const quint64 elements_offset = array_offset + offset;
+  const quint64 elements_end    = elements_offset + quint64(num_elements) * element_size;
+
+  if (elements_end > quint64(m_Size) || elements_offset % alignment != 0u)
+  {
+    m_IsCorrupt = true;
+    return nullptr;
+  }
+
+  out_num_elements = num_elements;
+
+  return m_Data + elements_offset;
+}
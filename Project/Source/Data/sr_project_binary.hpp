@@ -0,0 +1,172 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_project_binary.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_PROJECT_BINARY_HPP
+#define SR_PROJECT_BINARY_HPP
+
+#include <QByteArray>   // QByteArray
+#include <QFile>        // QFile
+#include <QJsonObject>  // QJsonObject
+#include <QString>      // QString
+#include <QUuid>        // QUuid
+
+#include <cstdint>  // uint32_t, int32_t
+#include <memory>   // unique_ptr<T>
+
+// NOTE(SR):
+//   An alternative to '.srsmproj.json' that is read in place from a memory mapped file,
+//   no parse step and no string keyed lookups. Every variable sized field is a 'ProjectBinArray'
+//   (the same layout as 'binaryIO::rel_array32') so the file is just the structs below.
+//   See "Binary Project Format" in 'Documentation/spritesheet_generator.md' for the layout.
+//
+//   Converting to / from the json format is lossless so projects can still be diffed as text,
+//   anything this format has no field for is kept as json in 'ProjectBinHeader::extra_json'.
+
+static constexpr char k_ProjectBinaryExtension[] = ".srsmproj.bin";
+
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "The binary project format is little endian and is read in place.");
+
+// `offset` is from the start of this struct to the first element, both are 0 when it is empty.
+template<typename T>
+struct ProjectBinArray
+{
+  std::uint32_t offset;
+  std::uint32_t num_elements;
+};
+
+enum ProjectBinField : std::uint32_t
+{
+  ProjectBinField_Name                   = (1u << 0),
+  ProjectBinField_LastSavedPath          = (1u << 1),
+  ProjectBinField_ImageLibrary           = (1u << 2),
+  ProjectBinField_Animations             = (1u << 3),
+  ProjectBinField_EditUUID               = (1u << 4),
+  ProjectBinField_SelectedAnimation      = (1u << 5),
+  ProjectBinField_SelectedFrame          = (1u << 6),
+  ProjectBinField_SpriteSheetImageSize   = (1u << 7),
+  ProjectBinField_SpriteSheetFrameSize   = (1u << 8),
+  ProjectBinField_AtlasPackingMode       = (1u << 9),
+  ProjectBinField_MaxPageSize            = (1u << 10),
+  ProjectBinField_TrimTransparentBorders = (1u << 11),
+  ProjectBinField_PremultipliedAlpha     = (1u << 12),
+};
+
+enum ProjectBinNodeType : std::uint32_t
+{
+  ProjectBinNodeType_Folder = 0,
+  ProjectBinNodeType_Image  = 1,
+};
+
+// The image library tree flattened in pre-order, a node's children directly follow it (and their children).
+struct ProjectBinLibraryNode
+{
+  std::uint32_t         type;          //!< 'ProjectBinNodeType'.
+  std::uint32_t         is_expanded;   //!< Folders only, 0 or 1.
+  ProjectBinArray<char> text;          //!< Folder name or image path relative to the project, utf-8.
+  std::uint32_t         num_children;  //!< Folders only, direct children.
+  std::uint32_t         reserved;      //!<
+};
+
+struct ProjectBinFrame
+{
+  ProjectBinArray<char> rel_path;    //!< Relative to the project, utf-8. Frames of the same image share the bytes.
+  double                frame_time;  //!< Units are in seconds.
+};
+
+struct ProjectBinAnimation
+{
+  ProjectBinArray<char>            name;        //!< utf-8
+  ProjectBinArray<ProjectBinFrame> frames;      //!<
+  std::int32_t                     frame_rate;  //!< Units are in frames per second.
+  std::uint32_t                    reserved;    //!<
+};
+
+struct ProjectBinHeader
+{
+  static constexpr char          k_Magic[] = "SRSP";
+  static constexpr std::uint32_t k_Version = 1u;
+
+  char                                   magic[4];                  //!< Is required to be the ASCII bytes "SRSP".
+  std::uint32_t                          version;                   //!< Must be 'k_Version'.
+  std::uint32_t                          file_size;                 //!< Size of the whole file.
+  std::uint32_t                          fields;                    //!< 'ProjectBinField' flags of the fields below that were in the json.
+  std::uint8_t                           edit_uuid[16];             //!< RFC 4122 byte order.
+  std::int32_t                           sprite_sheet_image_size;   //!<
+  std::int32_t                           sprite_sheet_frame_size;   //!<
+  std::int32_t                           atlas_packing_mode;        //!< 'AtlasPackingMode'.
+  std::int32_t                           max_page_size;             //!<
+  std::int32_t                           selected_animation;        //!<
+  std::int32_t                           selected_frame;            //!<
+  std::uint32_t                          trim_transparent_borders;  //!< 0 or 1.
+  std::uint32_t                          premultiplied_alpha;       //!< 0 or 1, was reserved (always 0) so older files read as off.
+  ProjectBinArray<char>                  name;                      //!< utf-8
+  ProjectBinArray<char>                  last_saved_path;           //!< utf-8
+  ProjectBinArray<ProjectBinLibraryNode> image_library;             //!< The first node is the (invisible) root folder.
+  ProjectBinArray<ProjectBinAnimation>   animations;                //!< In the same order as the json object's keys.
+  ProjectBinArray<char>                  extra_json;                //!< A compact json object of the keys this format does not know about.
+};
+
+static_assert(sizeof(ProjectBinArray<char>) == 8, "The file layout must not change.");
+static_assert(sizeof(ProjectBinLibraryNode) == 24, "The file layout must not change.");
+static_assert(sizeof(ProjectBinFrame) == 16, "The file layout must not change.");
+static_assert(sizeof(ProjectBinAnimation) == 24, "The file layout must not change.");
+static_assert(sizeof(ProjectBinHeader) == 104, "The file layout must not change.");
+
+// A read only view of a binary project, either a mapped file or bytes in memory.
+//
+// Nothing is checked up front past the header, each array is bounds checked as it is looked at
+// and an out of bounds one reads as empty and marks the file as corrupt.
+class ProjectBinaryFile final
+{
+ private:
+  QFile                            m_File;
+  std::unique_ptr<std::uint64_t[]> m_Bytes;      //!< A copy made by 'openData', 8 byte aligned like a mapped file.
+  const uchar*                     m_Data;       //!< Either mapped from 'm_File' or 'm_Bytes'.
+  qsizetype                        m_Size;       //!<
+  mutable bool                     m_IsCorrupt;  //!< Set by any out of bounds array.
+
+ public:
+  ProjectBinaryFile();
+
+  // True if the first bytes of `file_path` are the binary format's magic.
+  static bool isBinaryProject(const QString& file_path);
+
+  bool open(const QString& file_path, QString& out_error);
+  bool openData(const QByteArray& data, QString& out_error);
+
+  const ProjectBinHeader& header() const { return *reinterpret_cast<const ProjectBinHeader*>(m_Data); }
+  bool                    hasFields(std::uint32_t fields) const { return (header().fields & fields) == fields; }
+  bool                    isCorrupt() const { return m_IsCorrupt; }
+  QUuid                   editUUID() const;
+
+  // The image library or animations could not be stored in place so were left in 'extra_json',
+  // such a file has to be loaded through 'projectBinaryToJson' to not lose them.
+  bool requiresJson() const;
+
+  // Elements of `array` (which must be inside the file), nullptr with `out_num_elements` of 0 when it is empty or out of bounds.
+  template<typename T>
+  const T* elements(const ProjectBinArray<T>& array, std::uint32_t& out_num_elements) const
+  {
+    return static_cast<const T*>(checkedElements(&array, array.offset, array.num_elements, sizeof(T), alignof(T), out_num_elements));
+  }
+
+  QString string(const ProjectBinArray<char>& array) const;
+
+  ~ProjectBinaryFile();
+
+ private:
+  bool        openView(const uchar* data, qsizetype size, QString& out_error);
+  const void* checkedElements(const void* array, std::uint32_t offset, std::uint32_t num_elements, std::size_t element_size, std::size_t alignment, std::uint32_t& out_num_elements) const;
+};
+
+// Conversions, `projectBinaryToJson(projectBinaryFromJson(x)) == x` for any json object.
+
+QByteArray  projectBinaryFromJson(const QJsonObject& project_json);
+QJsonObject projectBinaryToJson(const ProjectBinaryFile& project);
+
+#endif  // SR_PROJECT_BINARY_HPP
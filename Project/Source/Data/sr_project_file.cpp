@@ -0,0 +1,256 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_project_file.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_project_file.hpp"
+
+#include "Data/sr_project_binary.hpp"  // ProjectBinaryFile
+
+#include <QFile>          // QFile
+#include <QFileInfo>      // QFileInfo
+#include <QImageReader>   // QImageReader
+#include <QJsonArray>     // QJsonArray
+#include <QJsonDocument>  // QJsonDocument
+#include <QJsonObject>    // QJsonObject
+#include <QMap>           // QMap<K, V>
+
+#include <algorithm>  // clamp
+
+// Mirrors 'ImageLibrary::addImage', duplicates and files that are not images are skipped.
+static void addImage(ProjectFile& project, QMap<QString, int>& abs_to_index, const QString& img_path)
+{
+  if (!abs_to_index.contains(img_path) && !QImageReader(img_path).format().isEmpty())
+  {
+    abs_to_index.insert(img_path, project.abs_image_paths.size());
+    project.abs_image_paths.push_back(img_path);
+  }
+}
+
+// Mirrors 'ImageLibrary::deserializeImpl', images are indexed in the order the tree lists them.
+static void readImageLibrary(ProjectFile& project, QMap<QString, int>& abs_to_index, const QJsonObject& data)
+{
+  if (data["type"] == "folder")
+  {
+    const QJsonArray items = data["items"].toArray();
+
+    for (const auto& item : items)
+    {
+      readImageLibrary(project, abs_to_index, item.toObject());
+    }
+  }
+  else
+  {
+    const QFileInfo file_info(project.project_folder.filePath(data["rel_path"].toString()));
+
+    addImage(project, abs_to_index, file_info.canonicalFilePath());
+  }
+}
+
+// `file_path` is only used for the project folder and errors, a binary project may be loaded through here too.
+static bool projectFileLoadJson(const QJsonObject& data, const QString& file_path, ProjectFile& out_project, QString& out_error)
+{
+  if (!data.contains("name") || !data.contains("image_library") || !data.contains("animations"))
+  {
+    out_error = QString("'%1' is missing the project name, image library or animations.").arg(file_path);
+    return false;
+  }
+
+  out_project                = ProjectFile{};
+  out_project.name           = data.value("name").toString();
+  out_project.project_folder = QFileInfo{file_path}.dir();
+  out_project.edit_uuid      = QUuid(data.value("m_EditUUID").toString("00000000-0000-0000-0000-000000000000"));
+
+  // NOTE(SR): The defaults must match the ones in the 'Project' constructor.
+  out_project.settings = AtlasBuildSettings{
+   atlasPackingModeFromInt(data.value("m_AtlasPackingMode").toInt(int(AtlasPackingMode::Grid))),
+   data.value("m_SpriteSheetFrameSize").toInt(256),
+   data.value("m_SpriteSheetImageSize").toInt(2048),
+   std::clamp(data.value("m_MaxPageSize").toInt(8192), 1, k_MaxAtlasPageSize),
+   k_AtlasFramePadding,
+   data.value("m_TrimTransparentBorders").toBool(false),
+   data.value("m_PremultipliedAlpha").toBool(false),
+  };
+
+  if (out_project.edit_uuid.isNull())
+  {
+    out_project.edit_uuid = QUuid::createUuid();
+  }
+
+  QMap<QString, int> abs_to_index = {};
+
+  readImageLibrary(out_project, abs_to_index, data.value("image_library").toObject());
+
+  const QJsonObject animation_data = data.value("animations").toObject();
+
+  for (const auto& animation_data_key : animation_data.keys())
+  {
+    const QJsonObject     anim               = animation_data[animation_data_key].toObject();
+    const QJsonArray      frames_data        = anim["frames"].toArray();
+    const double          default_frame_time = 1.0 / double(anim["frame_rate"].toInt());
+    ProjectFileAnimation& dst_anim           = out_project.animations.emplace_back();
+
+    dst_anim.name = animation_data_key;
+    dst_anim.frames.reserve(frames_data.size());
+
+    for (const auto& frame : frames_data)
+    {
+      const QJsonObject frame_data  = frame.toObject();
+      const QString     abs_path    = out_project.project_folder.absoluteFilePath(frame_data["rel_path"].toString());
+      const int         image_index = abs_to_index.value(abs_path, -1);
+
+      // Same as the editor, frames of images that are no longer in the library are dropped.
+      if (image_index != -1)
+      {
+        dst_anim.frames.push_back(ProjectFileFrame{image_index, float(frame_data["frame_time"].toDouble(default_frame_time))});
+      }
+    }
+  }
+
+  return true;
+}
+
+// Same as the json path of 'projectFileLoad' but read in place, the nodes are already in the order 'readImageLibrary' visits them.
+static bool projectFileLoadBinary(const QString& file_path, ProjectFile& out_project, QString& out_error)
+{
+  ProjectBinaryFile file;
+
+  if (!file.open(file_path, out_error))
+  {
+    return false;
+  }
+
+  if (file.requiresJson())
+  {
+    return projectFileLoadJson(projectBinaryToJson(file), file_path, out_project, out_error);
+  }
+
+  const ProjectBinHeader& header = file.header();
+
+  if (!file.hasFields(ProjectBinField_Name | ProjectBinField_ImageLibrary | ProjectBinField_Animations))
+  {
+    out_error = QString("'%1' is missing the project name, image library or animations.").arg(file_path);
+    return false;
+  }
+
+  out_project                = ProjectFile{};
+  out_project.name           = file.string(header.name);
+  out_project.project_folder = QFileInfo{file_path}.dir();
+  out_project.edit_uuid      = file.hasFields(ProjectBinField_EditUUID) ? file.editUUID() : QUuid();
+
+  // NOTE(SR): The defaults must match the ones in the 'Project' constructor.
+  out_project.settings = AtlasBuildSettings{
+   atlasPackingModeFromInt(file.hasFields(ProjectBinField_AtlasPackingMode) ? header.atlas_packing_mode : int(AtlasPackingMode::Grid)),
+   file.hasFields(ProjectBinField_SpriteSheetFrameSize) ? header.sprite_sheet_frame_size : 256,
+   file.hasFields(ProjectBinField_SpriteSheetImageSize) ? header.sprite_sheet_image_size : 2048,
+   std::clamp(file.hasFields(ProjectBinField_MaxPageSize) ? header.max_page_size : 8192, 1, k_MaxAtlasPageSize),
+   k_AtlasFramePadding,
+   file.hasFields(ProjectBinField_TrimTransparentBorders) && header.trim_transparent_borders != 0u,
+   file.hasFields(ProjectBinField_PremultipliedAlpha) && header.premultiplied_alpha != 0u,
+  };
+
+  if (out_project.edit_uuid.isNull())
+  {
+    out_project.edit_uuid = QUuid::createUuid();
+  }
+
+  QMap<QString, int> abs_to_index = {};
+
+  std::uint32_t                      num_nodes = 0u;
+  const ProjectBinLibraryNode* const nodes     = file.elements(header.image_library, num_nodes);
+
+  for (std::uint32_t i = 0; i < num_nodes; ++i)
+  {
+    if (nodes[i].type == ProjectBinNodeType_Image)
+    {
+      const QFileInfo file_info(out_project.project_folder.filePath(file.string(nodes[i].text)));
+
+      addImage(out_project, abs_to_index, file_info.canonicalFilePath());
+    }
+  }
+
+  std::uint32_t                    num_animations = 0u;
+  const ProjectBinAnimation* const animations     = file.elements(header.animations, num_animations);
+
+  out_project.animations.reserve(num_animations);
+
+  for (std::uint32_t i = 0; i < num_animations; ++i)
+  {
+    std::uint32_t                num_frames = 0u;
+    const ProjectBinFrame* const frames     = file.elements(animations[i].frames, num_frames);
+    ProjectFileAnimation&        dst_anim   = out_project.animations.emplace_back();
+
+    dst_anim.name = file.string(animations[i].name);
+    dst_anim.frames.reserve(num_frames);
+
+    for (std::uint32_t j = 0; j < num_frames; ++j)
+    {
+      const QString abs_path    = out_project.project_folder.absoluteFilePath(file.string(frames[j].rel_path));
+      const int     image_index = abs_to_index.value(abs_path, -1);
+
+      if (image_index != -1)
+      {
+        dst_anim.frames.push_back(ProjectFileFrame{image_index, float(frames[j].frame_time)});
+      }
+    }
+  }
+
+  if (file.isCorrupt())
+  {
+    out_error = QString("'%1' is not a valid project: an array is out of bounds.").arg(file_path);
+    return false;
+  }
+
+  return true;
+}
+
+bool projectFileLoad(const QString& file_path, ProjectFile& out_project, QString& out_error)
+{
+  if (ProjectBinaryFile::isBinaryProject(file_path))
+  {
+    return projectFileLoadBinary(file_path, out_project, out_error);
+  }
+
+  QFile file(file_path);
+
+  if (!file.open(QFile::ReadOnly))
+  {
+    out_error = QString("Failed to open '%1': %2").arg(file_path, file.errorString());
+    return false;
+  }
+
+  QJsonParseError     parse_error = {};
+  const QJsonDocument json_doc    = QJsonDocument::fromJson(file.readAll(), &parse_error);
+
+  if (!json_doc.isObject())
+  {
+    out_error = QString("'%1' is not a valid project: %2").arg(file_path, parse_error.errorString());
+    return false;
+  }
+
+  return projectFileLoadJson(json_doc.object(), file_path, out_project, out_error);
+}
+
+std::vector<AtlasAnimation> projectFileAtlasAnimations(const ProjectFile& project, const AtlasLayout& layout)
+{
+  std::vector<AtlasAnimation> result = {};
+  result.reserve(project.animations.size());
+
+  for (const ProjectFileAnimation& src_anim : project.animations)
+  {
+    AtlasAnimation& dst_anim = result.emplace_back();
+
+    dst_anim.name = src_anim.name;
+    dst_anim.frames.reserve(src_anim.frames.size());
+
+    for (const ProjectFileFrame& frame : src_anim.frames)
+    {
+      dst_anim.frames.push_back(AtlasAnimationFrame{layout.image_to_uv[frame.image_index], frame.frame_time});
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,54 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_project_file.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_PROJECT_FILE_HPP
+#define SR_PROJECT_FILE_HPP
+
+#include "Data/sr_atlas_builder.hpp"  // AtlasBuildSettings
+
+#include <QDir>     // QDir
+#include <QString>  // QString
+#include <QUuid>    // QUuid
+#include <QVector>  // QVector<T>
+
+#include <vector>  // vector<T>
+
+// NOTE(SR):
+//   A read only view of a '.srsmproj.json' (or '.srsmproj.bin') for tools that run without the editor,
+//   'Project' / 'ImageLibrary' are tied to their widgets so can not be used there.
+
+struct ProjectFileFrame final
+{
+  int   image_index;  //!< Index into 'ProjectFile::abs_image_paths'.
+  float frame_time;   //!< Units are in seconds.
+};
+
+struct ProjectFileAnimation final
+{
+  QString                       name;
+  std::vector<ProjectFileFrame> frames;
+};
+
+struct ProjectFile final
+{
+  QString                           name;
+  QDir                              project_folder;
+  QUuid                             edit_uuid;
+  QVector<QString>                  abs_image_paths;  //!< In the same order as 'ImageLibrary::loadedImageList' would have them.
+  std::vector<ProjectFileAnimation> animations;       //!< In the same order as the editor's animation list.
+  AtlasBuildSettings                settings;
+};
+
+// Reads the project at `file_path`, the same way 'Project::open' would.
+// Returns false (with a reason in `out_error`) if the file is not a valid project.
+bool projectFileLoad(const QString& file_path, ProjectFile& out_project, QString& out_error);
+
+// The animations of `project` with each frame mapped to its UV frame in `layout`.
+std::vector<AtlasAnimation> projectFileAtlasAnimations(const ProjectFile& project, const AtlasLayout& layout);
+
+#endif  // SR_PROJECT_FILE_HPP
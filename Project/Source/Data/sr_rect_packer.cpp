@@ -0,0 +1,549 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_rect_packer.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+// References:
+//   [https://github.com/juj/RectangleBinPack/blob/master/RectangleBinPack.pdf]
+//
+
+#include "sr_rect_packer.hpp"
+
+#include <algorithm>  // any_of, clamp, max, min, stable_sort
+#include <climits>    // INT_MAX
+#include <cstdint>    // int64_t
+
+// NOTE(SR): Number of bin widths tried by `packRects`, each one is a full pack.
+static constexpr int k_NumWidthCandidates = 16;
+
+static bool rectContains(const PackerRect& a, const PackerRect& b)
+{
+  return b.x >= a.x && b.y >= a.y &&
+         b.x + b.width <= a.x + a.width &&
+         b.y + b.height <= a.y + a.height;
+}
+
+static bool rectIntersects(const PackerRect& a, const PackerRect& b)
+{
+  return a.x < b.x + b.width && b.x < a.x + a.width &&
+         a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+const char* atlasPackingModeName(AtlasPackingMode mode)
+{
+  switch (mode)
+  {
+    case AtlasPackingMode::Grid: return "Grid";
+    case AtlasPackingMode::MaxRects: return "MaxRects";
+    case AtlasPackingMode::Skyline: return "Skyline";
+  }
+
+  return "Unknown";
+}
+
+AtlasPackingMode atlasPackingModeFromInt(int value)
+{
+  switch (AtlasPackingMode(value))
+  {
+    case AtlasPackingMode::Grid:
+    case AtlasPackingMode::MaxRects:
+    case AtlasPackingMode::Skyline: return AtlasPackingMode(value);
+  }
+
+  return AtlasPackingMode::Grid;
+}
+
+// Empty rects are left empty so they do not take up any space.
+static PackerRect rectPadded(const PackerRect& rect, int padding)
+{
+  if (rect.width <= 0 || rect.height <= 0)
+  {
+    return PackerRect{0, 0, 0, 0, 0};
+  }
+
+  return PackerRect{0, 0, rect.width + padding, rect.height + padding, 0};
+}
+
+// MaxRects
+
+static void maxRectsSplitFreeRect(const PackerRect& free_rect, const PackerRect& used, std::vector<PackerRect>& out_new_rects)
+{
+  const int free_right  = free_rect.x + free_rect.width;
+  const int free_bottom = free_rect.y + free_rect.height;
+  const int used_right  = used.x + used.width;
+  const int used_bottom = used.y + used.height;
+
+  if (used.x > free_rect.x)
+  {
+    out_new_rects.push_back(PackerRect{free_rect.x, free_rect.y, used.x - free_rect.x, free_rect.height, 0});
+  }
+
+  if (used_right < free_right)
+  {
+    out_new_rects.push_back(PackerRect{used_right, free_rect.y, free_right - used_right, free_rect.height, 0});
+  }
+
+  if (used.y > free_rect.y)
+  {
+    out_new_rects.push_back(PackerRect{free_rect.x, free_rect.y, free_rect.width, used.y - free_rect.y, 0});
+  }
+
+  if (used_bottom < free_bottom)
+  {
+    out_new_rects.push_back(PackerRect{free_rect.x, used_bottom, free_rect.width, free_bottom - used_bottom, 0});
+  }
+}
+
+bool packRectsMaxRects(std::vector<PackerRect>& rects, int bin_width, int bin_height)
+{
+  std::vector<PackerRect> free_rects = {PackerRect{0, 0, bin_width, bin_height, 0}};
+  std::vector<PackerRect> new_rects  = {};
+  bool                    all_fit    = true;
+
+  for (PackerRect& rect : rects)
+  {
+    if (rect.width <= 0 || rect.height <= 0)
+    {
+      rect.x    = 0;
+      rect.y    = 0;
+      rect.page = 0;
+      continue;
+    }
+
+    int best_short_side = INT_MAX;
+    int best_long_side  = INT_MAX;
+    int best_index      = -1;
+
+    for (int i = 0; i < int(free_rects.size()); ++i)
+    {
+      const PackerRect& free_rect = free_rects[i];
+
+      if (rect.width <= free_rect.width && rect.height <= free_rect.height)
+      {
+        const int leftover_h = free_rect.width - rect.width;
+        const int leftover_v = free_rect.height - rect.height;
+        const int short_side = std::min(leftover_h, leftover_v);
+        const int long_side  = std::max(leftover_h, leftover_v);
+
+        if (short_side < best_short_side || (short_side == best_short_side && long_side < best_long_side))
+        {
+          best_short_side = short_side;
+          best_long_side  = long_side;
+          best_index      = i;
+        }
+      }
+    }
+
+    if (best_index == -1)
+    {
+      rect.page = -1;
+      all_fit   = false;
+      continue;
+    }
+
+    rect.x    = free_rects[best_index].x;
+    rect.y    = free_rects[best_index].y;
+    rect.page = 0;
+
+    // Split every free rect the new rect overlaps into up to four maximal rects.
+
+    new_rects.clear();
+
+    for (int i = 0; i < int(free_rects.size());)
+    {
+      if (rectIntersects(free_rects[i], rect))
+      {
+        maxRectsSplitFreeRect(free_rects[i], rect, new_rects);
+        free_rects[i] = free_rects.back();
+        free_rects.pop_back();
+      }
+      else
+      {
+        ++i;
+      }
+    }
+
+    // NOTE(SR): Only the newly split rects can be contained by / contain another free rect,
+    //           the untouched free rects were already pruned against each other.
+
+    for (int i = 0; i < int(new_rects.size());)
+    {
+      bool is_contained = false;
+
+      for (int j = 0; j < int(new_rects.size()) && !is_contained; ++j)
+      {
+        if (i != j && rectContains(new_rects[j], new_rects[i]))
+        {
+          // Of two identical rects only the later one is kept.
+          is_contained = !rectContains(new_rects[i], new_rects[j]) || i < j;
+        }
+      }
+
+      for (const PackerRect& free_rect : free_rects)
+      {
+        if (is_contained)
+        {
+          break;
+        }
+
+        is_contained = rectContains(free_rect, new_rects[i]);
+      }
+
+      if (is_contained)
+      {
+        new_rects.erase(new_rects.begin() + i);
+      }
+      else
+      {
+        ++i;
+      }
+    }
+
+    for (int i = 0; i < int(free_rects.size());)
+    {
+      const bool is_contained = std::any_of(
+       new_rects.begin(), new_rects.end(), [&free_rect = free_rects[i]](const PackerRect& new_rect) {
+         return rectContains(new_rect, free_rect);
+       });
+
+      if (is_contained)
+      {
+        free_rects[i] = free_rects.back();
+        free_rects.pop_back();
+      }
+      else
+      {
+        ++i;
+      }
+    }
+
+    free_rects.insert(free_rects.end(), new_rects.begin(), new_rects.end());
+  }
+
+  return all_fit;
+}
+
+// Skyline
+
+namespace
+{
+  struct SkylineNode final
+  {
+    int x;
+    int y;
+    int width;
+  };
+}  // namespace
+
+// Returns the y the rect would rest at if its left edge was put on `skyline[index]`, -1 if it does not fit.
+static int skylineFitY(const std::vector<SkylineNode>& skyline, int index, int width, int height, int bin_width, int bin_height)
+{
+  const int x = skyline[index].x;
+
+  if (x + width > bin_width)
+  {
+    return -1;
+  }
+
+  int width_left = width;
+  int y          = skyline[index].y;
+
+  while (width_left > 0)
+  {
+    y = std::max(y, skyline[index].y);
+
+    if (y + height > bin_height)
+    {
+      return -1;
+    }
+
+    width_left -= skyline[index].width;
+    ++index;
+  }
+
+  return y;
+}
+
+bool packRectsSkyline(std::vector<PackerRect>& rects, int bin_width, int bin_height)
+{
+  std::vector<SkylineNode> skyline = {SkylineNode{0, 0, bin_width}};
+  bool                     all_fit = true;
+
+  for (PackerRect& rect : rects)
+  {
+    if (rect.width <= 0 || rect.height <= 0)
+    {
+      rect.x    = 0;
+      rect.y    = 0;
+      rect.page = 0;
+      continue;
+    }
+
+    int best_bottom = INT_MAX;
+    int best_width  = INT_MAX;
+    int best_index  = -1;
+    int best_y      = 0;
+
+    for (int i = 0; i < int(skyline.size()); ++i)
+    {
+      const int y = skylineFitY(skyline, i, rect.width, rect.height, bin_width, bin_height);
+
+      if (y >= 0)
+      {
+        const int bottom = y + rect.height;
+
+        if (bottom < best_bottom || (bottom == best_bottom && skyline[i].width < best_width))
+        {
+          best_bottom = bottom;
+          best_width  = skyline[i].width;
+          best_index  = i;
+          best_y      = y;
+        }
+      }
+    }
+
+    if (best_index == -1)
+    {
+      rect.page = -1;
+      all_fit   = false;
+      continue;
+    }
+
+    rect.x    = skyline[best_index].x;
+    rect.y    = best_y;
+    rect.page = 0;
+
+    skyline.insert(skyline.begin() + best_index, SkylineNode{rect.x, best_bottom, rect.width});
+
+    // Shrink / remove the nodes now covered by the new node.
+
+    const int new_right = rect.x + rect.width;
+
+    for (int i = best_index + 1; i < int(skyline.size());)
+    {
+      SkylineNode& node = skyline[i];
+
+      if (node.x >= new_right)
+      {
+        break;
+      }
+
+      const int shrink = new_right - node.x;
+
+      if (node.width <= shrink)
+      {
+        skyline.erase(skyline.begin() + i);
+      }
+      else
+      {
+        node.x += shrink;
+        node.width -= shrink;
+        break;
+      }
+    }
+
+    for (int i = 0; i < int(skyline.size()) - 1;)
+    {
+      if (skyline[i].y == skyline[i + 1].y)
+      {
+        skyline[i].width += skyline[i + 1].width;
+        skyline.erase(skyline.begin() + i + 1);
+      }
+      else
+      {
+        ++i;
+      }
+    }
+  }
+
+  return all_fit;
+}
+
+// Driver
+
+namespace
+{
+  struct PagePackResult final
+  {
+    std::vector<PackerRect> rects;        //!< Parallel to the rects passed in, padded.
+    std::int64_t            packed_area;  //!< Sum of the area of the rects that fit.
+    std::int64_t            used_area;    //!< Area of the bin cropped to the rects that fit.
+    int                     used_width;
+    int                     used_height;
+  };
+}  // namespace
+
+// Packs as many of `page_rects` (already padded) as it can into one page no taller than `max_bin_height`,
+// trying a few widths up to `max_bin_width` and keeping the one that fits the most / wastes the least.
+static PagePackResult packPage(AtlasPackingMode mode, const std::vector<PackerRect>& page_rects, int max_bin_width, int max_bin_height)
+{
+  int          widest_rect = 0;
+  int          total_width = 0;
+  std::int64_t total_area  = 0;
+
+  for (const PackerRect& rect : page_rects)
+  {
+    widest_rect = std::max(widest_rect, rect.width);
+    total_width += rect.width;
+    total_area += std::int64_t(rect.width) * rect.height;
+  }
+
+  const int max_width = std::max(widest_rect, std::min(max_bin_width, total_width));
+  const int min_width = std::max(widest_rect, max_width / 2);
+
+  PagePackResult          best       = {{}, -1, -1, 0, 0};
+  std::vector<PackerRect> candidate  = {};
+  int                     last_width = -1;
+
+  for (int i = 0; i < k_NumWidthCandidates; ++i)
+  {
+    const int bin_width = max_width - int(std::int64_t(max_width - min_width) * i / (k_NumWidthCandidates - 1));
+
+    if (bin_width == last_width)
+    {
+      continue;
+    }
+
+    last_width = bin_width;
+
+    // Try the smallest height that could hold everything then grow by ~6% until it all fits,
+    // this keeps MaxRects from spreading rects down a needlessly tall bin.
+
+    int bin_height = std::clamp(int((total_area + bin_width - 1) / bin_width), 1, max_bin_height);
+
+    for (;;)
+    {
+      candidate = page_rects;
+
+      const bool all_fit = mode == AtlasPackingMode::Skyline ?
+                            packRectsSkyline(candidate, bin_width, bin_height) :
+                            packRectsMaxRects(candidate, bin_width, bin_height);
+
+      if (all_fit || bin_height >= max_bin_height)
+      {
+        break;
+      }
+
+      bin_height = std::min(max_bin_height, bin_height + std::max(bin_height / 16, 1));
+    }
+
+    int          used_width  = 0;
+    int          used_height = 0;
+    std::int64_t packed_area = 0;
+
+    for (const PackerRect& rect : candidate)
+    {
+      if (rect.page == 0)
+      {
+        used_width  = std::max(used_width, rect.x + rect.width);
+        used_height = std::max(used_height, rect.y + rect.height);
+        packed_area += std::int64_t(rect.width) * rect.height;
+      }
+    }
+
+    const std::int64_t used_area = std::int64_t(used_width) * used_height;
+
+    if (packed_area > best.packed_area || (packed_area == best.packed_area && used_area < best.used_area))
+    {
+      best = PagePackResult{candidate, packed_area, used_area, used_width, used_height};
+    }
+  }
+
+  return best;
+}
+
+void packRects(AtlasPackingMode mode, std::vector<PackerRect>& rects, int max_width, int max_height, int padding, std::vector<PackerPage>& out_pages)
+{
+  const int num_rects = int(rects.size());
+
+  out_pages.clear();
+
+  // The padding is added to the right / bottom of each rect and to the bin so the last column / row does not pay for it.
+
+  int tallest_rect = 0;
+  int total_height = 0;
+
+  std::vector<int> remaining = {};
+  remaining.reserve(num_rects);
+
+  for (int i = 0; i < num_rects; ++i)
+  {
+    PackerRect&      rect   = rects[i];
+    const PackerRect padded = rectPadded(rect, padding);
+
+    rect.x    = 0;
+    rect.y    = 0;
+    rect.page = 0;
+
+    if (padded.width > 0)
+    {
+      tallest_rect = std::max(tallest_rect, padded.height);
+      total_height += padded.height;
+      remaining.push_back(i);
+    }
+  }
+
+  if (remaining.empty())
+  {
+    return;
+  }
+
+  // Big to small packs much tighter than the order in the timeline.
+
+  std::stable_sort(remaining.begin(), remaining.end(), [&rects](int a, int b) {
+    const PackerRect& lhs = rects[a];
+    const PackerRect& rhs = rects[b];
+
+    if (lhs.height != rhs.height)
+    {
+      return lhs.height > rhs.height;
+    }
+
+    return lhs.width > rhs.width;
+  });
+
+  // NOTE(SR): A page is always big enough for the biggest rect so that every page packs at least one.
+  const int max_bin_width  = max_width + padding;
+  const int max_bin_height = max_height > 0 ? std::max(max_height + padding, tallest_rect) : total_height;
+
+  std::vector<PackerRect> page_rects = {};
+
+  while (!remaining.empty())
+  {
+    const int page_index = int(out_pages.size());
+
+    page_rects.clear();
+
+    for (const int rect_index : remaining)
+    {
+      page_rects.push_back(rectPadded(rects[rect_index], padding));
+    }
+
+    const PagePackResult page = packPage(mode, page_rects, max_bin_width, max_bin_height);
+
+    std::vector<int> overflow = {};
+
+    for (std::size_t i = 0; i < remaining.size(); ++i)
+    {
+      PackerRect&       rect        = rects[remaining[i]];
+      const PackerRect& packed_rect = page.rects[i];
+
+      if (packed_rect.page == 0)
+      {
+        rect.x    = packed_rect.x;
+        rect.y    = packed_rect.y;
+        rect.page = page_index;
+      }
+      else
+      {
+        overflow.push_back(remaining[i]);
+      }
+    }
+
+    out_pages.push_back(PackerPage{std::max(page.used_width - padding, 0), std::max(page.used_height - padding, 0)});
+
+    remaining = std::move(overflow);
+  }
+}
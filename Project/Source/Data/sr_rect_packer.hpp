@@ -0,0 +1,54 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_rect_packer.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_RECT_PACKER_HPP
+#define SR_RECT_PACKER_HPP
+
+#include <vector>  // vector<T>
+
+// NOTE(SR): Serialized as an int in the project file, only append to this list.
+enum class AtlasPackingMode
+{
+  Grid,      //!< Every frame gets a 'frame size' square cell.
+  MaxRects,  //!< Maximal rectangles with the best-short-side-fit heuristic.
+  Skyline,   //!< Skyline with the bottom-left heuristic.
+};
+
+const char*      atlasPackingModeName(AtlasPackingMode mode);
+AtlasPackingMode atlasPackingModeFromInt(int value);  // A value that is not one of the modes (from a newer / corrupt file) is 'Grid'.
+
+struct PackerRect final
+{
+  int x;       //!< Output.
+  int y;       //!< Output.
+  int width;   //!< Input.
+  int height;  //!< Input.
+  int page;    //!< Output.
+};
+
+struct PackerPage final
+{
+  int width;
+  int height;
+};
+
+// Single bin packers, the rects are placed in the order given.
+// Rects that do not fit are skipped and get a `page` of -1 (the rest get 0),
+// returns false if any of the rects could not fit in the bin.
+
+bool packRectsMaxRects(std::vector<PackerRect>& rects, int bin_width, int bin_height);
+bool packRectsSkyline(std::vector<PackerRect>& rects, int bin_width, int bin_height);
+
+// Packs `rects` into as few pages as it can, each page is the bin that wastes the least area
+// with a width no larger than `max_width` and a height no larger than `max_height`
+// (unless a single rect is bigger than that), a `max_height` of 0 or less means a single page.
+// `rects` are written out in the same order, the size of each page is returned through `out_pages`.
+// `padding` is the number of empty pixels kept between neighboring rects.
+void packRects(AtlasPackingMode mode, std::vector<PackerRect>& rects, int max_width, int max_height, int padding, std::vector<PackerPage>& out_pages);
+
+#endif  // SR_RECT_PACKER_HPP
@@ -8,6 +8,9 @@
 
 #include "sr_settings.hpp"
 
+#include "sr_build_cache.hpp"  // buildCacheDefaultDir
+#include "sr_png_encoder.hpp"  // k_PngDefaultCompressionLevel
+
 struct RecentFileEntry final
 {
   QString name;
@@ -17,13 +20,23 @@ struct RecentFileEntry final
 static constexpr const char* const k_OrganizationName = "BluFedora";
 static constexpr const char* const k_ApplicationName  = "SR-Spritesheet Manager";
 
+static constexpr const char* const k_DecodeThreadCountKey  = "Atlas/DecodeThreadCount";
+static constexpr const char* const k_ImageCacheBudgetMBKey = "Atlas/ImageCacheBudgetMB";
+static constexpr const char* const k_BuildCacheDirKey      = "Atlas/BuildCacheDir";
+static constexpr const char* const k_PngCompressionKey     = "Export/PngCompressionLevel";
+static constexpr const char* const k_EncodeThreadCountKey  = "Export/EncodeThreadCount";
+static constexpr const char* const k_LiveReloadCompressKey = "LiveReload/Compression";
+static constexpr const char* const k_UndoHistoryBudgetKey  = "History/MemoryBudgetMB";
+static constexpr int               k_DefaultCacheBudgetMB  = 1024;
+static constexpr int               k_DefaultUndoBudgetMB   = 256;
+
 static std::vector<RecentFileEntry> s_RecentFiles = {};
 
 void Settings::openRecentFiles()
 {
-  Settings settings;
-
-  qDebug() << "Loading settings from: " << settings.fileName() << "\n";
+  Settings settings;
+
+  qDebug() << "Loading settings from: " << settings.fileName() << "\n";
 
   settings.beginGroup("WelcomeWindow");
 
@@ -79,7 +92,90 @@ void Settings::saveRecentFile()
   settings.endGroup();
 }
 
-Settings::Settings() :
-  QSettings(QSettings::IniFormat /* Using the windows registry is bad when upgrading Qt versions. */, QSettings::UserScope, k_OrganizationName, k_ApplicationName, nullptr)
+int Settings::decodeThreadCount()
+{
+  Settings settings;
+
+  // 0 means let the atlas builder pick based on the number of cores.
+  return settings.value(k_DecodeThreadCountKey, 0).toInt();
+}
+
+void Settings::setDecodeThreadCount(int value)
+{
+  Settings settings;
+
+  settings.setValue(k_DecodeThreadCountKey, value);
+}
+
+int Settings::imageCacheBudgetMB()
+{
+  Settings settings;
+
+  // 0 means no limit on the amount of decoded images kept around.
+  return settings.value(k_ImageCacheBudgetMBKey, k_DefaultCacheBudgetMB).toInt();
+}
+
+int Settings::undoHistoryBudgetMB()
+{
+  Settings settings;
+
+  // 0 means the undo history is never compressed or moved to disk.
+  return settings.value(k_UndoHistoryBudgetKey, k_DefaultUndoBudgetMB).toInt();
+}
+
+QString Settings::buildCacheDir()
+{
+  Settings settings;
+
+  // An empty path turns off the build cache.
+  return settings.value(k_BuildCacheDirKey, buildCacheDefaultDir()).toString();
+}
+
+int Settings::pngCompressionLevel()
+{
+  Settings settings;
+
+  return settings.value(k_PngCompressionKey, k_PngDefaultCompressionLevel).toInt();
+}
+
+void Settings::setPngCompressionLevel(int value)
+{
+  Settings settings;
+
+  settings.setValue(k_PngCompressionKey, value);
+}
+
+int Settings::encodeThreadCount()
+{
+  Settings settings;
+
+  // 0 means let the png encoder pick based on the number of cores.
+  return settings.value(k_EncodeThreadCountKey, 0).toInt();
+}
+
+void Settings::setEncodeThreadCount(int value)
+{
+  Settings settings;
+
+  settings.setValue(k_EncodeThreadCountKey, value);
+}
+
+int Settings::liveReloadCompression()
+{
+  Settings settings;
+
+  // A 'LiveReloadCodec', only used with clients that said they can decode it.
+  return settings.value(k_LiveReloadCompressKey, 0).toInt();
+}
+
+void Settings::setLiveReloadCompression(int value)
+{
+  Settings settings;
+
+  settings.setValue(k_LiveReloadCompressKey, value);
+}
+
+Settings::Settings() :
+  QSettings(QSettings::IniFormat /* Using the windows registry is bad when upgrading Qt versions. */, QSettings::UserScope, k_OrganizationName, k_ApplicationName, nullptr)
 {
 }
@@ -14,9 +14,20 @@
 class Settings : public QSettings
 {
  public:
-  static void openRecentFiles();
-  static void addRecentFile(const QString& name, const QString& path);
-  static void saveRecentFile();
+  static void    openRecentFiles();
+  static void    addRecentFile(const QString& name, const QString& path);
+  static void    saveRecentFile();
+  static int     decodeThreadCount();
+  static void    setDecodeThreadCount(int value);
+  static int     imageCacheBudgetMB();
+  static int     undoHistoryBudgetMB();
+  static QString buildCacheDir();
+  static int     pngCompressionLevel();
+  static void    setPngCompressionLevel(int value);
+  static int     encodeThreadCount();
+  static void    setEncodeThreadCount(int value);
+  static int     liveReloadCompression();
+  static void    setLiveReloadCompression(int value);
 
  public:
   Settings();
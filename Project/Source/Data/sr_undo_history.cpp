@@ -0,0 +1,359 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_undo_history.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_undo_history.hpp"
+
+#include "UI/sr_image_library.hpp"  // AnimationFrameSource
+
+#include <QCryptographicHash>  // QCryptographicHash
+#include <QDataStream>         // QDataStream
+#include <QDir>                // QDir
+
+#include <algorithm>  // find_if, lower_bound
+#include <iterator>   // next, prev
+#include <memory>     // make_shared
+#include <utility>    // move
+
+#if defined(SR_HAS_ZSTD)
+#include <zstd.h>  // ZSTD_compress, ZSTD_compressBound, ZSTD_decompress, ZSTD_getFrameContentSize
+#endif
+
+// NOTE(SR):
+//   The packed state is a QDataStream of the 'UndoState' fields with each frame stored as its image's path,
+//   'Project::restoreUndoState' looks every frame source up by path anyway. Paths repeat a lot so it compresses well.
+//   zstd is used when the build found it, otherwise 'qCompress' (zlib) which is always there.
+
+static constexpr quint32 k_PackedStateVersion = 2u;
+
+#if defined(SR_HAS_ZSTD)
+static constexpr int k_ZstdCompressionLevel = 3;
+#endif
+
+std::size_t UndoState::memoryUsage() const
+{
+  std::size_t result = sizeof(UndoState) + std::size_t(name.capacity()) * sizeof(QChar) + std::size_t(image_library.capacity()) + animations.capacity() * sizeof(UndoAnimationState);
+
+  for (const UndoAnimationState& animation : animations)
+  {
+    result += std::size_t(animation.name.capacity()) * sizeof(QChar) + animation.frames.capacity() * sizeof(AnimationFrameInstance);
+  }
+
+  return result;
+}
+
+static QByteArray packState(const UndoState& state)
+{
+  QByteArray  result = {};
+  QDataStream stream(&result, QIODevice::WriteOnly);
+
+  stream << k_PackedStateVersion << quint32(state.flags) << state.name;
+  stream << quint32(state.sprite_sheet_image_size) << quint32(state.sprite_sheet_frame_size) << qint32(state.atlas_packing_mode) << quint32(state.max_page_size) << state.trim_transparent_borders << state.premultiplied_alpha;
+  stream << state.image_library << qint32(state.animation_row) << qint32(state.selected_animation) << quint32(state.animations.size());
+
+  for (const UndoAnimationState& animation : state.animations)
+  {
+    stream << animation.name << qint32(animation.frame_rate) << quint32(animation.frames.size());
+
+    for (const AnimationFrameInstance& frame : animation.frames)
+    {
+      stream << frame.full_path() << frame.frame_time;
+    }
+  }
+
+  return result;
+}
+
+static bool unpackState(const QByteArray& data, UndoState& out_state)
+{
+  QDataStream stream(data);
+  quint32     version = 0u;
+
+  stream >> version;
+
+  if (version != k_PackedStateVersion)
+  {
+    return false;
+  }
+
+  quint32 flags = 0u, sprite_sheet_image_size = 0u, sprite_sheet_frame_size = 0u, max_page_size = 0u, num_animations = 0u;
+  qint32  atlas_packing_mode = 0, animation_row = -1, selected_animation = -1;
+
+  stream >> flags >> out_state.name;
+  stream >> sprite_sheet_image_size >> sprite_sheet_frame_size >> atlas_packing_mode >> max_page_size >> out_state.trim_transparent_borders >> out_state.premultiplied_alpha;
+  stream >> out_state.image_library >> animation_row >> selected_animation >> num_animations;
+
+  out_state.flags                   = UndoActionFlags(int(flags));
+  out_state.sprite_sheet_image_size = sprite_sheet_image_size;
+  out_state.sprite_sheet_frame_size = sprite_sheet_frame_size;
+  out_state.atlas_packing_mode      = atlasPackingModeFromInt(atlas_packing_mode);
+  out_state.max_page_size           = max_page_size;
+  out_state.animation_row           = animation_row;
+  out_state.selected_animation      = selected_animation;
+
+  for (quint32 i = 0; i < num_animations && stream.status() == QDataStream::Ok; ++i)
+  {
+    UndoAnimationState& animation  = out_state.animations.emplace_back();
+    qint32              frame_rate = 0;
+    quint32             num_frames = 0u;
+
+    stream >> animation.name >> frame_rate >> num_frames;
+
+    animation.frame_rate = frame_rate;
+
+    for (quint32 j = 0; j < num_frames && stream.status() == QDataStream::Ok; ++j)
+    {
+      QString full_path  = {};
+      float   frame_time = 0.0f;
+
+      stream >> full_path >> frame_time;
+
+      animation.frames.emplace_back(std::make_shared<AnimationFrameSource>(full_path, QString()), frame_time);
+    }
+  }
+
+  return stream.status() == QDataStream::Ok;
+}
+
+static QByteArray compressBytes(const QByteArray& data)
+{
+#if defined(SR_HAS_ZSTD)
+  QByteArray        result = QByteArray(qsizetype(ZSTD_compressBound(std::size_t(data.size()))), Qt::Uninitialized);
+  const std::size_t status = ZSTD_compress(result.data(), std::size_t(result.size()), data.constData(), std::size_t(data.size()), k_ZstdCompressionLevel);
+
+  if (ZSTD_isError(status))
+  {
+    return {};
+  }
+
+  result.truncate(qsizetype(status));
+  result.squeeze();
+
+  return result;
+#else
+  return qCompress(data);
+#endif
+}
+
+static QByteArray decompressBytes(const QByteArray& data)
+{
+#if defined(SR_HAS_ZSTD)
+  const unsigned long long uncompressed_size = ZSTD_getFrameContentSize(data.constData(), std::size_t(data.size()));
+
+  if (uncompressed_size == ZSTD_CONTENTSIZE_ERROR || uncompressed_size == ZSTD_CONTENTSIZE_UNKNOWN)
+  {
+    return {};
+  }
+
+  QByteArray        result = QByteArray(qsizetype(uncompressed_size), Qt::Uninitialized);
+  const std::size_t status = ZSTD_decompress(result.data(), std::size_t(result.size()), data.constData(), std::size_t(data.size()));
+
+  return ZSTD_isError(status) || status != std::size_t(uncompressed_size) ? QByteArray() : result;
+#else
+  return qUncompress(data);
+#endif
+}
+
+UndoSpillFile::UndoSpillFile() :
+  m_File{QDir::tempPath() + "/srsm_undo_XXXXXX.bin"},
+  m_FreeBlocks{}
+{
+}
+
+qint64 UndoSpillFile::write(const QByteArray& data)
+{
+  if (!m_File.isOpen() && !m_File.open())
+  {
+    return -1;
+  }
+
+  const qint64 size       = data.size();
+  const auto   free_block = std::find_if(m_FreeBlocks.begin(), m_FreeBlocks.end(), [size](const Block& block) { return block.size >= size; });
+  qint64       offset     = m_File.size();
+
+  if (free_block != m_FreeBlocks.end())
+  {
+    offset = free_block->offset;
+
+    free_block->offset += size;
+    free_block->size -= size;
+
+    if (free_block->size == 0)
+    {
+      m_FreeBlocks.erase(free_block);
+    }
+  }
+
+  if (!m_File.seek(offset) || m_File.write(data) != size)
+  {
+    release(offset, size);
+    return -1;
+  }
+
+  return offset;
+}
+
+QByteArray UndoSpillFile::read(qint64 offset, qint64 size)
+{
+  if (!m_File.isOpen() || !m_File.seek(offset))
+  {
+    return {};
+  }
+
+  return m_File.read(size);
+}
+
+void UndoSpillFile::release(qint64 offset, qint64 size)
+{
+  if (size <= 0)
+  {
+    return;
+  }
+
+  auto block = m_FreeBlocks.insert(
+   std::lower_bound(m_FreeBlocks.begin(), m_FreeBlocks.end(), offset, [](const Block& lhs, qint64 rhs) { return lhs.offset < rhs; }),
+   Block{offset, size});
+
+  if (std::next(block) != m_FreeBlocks.end() && block->offset + block->size == std::next(block)->offset)
+  {
+    block->size += std::next(block)->size;
+    m_FreeBlocks.erase(std::next(block));
+  }
+
+  if (block != m_FreeBlocks.begin() && std::prev(block)->offset + std::prev(block)->size == block->offset)
+  {
+    std::prev(block)->size += block->size;
+    block = std::prev(m_FreeBlocks.erase(block));
+  }
+
+  // Only the end can be given back to the file system.
+  if (block->offset + block->size >= m_File.size() && m_File.resize(block->offset))
+  {
+    m_FreeBlocks.erase(block);
+  }
+}
+
+void UndoSpillFile::clear()
+{
+  m_FreeBlocks.clear();
+
+  if (m_File.isOpen())
+  {
+    m_File.resize(0);
+  }
+}
+
+UndoStateStorage::UndoStateStorage() :
+  m_State{},
+  m_Packed{},
+  m_SpillOffset{-1},
+  m_SpillSize{0},
+  m_SpillHash{},
+  m_Storage{UndoStorage::Memory}
+{
+}
+
+std::size_t UndoStateStorage::memoryUsage() const
+{
+  std::size_t result = sizeof(UndoStateStorage) + std::size_t(m_Packed.capacity()) + std::size_t(m_SpillHash.capacity());
+
+  if (m_Storage == UndoStorage::Memory)
+  {
+    result += m_State.memoryUsage() - sizeof(UndoState);
+  }
+
+  return result;
+}
+
+void UndoStateStorage::compress()
+{
+  if (m_Storage == UndoStorage::Memory)
+  {
+    QByteArray packed = compressBytes(packState(m_State));
+
+    // Left as is if it could not be compressed, it is still correct just bigger.
+    if (!packed.isEmpty())
+    {
+      m_Packed  = std::move(packed);
+      m_State   = UndoState{};
+      m_Storage = UndoStorage::Compressed;
+    }
+  }
+}
+
+bool UndoStateStorage::spill(UndoSpillFile& file)
+{
+  compress();
+
+  if (m_Storage != UndoStorage::Compressed)
+  {
+    return false;
+  }
+
+  const QByteArray hash = QCryptographicHash::hash(m_Packed, QCryptographicHash::Sha1);
+
+  // An undo / redo swaps in the other side of the action so the block is usually stale, but a redo after an undo
+  // brings back what was spilled and that need not be written a second time.
+  if (m_SpillOffset < 0 || m_SpillSize != m_Packed.size() || m_SpillHash != hash)
+  {
+    if (m_SpillOffset >= 0)
+    {
+      file.release(m_SpillOffset, m_SpillSize);
+      m_SpillOffset = -1;
+      m_SpillSize   = 0;
+      m_SpillHash   = QByteArray();
+    }
+
+    const qint64 offset = file.write(m_Packed);
+
+    if (offset < 0)
+    {
+      return false;
+    }
+
+    m_SpillOffset = offset;
+    m_SpillSize   = m_Packed.size();
+    m_SpillHash   = hash;
+  }
+
+  m_Packed  = QByteArray();
+  m_Storage = UndoStorage::Disk;
+
+  return true;
+}
+
+bool UndoStateStorage::load(UndoSpillFile& file)
+{
+  if (m_Storage == UndoStorage::Disk)
+  {
+    m_Packed  = file.read(m_SpillOffset, m_SpillSize);
+    m_Storage = UndoStorage::Compressed;
+
+    if (m_Packed.size() != m_SpillSize)
+    {
+      m_Packed.clear();
+    }
+  }
+
+  bool is_loaded = true;
+
+  if (m_Storage == UndoStorage::Compressed)
+  {
+    m_State   = UndoState{};
+    is_loaded = unpackState(decompressBytes(m_Packed), m_State);
+
+    if (!is_loaded)
+    {
+      m_State = UndoState{};
+    }
+
+    m_Packed  = QByteArray();
+    m_Storage = UndoStorage::Memory;
+  }
+
+  return is_loaded;
+}
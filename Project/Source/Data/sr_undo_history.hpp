@@ -0,0 +1,129 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_undo_history.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_UNDO_HISTORY_HPP
+#define SR_UNDO_HISTORY_HPP
+
+#include "Data/sr_animation.hpp"    // AnimationFrameInstance
+#include "Data/sr_rect_packer.hpp"  // AtlasPackingMode
+
+#include <QByteArray>      // QByteArray
+#include <QFlags>          // QFlags<T>
+#include <QString>         // QString
+#include <QTemporaryFile>  // QTemporaryFile
+
+#include <cstddef>  // size_t
+#include <vector>   // vector<T>
+
+// NOTE(SR):
+//   The undo history is kept within 'Settings::undoHistoryBudgetMB'. The states of actions that are not
+//   near the current index are packed and compressed, and when that is still over the budget the oldest ones
+//   are moved to a temp file. A state is only brought back into memory when its action is undone / redone.
+
+// What an action can change, only those parts of the project are captured for undo.
+enum UndoActionFlag
+{
+  UndoActionFlag_ModifiedSettings  = (1u << 0),  //!< The project name and quality settings.
+  UndoActionFlag_ModifiedAnimation = (1u << 1),  //!< The animation list, or just the one animation the action is scoped to.
+  UndoActionFlag_ModifiedAtlas     = (1u << 2),  //!< Nothing is captured, the atlas is regenerated after.
+  UndoActionFlag_ModifiedLibrary   = (1u << 3),  //!< The image library tree.
+  UndoActionFlag_ModifiedAll       = UndoActionFlag_ModifiedSettings | UndoActionFlag_ModifiedAtlas | UndoActionFlag_ModifiedAnimation | UndoActionFlag_ModifiedLibrary,
+  UndoActionFlag_FirstTime         = (1u << 4),
+};
+
+Q_DECLARE_FLAGS(UndoActionFlags, UndoActionFlag)
+Q_DECLARE_OPERATORS_FOR_FLAGS(UndoActionFlags)
+
+struct UndoAnimationState final
+{
+  QString                             name;
+  int                                 frame_rate;
+  std::vector<AnimationFrameInstance> frames;  //!< Each source is looked up again by path on restore since the image library may have been rebuilt.
+};
+
+// The parts of a project picked by 'flags', the rest of the fields are left empty.
+struct UndoState final
+{
+  UndoActionFlags                 flags;
+  QString                         name;
+  unsigned int                    sprite_sheet_image_size;
+  unsigned int                    sprite_sheet_frame_size;
+  AtlasPackingMode                atlas_packing_mode;
+  unsigned int                    max_page_size;
+  bool                            trim_transparent_borders;
+  bool                            premultiplied_alpha;
+  QByteArray                      image_library;       //!< Compact json of 'ImageLibrary::serialize'.
+  int                             animation_row;       //!< The animation in 'animations', -1 when it is the whole list.
+  int                             selected_animation;  //!< Only used with the whole list.
+  std::vector<UndoAnimationState> animations;          //!<
+
+  // Bytes held by this state, frame sources are shared with the image library so are not counted.
+  std::size_t memoryUsage() const;
+};
+
+// Blocks given back with 'release' are reused first fit, the file only shrinks when the freed space is at its end.
+class UndoSpillFile final
+{
+ private:
+  struct Block final
+  {
+    qint64 offset;
+    qint64 size;
+  };
+
+ private:
+  QTemporaryFile     m_File;
+  std::vector<Block> m_FreeBlocks;  //!< Sorted by offset, touching blocks are merged.
+
+ public:
+  UndoSpillFile();
+
+  qint64 size() const { return m_File.isOpen() ? m_File.size() : 0; }
+
+  // Returns the offset `data` was written at, -1 if the file could not be written.
+  qint64     write(const QByteArray& data);
+  QByteArray read(qint64 offset, qint64 size);
+  void       release(qint64 offset, qint64 size);
+
+  // Every block is dropped, for when no state refers to the file anymore.
+  void clear();
+};
+
+enum class UndoStorage
+{
+  Memory,      //!< Ready to be restored.
+  Compressed,  //!< Packed in memory.
+  Disk,        //!< Packed in the 'UndoSpillFile'.
+};
+
+// One action's 'UndoState' wherever it currently lives.
+class UndoStateStorage final
+{
+ private:
+  UndoState   m_State;        //!< Only valid for 'UndoStorage::Memory'.
+  QByteArray  m_Packed;       //!< Only valid for 'UndoStorage::Compressed'.
+  qint64      m_SpillOffset;  //!< The block last spilled to, kept once loaded so an unchanged state can point back at it. -1 when there is none.
+  qint64      m_SpillSize;    //!<
+  QByteArray  m_SpillHash;    //!< Sha1 of the block.
+  UndoStorage m_Storage;
+
+ public:
+  UndoStateStorage();
+
+  UndoStorage storage() const { return m_Storage; }
+  UndoState&  state() { return m_State; }
+  std::size_t memoryUsage() const;
+
+  void compress();
+  bool spill(UndoSpillFile& file);
+
+  // Brings the state back into memory, false if it could not be read back (it is then left empty).
+  bool load(UndoSpillFile& file);
+};
+
+#endif  // SR_UNDO_HISTORY_HPP
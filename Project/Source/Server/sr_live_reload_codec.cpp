@@ -0,0 +1,170 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_codec.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_live_reload_codec.hpp"
+
+#if defined(SR_HAS_LZ4)
+#include <lz4.h>  // LZ4_compress_default, LZ4_compressBound, LZ4_decompress_safe
+#endif
+
+#if defined(SR_HAS_ZSTD)
+#include <zstd.h>  // ZSTD_compress, ZSTD_compressBound, ZSTD_decompress
+#endif
+
+#include <cstring>  // memcpy
+#include <limits>   // numeric_limits<T>
+
+// NOTE(SR): Level 1 keeps zstd close to LZ4's speed while still being a fair bit smaller, atlases are mostly empty pixels anyway.
+static constexpr int k_ZstdCompressionLevel = 1;
+
+bool liveReloadCodecIsAvailable(LiveReloadCodec codec)
+{
+  switch (codec)
+  {
+    case LiveReloadCodec::None: return true;
+#if defined(SR_HAS_LZ4)
+    case LiveReloadCodec::LZ4: return true;
+#endif
+#if defined(SR_HAS_ZSTD)
+    case LiveReloadCodec::Zstd: return true;
+#endif
+    default: return false;
+  }
+}
+
+std::uint32_t liveReloadCodecCapability(LiveReloadCodec codec)
+{
+  switch (codec)
+  {
+    case LiveReloadCodec::None: return 0u;
+    case LiveReloadCodec::LZ4: return LiveReloadCapability_LZ4;
+    case LiveReloadCodec::Zstd: return LiveReloadCapability_Zstd;
+  }
+
+  return 0u;
+}
+
+const char* liveReloadCodecName(LiveReloadCodec codec)
+{
+  switch (codec)
+  {
+    case LiveReloadCodec::None: return "None";
+    case LiveReloadCodec::LZ4: return "LZ4";
+    case LiveReloadCodec::Zstd: return "Zstd";
+  }
+
+  return "Unknown";
+}
+
+QByteArray liveReloadCompressPacket(LiveReloadCodec codec, const QByteArray& packet)
+{
+  if (codec == LiveReloadCodec::None || !liveReloadCodecIsAvailable(codec) || packet.size() > qsizetype(std::numeric_limits<int>::max()))
+  {
+    return {};
+  }
+
+  const qsizetype header_size = sizeof(SpriteAnim::LiveReloadPacketHeader) + sizeof(LiveReloadPacketCompressed);
+  qsizetype       bound       = 0;
+
+  switch (codec)
+  {
+#if defined(SR_HAS_LZ4)
+    case LiveReloadCodec::LZ4: bound = LZ4_compressBound(int(packet.size())); break;
+#endif
+#if defined(SR_HAS_ZSTD)
+    case LiveReloadCodec::Zstd: bound = qsizetype(ZSTD_compressBound(std::size_t(packet.size()))); break;
+#endif
+    default: break;
+  }
+
+  QByteArray result(header_size + bound, Qt::Uninitialized);
+  qsizetype  compressed_size = 0;
+
+  switch (codec)
+  {
+#if defined(SR_HAS_LZ4)
+    case LiveReloadCodec::LZ4:
+    {
+      compressed_size = LZ4_compress_default(packet.constData(), result.data() + header_size, int(packet.size()), int(bound));
+      break;
+    }
+#endif
+#if defined(SR_HAS_ZSTD)
+    case LiveReloadCodec::Zstd:
+    {
+      const std::size_t status = ZSTD_compress(result.data() + header_size, std::size_t(bound), packet.constData(), std::size_t(packet.size()), k_ZstdCompressionLevel);
+
+      compressed_size = ZSTD_isError(status) ? 0 : qsizetype(status);
+      break;
+    }
+#endif
+    default: break;
+  }
+
+  // Not worth it if it did not save anything (or failed).
+  if (compressed_size <= 0 || header_size + compressed_size >= packet.size())
+  {
+    return {};
+  }
+
+  SpriteAnim::LiveReloadPacketHeader wrapped_event;
+  std::memcpy(&wrapped_event, packet.constData(), sizeof(wrapped_event));
+
+  // Same target spritesheet as the wrapped packet so clients can route it before decompressing.
+  SpriteAnim::LiveReloadPacketHeader event = {k_LiveReloadPacket_Compressed};
+  std::memcpy(&event.target_spritesheet, &wrapped_event.target_spritesheet, sizeof(event.target_spritesheet));
+  event.packet_size = decltype(event.packet_size)(sizeof(LiveReloadPacketCompressed) + compressed_size);
+
+  const LiveReloadPacketCompressed compressed_header = {std::uint32_t(codec), std::uint32_t(packet.size())};
+
+  result.resize(header_size + compressed_size);
+  std::memcpy(result.data(), &event, sizeof(event));
+  std::memcpy(result.data() + sizeof(event), &compressed_header, sizeof(compressed_header));
+
+  return result;
+}
+
+QByteArray liveReloadDecompress(LiveReloadCodec codec, const char* data, qsizetype size, qsizetype uncompressed_size)
+{
+  if (codec == LiveReloadCodec::None || !liveReloadCodecIsAvailable(codec) || uncompressed_size <= 0 ||
+      size > qsizetype(std::numeric_limits<int>::max()) || uncompressed_size > qsizetype(std::numeric_limits<int>::max()))
+  {
+    return {};
+  }
+
+  QByteArray result(uncompressed_size, Qt::Uninitialized);
+  qsizetype  decompressed_size = -1;
+
+  switch (codec)
+  {
+#if defined(SR_HAS_LZ4)
+    case LiveReloadCodec::LZ4:
+    {
+      decompressed_size = LZ4_decompress_safe(data, result.data(), int(size), int(uncompressed_size));
+      break;
+    }
+#endif
+#if defined(SR_HAS_ZSTD)
+    case LiveReloadCodec::Zstd:
+    {
+      const std::size_t status = ZSTD_decompress(result.data(), std::size_t(uncompressed_size), data, std::size_t(size));
+
+      decompressed_size = ZSTD_isError(status) ? -1 : qsizetype(status);
+      break;
+    }
+#endif
+    default:
+    {
+      (void)data;
+      (void)size;
+      break;
+    }
+  }
+
+  return decompressed_size == uncompressed_size ? result : QByteArray{};
+}
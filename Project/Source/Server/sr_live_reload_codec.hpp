@@ -0,0 +1,32 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_codec.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_LIVE_RELOAD_CODEC_HPP
+#define SR_LIVE_RELOAD_CODEC_HPP
+
+#include "sr_live_reload_protocol.hpp"  // LiveReloadCodec
+
+#include <QByteArray>  // QByteArray
+
+// NOTE(SR):
+//   LZ4 and zstd are optional dependencies ('SR_HAS_LZ4' / 'SR_HAS_ZSTD' are defined by the build when found),
+//   a codec that was not compiled in is never negotiated so packets just go out uncompressed.
+
+bool          liveReloadCodecIsAvailable(LiveReloadCodec codec);
+std::uint32_t liveReloadCodecCapability(LiveReloadCodec codec);
+const char*   liveReloadCodecName(LiveReloadCodec codec);
+
+// Wraps `packet` (a whole packet, header included) in a 'k_LiveReloadPacket_Compressed' packet.
+// Returns an empty array if the codec is not available or the result would not be smaller.
+QByteArray liveReloadCompressPacket(LiveReloadCodec codec, const QByteArray& packet);
+
+// The inverse for clients, `data` is what follows the 'LiveReloadPacketCompressed' header.
+// Returns an empty array if the codec is not available or the data does not decompress to exactly `uncompressed_size` bytes.
+QByteArray liveReloadDecompress(LiveReloadCodec codec, const char* data, qsizetype size, qsizetype uncompressed_size);
+
+#endif  // SR_LIVE_RELOAD_CODEC_HPP
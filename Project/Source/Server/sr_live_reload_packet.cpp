@@ -0,0 +1,131 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_packet.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_live_reload_packet.hpp"
+
+#include <cstring>  // memcpy
+#include <utility>  // move
+
+static_assert(sizeof(QUuid) == sizeof(uuid128), "UUID Types must be binary compatible.");
+
+namespace
+{
+  // Fills a buffer sized up front, the assert catches a size calculation getting out of sync with the writes.
+  class PacketWriter final
+  {
+   private:
+    QByteArray m_Packet;
+    char*      m_Cursor;
+
+   public:
+    PacketWriter(SpriteAnim::LiveReloadPacketHeader& event, const QUuid& spritesheet, qsizetype payload_size) :
+      m_Packet(qsizetype(sizeof(event)) + payload_size, Qt::Uninitialized),
+      m_Cursor{m_Packet.data()}
+    {
+      std::memcpy(&event.target_spritesheet, &spritesheet, sizeof(QUuid));
+      event.packet_size = decltype(event.packet_size)(payload_size);
+
+      write(&event, sizeof(event));
+    }
+
+    void write(const void* data, qsizetype size)
+    {
+      std::memcpy(m_Cursor, data, size);
+      m_Cursor += size;
+    }
+
+    void write(const QByteArray& bytes) { write(bytes.constData(), bytes.size()); }
+
+    QByteArray finish()
+    {
+      Q_ASSERT(m_Cursor == m_Packet.constData() + m_Packet.size() && "Packet size calculation does not match what was written.");
+
+      return std::move(m_Packet);
+    }
+  };
+}  // namespace
+
+static SpriteAnim::SpriteAnimation animationData(const QByteArray& name, std::uint32_t num_frames)
+{
+  SpriteAnim::SpriteAnimation animation_data;
+  animation_data.name.elements.offset   = sizeof(animation_data);
+  animation_data.name.num_elements      = std::uint32_t(name.size());
+  animation_data.frames.elements.offset = animation_data.name.elements.offset + animation_data.name.num_elements * sizeof(char);
+  animation_data.frames.num_elements    = num_frames;
+
+  return animation_data;
+}
+
+static qsizetype animationDataSize(const QByteArray& name, std::uint32_t num_frames)
+{
+  return sizeof(SpriteAnim::SpriteAnimation) + name.size() * sizeof(char) + num_frames * sizeof(SpriteAnim::SpriteAnimationFrame);
+}
+
+static void writeAnimationData(PacketWriter& writer, const QByteArray& name, const SpriteAnim::SpriteAnimationFrame* frames, std::uint32_t num_frames)
+{
+  const SpriteAnim::SpriteAnimation animation_data = animationData(name, num_frames);
+
+  writer.write(&animation_data, sizeof(animation_data));
+  writer.write(name);
+  writer.write(frames, num_frames * sizeof(SpriteAnim::SpriteAnimationFrame));
+}
+
+QByteArray liveReloadAnimationPacket(LiveReloadPacketType type, const QUuid& spritesheet, const QByteArray& name, const SpriteAnim::SpriteAnimationFrame* frames, std::uint32_t num_frames)
+{
+  SpriteAnim::LiveReloadPacketHeader event = {type};
+
+  // Points into the same string as the animation data.
+  event.target_animation.elements.offset = sizeof(event.target_animation) +
+                                           sizeof(SpriteAnim::SpriteAnimation);
+  event.target_animation.num_elements = std::uint32_t(name.size());
+
+  PacketWriter writer{event, spritesheet, animationDataSize(name, num_frames)};
+  writeAnimationData(writer, name, frames, num_frames);
+
+  return writer.finish();
+}
+
+QByteArray liveReloadAnimationRenamedPacket(const QUuid& spritesheet, const QByteArray& old_name, const QByteArray& name, const SpriteAnim::SpriteAnimationFrame* frames, std::uint32_t num_frames)
+{
+  SpriteAnim::LiveReloadPacketHeader event = {SpriteAnim::LiveReloadPacketHeader::AnimationRenamed};
+
+  event.target_animation.elements.offset = sizeof(event.target_animation);
+  event.target_animation.num_elements    = std::uint32_t(old_name.size());
+
+  PacketWriter writer{event, spritesheet, old_name.size() * qsizetype(sizeof(char)) + animationDataSize(name, num_frames)};
+  writer.write(old_name);
+  writeAnimationData(writer, name, frames, num_frames);
+
+  return writer.finish();
+}
+
+QByteArray liveReloadAnimationRemovedPacket(const QUuid& spritesheet, const QByteArray& name)
+{
+  SpriteAnim::LiveReloadPacketHeader event = {SpriteAnim::LiveReloadPacketHeader::AnimationRemoved};
+
+  event.target_animation.elements.offset = sizeof(event.target_animation);
+  event.target_animation.num_elements    = std::uint32_t(name.size());
+
+  PacketWriter writer{event, spritesheet, name.size() * qsizetype(sizeof(char))};
+  writer.write(name);
+
+  return writer.finish();
+}
+
+QByteArray liveReloadSharedMemoryPacket(const QUuid& spritesheet, std::uint64_t offset, std::uint32_t size, const QByteArray& native_key)
+{
+  SpriteAnim::LiveReloadPacketHeader event = {k_LiveReloadPacket_SharedMemory};
+
+  const LiveReloadPacketSharedMemory shared_memory = {offset, size, std::uint32_t(native_key.size())};
+
+  PacketWriter writer{event, spritesheet, qsizetype(sizeof(shared_memory)) + native_key.size()};
+  writer.write(&shared_memory, sizeof(shared_memory));
+  writer.write(native_key);
+
+  return writer.finish();
+}
@@ -0,0 +1,29 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_packet.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_LIVE_RELOAD_PACKET_HPP
+#define SR_LIVE_RELOAD_PACKET_HPP
+
+#include "sr_live_reload_protocol.hpp"  // LiveReloadPacketType
+
+#include <QByteArray>  // QByteArray
+#include <QUuid>       // QUuid
+
+#include <cstdint>  // uint32_t
+
+// NOTE(SR):
+//   Each function builds one whole packet ('LiveReloadPacketHeader' included) in a single allocation
+//   of exactly the right size, the same buffer is then written to every client. Strings are utf8.
+
+// 'type' is either 'AnimationAdded' or 'AnimationFramesChanged', they share a layout.
+QByteArray liveReloadAnimationPacket(LiveReloadPacketType type, const QUuid& spritesheet, const QByteArray& name, const SpriteAnim::SpriteAnimationFrame* frames, std::uint32_t num_frames);
+QByteArray liveReloadAnimationRenamedPacket(const QUuid& spritesheet, const QByteArray& old_name, const QByteArray& name, const SpriteAnim::SpriteAnimationFrame* frames, std::uint32_t num_frames);
+QByteArray liveReloadAnimationRemovedPacket(const QUuid& spritesheet, const QByteArray& name);
+QByteArray liveReloadSharedMemoryPacket(const QUuid& spritesheet, std::uint64_t offset, std::uint32_t size, const QByteArray& native_key);
+
+#endif  // SR_LIVE_RELOAD_PACKET_HPP
@@ -0,0 +1,123 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_protocol.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_LIVE_RELOAD_PROTOCOL_HPP
+#define SR_LIVE_RELOAD_PROTOCOL_HPP
+
+#include "sprite_anim/bf_sprite_animation.hpp"  // LiveReloadPacketHeader
+
+#include <atomic>   // atomic<T>
+#include <cstdint>  // uint16_t, uint32_t, uint64_t
+#include <cstring>  // memcpy
+
+// NOTE(SR):
+//   Editor side extensions to the runtime's live reload protocol, see "Live Reload Protocol Extensions"
+//   in 'Documentation/spritesheet_generator.md'. The runtime's clients never send anything so a client
+//   only ever gets these packets after opting in with a 'LiveReloadClientHello', everyone else gets the plain protocol.
+
+using LiveReloadPacketType = decltype(SpriteAnim::LiveReloadPacketHeader::AtlasTextureChanged);
+
+// For reading packets, the type is always the first member of the header.
+inline LiveReloadPacketType liveReloadPacketType(const SpriteAnim::LiveReloadPacketHeader& header)
+{
+  LiveReloadPacketType type;
+  std::memcpy(&type, &header, sizeof(type));
+
+  return type;
+}
+
+// Packet types added after the runtime's own.
+constexpr LiveReloadPacketType k_LiveReloadPacket_AtlasRegionsChanged = LiveReloadPacketType(SpriteAnim::LiveReloadPacketHeader::AtlasTextureChanged + 1);
+constexpr LiveReloadPacketType k_LiveReloadPacket_Compressed          = LiveReloadPacketType(SpriteAnim::LiveReloadPacketHeader::AtlasTextureChanged + 2);
+constexpr LiveReloadPacketType k_LiveReloadPacket_SharedMemory        = LiveReloadPacketType(SpriteAnim::LiveReloadPacketHeader::AtlasTextureChanged + 3);
+
+enum LiveReloadCapability : std::uint32_t
+{
+  LiveReloadCapability_AtlasRegions = (1u << 0),  //!< Understands 'k_LiveReloadPacket_AtlasRegionsChanged'.
+  LiveReloadCapability_LZ4          = (1u << 1),  //!< Understands 'k_LiveReloadPacket_Compressed' with 'LiveReloadCodec::LZ4'.
+  LiveReloadCapability_Zstd         = (1u << 2),  //!< Understands 'k_LiveReloadPacket_Compressed' with 'LiveReloadCodec::Zstd'.
+  LiveReloadCapability_SharedMemory = (1u << 3),  //!< Runs on the same machine and understands 'k_LiveReloadPacket_SharedMemory'.
+};
+
+enum class LiveReloadCodec : std::uint32_t
+{
+  None = 0,
+  LZ4  = 1,  //!< LZ4 block format, fast.
+  Zstd = 2,  //!< Zstandard frame, smaller.
+};
+
+// Optionally sent by a client as the first bytes after connecting.
+struct LiveReloadClientHello
+{
+  static constexpr char k_Magic[] = "SRLR";
+
+  char          magic[4];      //!< Is required to be the ASCII bytes "SRLR".
+  std::uint32_t version;       //!< Must be 'k_LiveReloadProtocolVersion'.
+  std::uint32_t capabilities;  //!< 'LiveReloadCapability' flags.
+};
+
+constexpr std::uint32_t k_LiveReloadProtocolVersion = 1u;
+
+// Payload of 'k_LiveReloadPacket_AtlasRegionsChanged':
+//   LiveReloadPacketAtlasRegions header;
+//   LiveReloadAtlasRegion        regions[header.num_regions];
+//   uint8                        pixels[];  // Each region's rows in order, 'width * 4' bytes per row, same pixel format as 'AtlasTextureChanged'.
+struct LiveReloadPacketAtlasRegions
+{
+  std::uint16_t atlas_width;
+  std::uint16_t atlas_height;
+  std::uint32_t num_regions;
+};
+
+// Payload of 'k_LiveReloadPacket_Compressed', wraps another whole packet (its 'LiveReloadPacketHeader' included):
+//   LiveReloadPacketCompressed header;
+//   uint8                      data[packet_size - sizeof(LiveReloadPacketCompressed)];
+struct LiveReloadPacketCompressed
+{
+  std::uint32_t codec;              //!< 'LiveReloadCodec'.
+  std::uint32_t uncompressed_size;  //!< Size of the wrapped packet once decompressed.
+};
+
+// Payload of 'k_LiveReloadPacket_SharedMemory', another whole packet was put in the shared memory ring:
+//   LiveReloadPacketSharedMemory header;
+//   char                         native_key[header.key_length];  // 'QSharedMemory::nativeKey' of the segment, not nul terminated.
+struct LiveReloadPacketSharedMemory
+{
+  std::uint64_t offset;      //!< Position of the packet in the stream of bytes written to the ring, it starts at 'offset % capacity' and wraps around.
+  std::uint32_t size;        //!< Size of the packet, 'LiveReloadPacketHeader' included.
+  std::uint32_t key_length;  //!< Number of bytes in the native key that follows.
+};
+
+// The start of the shared memory segment, the ring's 'capacity' bytes follow it.
+struct LiveReloadSharedMemoryHeader
+{
+  static constexpr char k_Magic[] = "SRSH";
+
+  char                       magic[4];      //!< Is required to be the ASCII bytes "SRSH".
+  std::uint32_t              version;       //!< Must be 'k_LiveReloadProtocolVersion'.
+  std::uint64_t              capacity;      //!< Size of the ring in bytes.
+  std::atomic<std::uint64_t> write_offset;  //!< End of the last packet, bumped *before* it is copied in. A packet read out is intact if afterwards 'write_offset <= offset + capacity'.
+};
+
+struct LiveReloadAtlasRegion
+{
+  std::uint16_t x;       // units = pixels
+  std::uint16_t y;       // units = pixels
+  std::uint16_t width;   // units = pixels
+  std::uint16_t height;  // units = pixels
+};
+
+static_assert(sizeof(LiveReloadClientHello) == 12, "Sent over the wire so the layout must not change.");
+static_assert(sizeof(LiveReloadPacketAtlasRegions) == 8, "Sent over the wire so the layout must not change.");
+static_assert(sizeof(LiveReloadAtlasRegion) == 8, "Sent over the wire so the layout must not change.");
+static_assert(sizeof(LiveReloadPacketCompressed) == 8, "Sent over the wire so the layout must not change.");
+static_assert(sizeof(LiveReloadPacketSharedMemory) == 16, "Sent over the wire so the layout must not change.");
+static_assert(sizeof(LiveReloadSharedMemoryHeader) == 24, "Shared with other processes so the layout must not change.");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared with other processes so it can not use a lock.");
+
+#endif  // SR_LIVE_RELOAD_PROTOCOL_HPP
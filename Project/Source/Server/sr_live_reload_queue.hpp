@@ -0,0 +1,102 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_queue.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_LIVE_RELOAD_QUEUE_HPP
+#define SR_LIVE_RELOAD_QUEUE_HPP
+
+#include <QByteArray>  // QByteArray
+#include <QImage>      // QImage
+#include <QUuid>       // QUuid
+
+#include <atomic>   // atomic<T>
+#include <utility>  // move
+
+// NOTE(SR):
+//   Everything in a message is implicitly shared (atomically ref-counted) and never written to
+//   again once pushed so the server thread can read it while the editor keeps going.
+
+struct LiveReloadMessage final
+{
+  QByteArray packet;             //!< A whole packet sent as is to every client, unused when 'atlas' is set.
+  QByteArray coalesce_key;       //!< A packet still waiting on a slow client is dropped when another with the same (non empty) key comes in.
+  QUuid      atlas_spritesheet;  //!<
+  QImage     atlas;              //!< Diffed / compressed per client on the server thread.
+};
+
+// Unbounded multi-producer single-consumer queue (Dmitry Vyukov's intrusive MPSC node queue).
+// Pushing never blocks or takes a lock, only the one consumer may call 'beginDrain' / 'pop'.
+class LiveReloadQueue final
+{
+ private:
+  struct Node final
+  {
+    std::atomic<Node*> next;
+    LiveReloadMessage  message;
+  };
+
+ private:
+  std::atomic<Node*> m_Head;            //!< Last pushed node, producers swap themselves in here.
+  Node*              m_Tail;            //!< Already consumed node, 'm_Tail->next' is the next message.
+  std::atomic_bool   m_IsDrainPending;  //!< Set by the first push after a 'beginDrain'.
+
+ public:
+  LiveReloadQueue() :
+    m_Head{new Node{{nullptr}, {}}},
+    m_Tail{m_Head.load(std::memory_order_relaxed)},
+    m_IsDrainPending{false}
+  {
+  }
+
+  LiveReloadQueue(const LiveReloadQueue&) = delete;
+  LiveReloadQueue& operator=(const LiveReloadQueue&) = delete;
+
+  // Returns true when the consumer has to be woken up, false when a wake up is already pending.
+  bool push(LiveReloadMessage&& message)
+  {
+    Node* const node = new Node{{nullptr}, std::move(message)};
+    Node* const prev = m_Head.exchange(node, std::memory_order_acq_rel);
+
+    prev->next.store(node, std::memory_order_release);
+
+    return !m_IsDrainPending.exchange(true, std::memory_order_acq_rel);
+  }
+
+  // Call before popping everything, a push that lands after this wakes the consumer up again.
+  void beginDrain()
+  {
+    m_IsDrainPending.exchange(false, std::memory_order_acq_rel);
+  }
+
+  bool pop(LiveReloadMessage& out_message)
+  {
+    Node* const next = m_Tail->next.load(std::memory_order_acquire);
+
+    if (!next)
+    {
+      return false;
+    }
+
+    out_message = std::move(next->message);
+    delete m_Tail;
+    m_Tail = next;
+
+    return true;
+  }
+
+  ~LiveReloadQueue()
+  {
+    while (m_Tail)
+    {
+      Node* const next = m_Tail->next.load(std::memory_order_relaxed);
+      delete m_Tail;
+      m_Tail = next;
+    }
+  }
+};
+
+#endif  // SR_LIVE_RELOAD_QUEUE_HPP
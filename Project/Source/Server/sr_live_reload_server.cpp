@@ -1,225 +1,605 @@
 #include "sr_live_reload_server.hpp"
 
+#include "sr_live_reload_codec.hpp"
+#include "sr_live_reload_packet.hpp"
+
 #include "sprite_anim/bf_sprite_animation.hpp"
 
+#include <algorithm>  // fill, find_if, min
+#include <cstring>    // memcmp, memcpy
+#include <utility>    // move, swap
+#include <vector>     // vector<T>
+
+// NOTE(SR): Small enough to keep a repainted frame tight, big enough that the region list stays short.
+static constexpr int k_AtlasDiffTileSize = 32;
+
+static std::vector<QRect> findChangedAtlasRegions(const QImage &old_image, const QImage &new_image);
+
 LiveReloadServer::LiveReloadServer() :
   QObject(nullptr),
-  m_Server{nullptr},
-  m_Clients{},
-  m_NumBytesNeedSend{0},
-  m_NumBytesSent{0}
+  m_Thread{},
+  m_Queue{},
+  m_Worker{new LiveReloadWorker(m_Queue)}
 {
+  m_Thread.setObjectName("LiveReloadServer");
+  m_Worker->moveToThread(&m_Thread);
+
+  QObject::connect(&m_Thread, &QThread::finished, m_Worker, &QObject::deleteLater);
+
+  // Queued back onto this object's (the gui) thread.
+  QObject::connect(m_Worker, &LiveReloadWorker::bytesSent, this, &LiveReloadServer::bytesSent);
+
+  m_Thread.start();
 }
 
-void LiveReloadServer::setup()
+bool LiveReloadServer::startServer()
 {
-  QObject::connect(&m_Server, &QTcpServer::newConnection, [this]() {
-    QTcpSocket *const client_socket = m_Server.nextPendingConnection();
+  bool is_listening = false;
 
-    // client_socket->waitForBytesWritten(-1);
+  QMetaObject::invokeMethod(m_Worker, &LiveReloadWorker::listen, Qt::BlockingQueuedConnection, &is_listening);
 
-    QObject::connect(client_socket, &QTcpSocket::disconnected, this, &LiveReloadServer::onClientDisconnect);
-    QObject::connect(client_socket, &QTcpSocket::bytesWritten, this, &LiveReloadServer::onClientBytesSent);
-
-    m_Clients.push_back(client_socket);
-    qDebug() << "onClientConnect";
-  });
+  return is_listening;
 }
 
 void LiveReloadServer::sendAnimationAdded(const QUuid &spritesheet, const Animation &animation, const QMap<QString, std::uint32_t> &frame_to_index)
 {
-  if (!m_Clients.isEmpty())
+  if (hasClients())
   {
-    SpriteAnim::LiveReloadPacketHeader event = {SpriteAnim::LiveReloadPacketHeader::AnimationAdded};
-    std::memcpy(&event.target_spritesheet, &spritesheet, sizeof(QUuid));
+    const std::vector<SpriteAnim::SpriteAnimationFrame> frames = animationFrames(animation, frame_to_index);
 
-    // Points into the same string as the animation data.
-    event.target_animation.elements.offset = sizeof(event.target_animation) +
-                                             sizeof(SpriteAnim::SpriteAnimation);
-    event.target_animation.num_elements = animation.name().length();
-
-    packetSizeAddAnimation(event, animation);
-
-    writeEventHeader(event);
-    writeAnimationData(animation, frame_to_index);
+    post(LiveReloadMessage{liveReloadAnimationPacket(SpriteAnim::LiveReloadPacketHeader::AnimationAdded, spritesheet, animation.name().toUtf8(), frames.data(), std::uint32_t(frames.size())), {}, {}, {}});
   }
 }
 
-static_assert(sizeof(QUuid) == sizeof(uuid128), "UUID Types must be binary compatible.");
-
 void LiveReloadServer::sendAnimationRenamed(const QUuid &spritesheet, const QString &old_name, const Animation &animation, const QMap<QString, std::uint32_t> &frame_to_index)
 {
-  if (!m_Clients.isEmpty())
+  if (hasClients())
   {
-    SpriteAnim::LiveReloadPacketHeader event = {SpriteAnim::LiveReloadPacketHeader::AnimationRenamed};
-    std::memcpy(&event.target_spritesheet, &spritesheet, sizeof(QUuid));
+    const std::vector<SpriteAnim::SpriteAnimationFrame> frames = animationFrames(animation, frame_to_index);
 
-    event.target_animation.elements.offset = sizeof(event.target_animation);
-    event.target_animation.num_elements    = old_name.length();
-    packetSizeAddString(event, old_name);
-    packetSizeAddAnimation(event, animation);
-
-    writeEventHeader(event);
-    writeString(old_name);
-    writeAnimationData(animation, frame_to_index);
+    post(LiveReloadMessage{liveReloadAnimationRenamedPacket(spritesheet, old_name.toUtf8(), animation.name().toUtf8(), frames.data(), std::uint32_t(frames.size())), {}, {}, {}});
   }
 }
 
 void LiveReloadServer::sendAnimationFramesChanged(const QUuid &spritesheet, const Animation &animation, const QMap<QString, std::uint32_t> &frame_to_index)
 {
-  if (!m_Clients.isEmpty())
+  if (hasClients())
   {
-    SpriteAnim::LiveReloadPacketHeader event = {SpriteAnim::LiveReloadPacketHeader::AnimationFramesChanged};
-    std::memcpy(&event.target_spritesheet, &spritesheet, sizeof(QUuid));
-
-    // Points into the same string as the animation data.
-    event.target_animation.elements.offset = sizeof(event.target_animation) +
-                                             sizeof(SpriteAnim::SpriteAnimation);
-    event.target_animation.num_elements = animation.name().length();
+    const std::vector<SpriteAnim::SpriteAnimationFrame> frames = animationFrames(animation, frame_to_index);
+    const QByteArray                                    name   = animation.name().toUtf8();
 
-    packetSizeAddAnimation(event, animation);
+    // Each one has the whole animation so only the newest matters to a client that has fallen behind.
+    const QByteArray coalesce_key = 'F' + spritesheet.toRfc4122() + name;
 
-    writeEventHeader(event);
-    writeAnimationData(animation, frame_to_index);
+    post(LiveReloadMessage{liveReloadAnimationPacket(SpriteAnim::LiveReloadPacketHeader::AnimationFramesChanged, spritesheet, name, frames.data(), std::uint32_t(frames.size())), coalesce_key, {}, {}});
   }
 }
 
 void LiveReloadServer::sendAnimationRemoved(const QUuid &spritesheet, const QString &animation_name)
 {
-  if (!m_Clients.isEmpty())
+  if (hasClients())
   {
-    SpriteAnim::LiveReloadPacketHeader event = {SpriteAnim::LiveReloadPacketHeader::AnimationRemoved};
-    std::memcpy(&event.target_spritesheet, &spritesheet, sizeof(QUuid));
+    post(LiveReloadMessage{liveReloadAnimationRemovedPacket(spritesheet, animation_name.toUtf8()), {}, {}, {}});
+  }
+}
 
-    event.target_animation.elements.offset = sizeof(event.target_animation);
-    event.target_animation.num_elements    = animation_name.length();
-    packetSizeAddString(event, animation_name);
+void LiveReloadServer::sendAtlasTextureChanged(const QUuid &spritesheet, const QImage &atlas_image)
+{
+  if (hasClients())
+  {
+    // Only bumps the image's ref count, converting / diffing / compressing it all happens on the server thread.
+    post(LiveReloadMessage{{}, {}, spritesheet, atlas_image});
+  }
+}
+
+LiveReloadServer::~LiveReloadServer()
+{
+  // The worker closes its clients as it is deleted on the way out of the thread.
+  m_Thread.quit();
+  m_Thread.wait();
+}
 
-    writeEventHeader(event);
-    writeString(animation_name);
+void LiveReloadServer::post(LiveReloadMessage &&message)
+{
+  if (m_Queue.push(std::move(message)))
+  {
+    QMetaObject::invokeMethod(m_Worker, &LiveReloadWorker::drainQueue, Qt::QueuedConnection);
   }
 }
 
-void LiveReloadServer::sendAtlasTextureChanged(const QUuid &spritesheet, const QImage &atlas_image)
+std::vector<SpriteAnim::SpriteAnimationFrame> LiveReloadServer::animationFrames(const Animation &animation, const QMap<QString, std::uint32_t> &frame_to_index)
 {
-  if (!m_Clients.isEmpty())
+  std::vector<SpriteAnim::SpriteAnimationFrame> frames = {};
+  frames.reserve(animation.frames.size());
+
+  for (const auto &frame : animation.frames)
   {
-    SpriteAnim::LiveReloadPacketHeader event = {SpriteAnim::LiveReloadPacketHeader::AtlasTextureChanged};
-    std::memcpy(&event.target_spritesheet, &spritesheet, sizeof(QUuid));
+    SpriteAnim::SpriteAnimationFrame frame_data;
+    frame_data.frame_index = frame_to_index[frame.full_path()];
+    frame_data.frame_time  = frame.frame_time;
+
+    frames.push_back(frame_data);
+  }
 
-    const auto image_bytes_size = atlas_image.sizeInBytes();
+  return frames;
+}
+
+LiveReloadWorker::LiveReloadWorker(LiveReloadQueue &queue) :
+  QObject(nullptr),
+  m_Server{this},
+  m_Clients{},
+  m_LastAtlasSpritesheet{},
+  m_LastAtlas{},
+  m_Queue{queue},
+  m_SharedMemory{},
+  m_Compression{LiveReloadCodec::None},
+  m_NumClients{0},
+  m_NumBytesNeedSend{0},
+  m_NumBytesSent{0},
+  m_NumBytesDropped{0}
+{
+  QObject::connect(&m_Server, &QTcpServer::newConnection, this, &LiveReloadWorker::onClientConnect);
+}
+
+void LiveReloadWorker::setCompression(LiveReloadCodec codec)
+{
+  m_Compression.store(liveReloadCodecIsAvailable(codec) ? codec : LiveReloadCodec::None, std::memory_order_relaxed);
+}
 
-    event.packet_size = sizeof(SpriteAnim::LiveReloadPacketAtlasTexture);
-    event.packet_size += image_bytes_size;
+LiveReloadWorker::~LiveReloadWorker()
+{
+  for (const LiveReloadClient &client : m_Clients)
+  {
+    client.socket->close();
+    client.socket->deleteLater();
+  }
+}
 
-    const std::uint16_t atlas_width  = atlas_image.width();
-    const std::uint16_t atlas_height = atlas_image.height();
+bool LiveReloadWorker::listen()
+{
+  return m_Server.listen(QHostAddress::LocalHost, SpriteAnim::k_ServerPort);
+}
 
-    writeEventHeader(event);
+void LiveReloadWorker::drainQueue()
+{
+  m_Queue.beginDrain();
 
-    binaryIO::rel_array32<char> texture_data = {};
-    texture_data.elements.offset            = sizeof(texture_data) +
-                                   sizeof(std::uint16_t) +
-                                   sizeof(std::uint16_t);
-    texture_data.num_elements = image_bytes_size;
+  LiveReloadMessage message = {};
 
-    for (QTcpSocket *const client : m_Clients)
+  while (m_Queue.pop(message))
+  {
+    if (message.atlas.isNull())
     {
-      client->write((const char *)&texture_data, sizeof(texture_data));
-      client->write((const char *)&atlas_width, sizeof(atlas_width));
-      client->write((const char *)&atlas_height, sizeof(atlas_height));
-      client->write((const char *)atlas_image.constBits(), image_bytes_size);
+      sendPacket(message.packet, message.coalesce_key);
+    }
+    else
+    {
+      sendAtlas(message.atlas_spritesheet, message.atlas);
     }
   }
+
+  // Do not keep the last packet alive until the next one.
+  message = {};
 }
 
-LiveReloadServer::~LiveReloadServer()
+void LiveReloadWorker::onClientConnect()
 {
-  for (QTcpSocket *client : m_Clients)
+  QTcpSocket *const client_socket = m_Server.nextPendingConnection();
+
+  // client_socket->waitForBytesWritten(-1);
+
+  QObject::connect(client_socket, &QTcpSocket::disconnected, this, &LiveReloadWorker::onClientDisconnect);
+  QObject::connect(client_socket, &QTcpSocket::bytesWritten, this, &LiveReloadWorker::onClientBytesSent);
+  QObject::connect(client_socket, &QTcpSocket::readyRead, this, &LiveReloadWorker::onClientReadyRead);
+
+  // New clients have nothing to diff against so get the whole atlas on the next change.
+  m_Clients.push_back(LiveReloadClient{client_socket, {}, 0u, false, {}, 0});
+  m_NumClients.store(int(m_Clients.size()), std::memory_order_relaxed);
+  qDebug() << "onClientConnect";
+}
+
+void LiveReloadWorker::queuePacket(LiveReloadClient &client, const QByteArray &coalesce_key, const QByteArray &packet)
+{
+  dropPending(client, coalesce_key);
+
+  m_NumBytesNeedSend.fetch_add(packet.size(), std::memory_order_relaxed);
+
+  // Keeps packets in order, nothing can skip ahead of what is already waiting.
+  if (client.pending.isEmpty() && client.socket->bytesToWrite() < k_LiveReloadMaxBytesInFlight)
+  {
+    client.socket->write(packet);
+  }
+  else
   {
-    client->close();
-    client->deleteLater();
+    client.pending.push_back(LiveReloadPendingPacket{coalesce_key, packet});
+    client.pending_bytes += packet.size();
   }
 }
 
-void LiveReloadServer::onClientBytesSent(qint64 num_bytes)
+bool LiveReloadWorker::dropPending(LiveReloadClient &client, const QByteArray &coalesce_key)
 {
-  m_NumBytesSent += num_bytes;
+  if (coalesce_key.isEmpty() || client.pending.isEmpty())
+  {
+    return false;
+  }
 
-  emit bytesSent();
+  qint64 num_bytes_dropped = 0;
+
+  // NOTE(SR): The newest packet is appended to the end rather than put in the old one's place since
+  //           anything that came in between (an animation being removed then added back) has to stay before it.
+  client.pending.removeIf([&coalesce_key, &num_bytes_dropped](const LiveReloadPendingPacket &pending) {
+    if (pending.coalesce_key == coalesce_key)
+    {
+      num_bytes_dropped += pending.packet.size();
+      return true;
+    }
 
-  // if (m_NumBytesSent == m_NumBytesNeedSend)
-  // {
-  //   m_NumBytesSent     = 0;
-  //   m_NumBytesNeedSend = 0;
-  // }
+    return false;
+  });
+
+  client.pending_bytes -= num_bytes_dropped;
+  m_NumBytesNeedSend.fetch_sub(num_bytes_dropped, std::memory_order_relaxed);
+  m_NumBytesDropped.fetch_add(num_bytes_dropped, std::memory_order_relaxed);
+
+  return num_bytes_dropped != 0;
 }
 
-void LiveReloadServer::onClientDisconnect()
+void LiveReloadWorker::flushPending(LiveReloadClient &client)
 {
-  qDebug() << "onClientDisconnect";
-  QTcpSocket *const client = static_cast<QTcpSocket *>(QObject::sender());
-  m_Clients.removeOne(client);
+  while (!client.pending.isEmpty() && client.socket->bytesToWrite() < k_LiveReloadMaxBytesInFlight)
+  {
+    const LiveReloadPendingPacket pending = client.pending.takeFirst();
+
+    client.pending_bytes -= pending.packet.size();
+    client.socket->write(pending.packet);
+  }
+}
+
+void LiveReloadWorker::sendPacket(const QByteArray &packet, const QByteArray &coalesce_key)
+{
+  for (LiveReloadClient &client : m_Clients)
+  {
+    queuePacket(client, coalesce_key, packet);
+  }
 }
 
-void LiveReloadServer::writeEventHeader(const SpriteAnim::LiveReloadPacketHeader &event)
+void LiveReloadWorker::sendAtlas(const QUuid &spritesheet, const QImage &atlas_image)
 {
-  for (QTcpSocket *const client : m_Clients)
+  if (m_Clients.isEmpty())
+  {
+    return;
+  }
+
+  // Same pixel layout as the full texture packet, tightly packed 32bit pixels.
+  const QImage atlas = atlas_image.format() == QImage::Format_ARGB32 ? atlas_image : atlas_image.convertToFormat(QImage::Format_ARGB32);
+
+  const bool can_diff = spritesheet == m_LastAtlasSpritesheet &&
+                        !m_LastAtlas.isNull() &&
+                        m_LastAtlas.size() == atlas.size();
+
+  SpriteAnim::LiveReloadPacketHeader full_event = {SpriteAnim::LiveReloadPacketHeader::AtlasTextureChanged};
+  std::memcpy(&full_event.target_spritesheet, &spritesheet, sizeof(QUuid));
+
+  full_event.packet_size = sizeof(SpriteAnim::LiveReloadPacketAtlasTexture);
+  full_event.packet_size += atlas.sizeInBytes();
+
+  QByteArray regions_packet = {};
+
+  if (can_diff)
   {
-    client->write((const char *)&event, sizeof(event));
+    const std::vector<QRect> regions = findChangedAtlasRegions(m_LastAtlas, atlas);
+
+    qsizetype num_pixel_bytes = 0;
+
+    for (const QRect &region : regions)
+    {
+      num_pixel_bytes += qsizetype(region.width()) * region.height() * 4;
+    }
+
+    const qsizetype payload_size = sizeof(LiveReloadPacketAtlasRegions) + regions.size() * sizeof(LiveReloadAtlasRegion) + num_pixel_bytes;
+
+    // NOTE(SR): Past half the atlas the region list + row copies stop paying for themselves.
+    if (payload_size < atlas.sizeInBytes() / 2)
+    {
+      SpriteAnim::LiveReloadPacketHeader event = {k_LiveReloadPacket_AtlasRegionsChanged};
+      std::memcpy(&event.target_spritesheet, &spritesheet, sizeof(QUuid));
+      event.packet_size = decltype(event.packet_size)(payload_size);
+
+      const LiveReloadPacketAtlasRegions regions_header = {std::uint16_t(atlas.width()), std::uint16_t(atlas.height()), std::uint32_t(regions.size())};
+
+      regions_packet.reserve(sizeof(event) + payload_size);
+      regions_packet.append((const char *)&event, sizeof(event));
+      regions_packet.append((const char *)&regions_header, sizeof(regions_header));
+
+      for (const QRect &region : regions)
+      {
+        const LiveReloadAtlasRegion region_data = {std::uint16_t(region.x()), std::uint16_t(region.y()), std::uint16_t(region.width()), std::uint16_t(region.height())};
+
+        regions_packet.append((const char *)&region_data, sizeof(region_data));
+      }
+
+      for (const QRect &region : regions)
+      {
+        for (int y = region.top(); y <= region.bottom(); ++y)
+        {
+          regions_packet.append((const char *)(atlas.constScanLine(y) + region.x() * 4), region.width() * 4);
+        }
+      }
+    }
   }
+
+  // Indexed by 'send_regions', each packet is compressed / shared at most once no matter how many clients get it.
+  QByteArray            full_packet      = {};
+  QByteArray            compressed[2]    = {};
+  bool                  did_compress[2]  = {false, false};
+  QByteArray            shared[2]        = {};
+  bool                  did_share[2]     = {false, false};
+  const LiveReloadCodec codec            = compression();
+  const std::uint32_t   codec_capability = liveReloadCodecCapability(codec);
+  const QByteArray      coalesce_key     = 'A' + spritesheet.toRfc4122();
+
+  for (LiveReloadClient &client : m_Clients)
+  {
+    // Regions are relative to the previous atlas so once that is dropped the client needs the whole thing.
+    const bool dropped_atlas = dropPending(client, coalesce_key);
+    const bool send_regions  = !dropped_atlas && client.has_atlas && !regions_packet.isEmpty() && (client.capabilities & LiveReloadCapability_AtlasRegions);
+
+    if (!send_regions && full_packet.isEmpty())
+    {
+      full_packet = makeFullAtlasPacket(full_event, atlas);
+    }
+
+    const QByteArray &packet  = send_regions ? regions_packet : full_packet;
+    const QByteArray *to_send = &packet;
+
+    // Skipping the socket beats compressing for it, each is left empty when it could not be done.
+    if ((client.capabilities & LiveReloadCapability_SharedMemory) && packet.size() >= k_LiveReloadSharedMemoryMinPacket)
+    {
+      if (!did_share[send_regions])
+      {
+        shared[send_regions]    = shareAtlasPacket(spritesheet, packet);
+        did_share[send_regions] = true;
+      }
+
+      if (!shared[send_regions].isEmpty())
+      {
+        to_send = &shared[send_regions];
+      }
+    }
+
+    if (to_send == &packet && codec != LiveReloadCodec::None && (client.capabilities & codec_capability))
+    {
+      if (!did_compress[send_regions])
+      {
+        compressed[send_regions]   = liveReloadCompressPacket(codec, packet);
+        did_compress[send_regions] = true;
+      }
+
+      if (!compressed[send_regions].isEmpty())
+      {
+        to_send = &compressed[send_regions];
+      }
+    }
+
+    queuePacket(client, coalesce_key, *to_send);
+
+    // The ring can overwrite a packet before the client reads it, so only an atlas that went over the socket is known
+    // to have arrived and can be the base of the next regions.
+    client.has_atlas = to_send != &shared[send_regions];
+  }
+
+  // NOTE(SR): A shallow copy, the project repainting its atlas in place detaches it from this one.
+  m_LastAtlasSpritesheet = spritesheet;
+  m_LastAtlas            = atlas;
 }
 
-void LiveReloadServer::writeString(const QString &str)
+void LiveReloadWorker::onClientBytesSent(qint64 num_bytes)
 {
-  const QByteArray utf8_str = str.toUtf8();
+  LiveReloadClient *const client = findClient(static_cast<QTcpSocket *>(QObject::sender()));
 
-  for (QTcpSocket *const client : m_Clients)
+  if (client)
   {
-    client->write(utf8_str.data(), utf8_str.size());
+    flushPending(*client);
   }
+
+  const qint64 num_bytes_sent = m_NumBytesSent.fetch_add(num_bytes, std::memory_order_relaxed) + num_bytes;
+
+  // Start over once everything went out so the progress shows the current batch rather than all time.
+  if (num_bytes_sent >= m_NumBytesNeedSend.load(std::memory_order_relaxed))
+  {
+    m_NumBytesSent.store(0, std::memory_order_relaxed);
+    m_NumBytesNeedSend.store(0, std::memory_order_relaxed);
+  }
+
+  emit bytesSent();
 }
 
-void LiveReloadServer::writeAnimationData(const Animation &animation, const QMap<QString, std::uint32_t> &frame_to_index)
+void LiveReloadWorker::onClientReadyRead()
 {
-  SpriteAnim::SpriteAnimation animation_data;
-  animation_data.name.elements.offset   = sizeof(animation_data);
-  animation_data.name.num_elements      = animation.name().length();
-  animation_data.frames.elements.offset = animation_data.name.elements.offset + animation_data.name.num_elements * sizeof(char);
-  animation_data.frames.num_elements    = uint32_t(animation.frames.size());
+  QTcpSocket *const       socket = static_cast<QTcpSocket *>(QObject::sender());
+  LiveReloadClient *const client = findClient(socket);
+
+  if (!client)
+  {
+    return;
+  }
+
+  const qsizetype num_bytes_left = qsizetype(sizeof(LiveReloadClientHello)) - client->hello.size();
 
-  for (QTcpSocket *const client : m_Clients)
+  if (num_bytes_left <= 0)
   {
-    client->write((const char *)&animation_data, sizeof(animation_data));
+    // Nothing else is ever sent by clients.
+    socket->readAll();
+    return;
   }
 
-  writeString(animation.name());
+  client->hello += socket->read(num_bytes_left);
 
-  for (QTcpSocket *const client : m_Clients)
+  if (client->hello.size() == sizeof(LiveReloadClientHello))
   {
-    for (const auto &frame : animation.frames)
+    LiveReloadClientHello hello;
+    std::memcpy(&hello, client->hello.constData(), sizeof(hello));
+
+    if (std::memcmp(hello.magic, LiveReloadClientHello::k_Magic, sizeof(hello.magic)) == 0 && hello.version == k_LiveReloadProtocolVersion)
+    {
+      client->capabilities = hello.capabilities;
+
+      // Everything keeps going over the socket if the segment can not be made.
+      if ((client->capabilities & LiveReloadCapability_SharedMemory) && !m_SharedMemory.open(k_LiveReloadSharedMemoryCapacity))
+      {
+        client->capabilities &= ~std::uint32_t(LiveReloadCapability_SharedMemory);
+      }
+    }
+    else
     {
-      SpriteAnim::SpriteAnimationFrame frame_data;
-      frame_data.frame_index = frame_to_index[frame.full_path()];
-      frame_data.frame_time  = frame.frame_time;
+      qDebug() << "Ignoring invalid live reload client hello.";
+    }
+  }
+}
+
+void LiveReloadWorker::onClientDisconnect()
+{
+  qDebug() << "onClientDisconnect";
+  QTcpSocket *const client = static_cast<QTcpSocket *>(QObject::sender());
+
+  // What it never got will never be sent.
+  if (LiveReloadClient *const disconnected = findClient(client))
+  {
+    m_NumBytesNeedSend.fetch_sub(disconnected->pending_bytes + client->bytesToWrite(), std::memory_order_relaxed);
+  }
 
-      client->write((const char *)&frame_data, sizeof(frame_data));
+  m_Clients.removeIf([client](const LiveReloadClient &c) { return c.socket == client; });
+  m_NumClients.store(int(m_Clients.size()), std::memory_order_relaxed);
+}
+
+LiveReloadClient *LiveReloadWorker::findClient(QTcpSocket *socket)
+{
+  for (LiveReloadClient &client : m_Clients)
+  {
+    if (client.socket == socket)
+    {
+      return &client;
     }
   }
+
+  return nullptr;
 }
 
-void LiveReloadServer::packetSizeAddString(SpriteAnim::LiveReloadPacketHeader &event, const QString &str)
+QByteArray LiveReloadWorker::shareAtlasPacket(const QUuid &spritesheet, const QByteArray &packet)
 {
-  const auto utf8_str = str.toUtf8();
+  const qint64 offset = m_SharedMemory.publish(packet);
 
-  event.packet_size += utf8_str.size() * sizeof(char);
+  if (offset < 0)
+  {
+    return {};
+  }
+
+  return liveReloadSharedMemoryPacket(spritesheet, std::uint64_t(offset), std::uint32_t(packet.size()), m_SharedMemory.nativeKey().toUtf8());
 }
 
-void LiveReloadServer::packetSizeAddAnimation(SpriteAnim::LiveReloadPacketHeader &event, const Animation &animation)
+QByteArray LiveReloadWorker::makeFullAtlasPacket(const SpriteAnim::LiveReloadPacketHeader &event, const QImage &atlas_image) const
 {
-  event.packet_size += sizeof(SpriteAnim::SpriteAnimation);
-  packetSizeAddString(event, animation.name());
-  event.packet_size += animation.frames.size() * sizeof(SpriteAnim::SpriteAnimationFrame);
+  const auto image_bytes_size = atlas_image.sizeInBytes();
+
+  const std::uint16_t atlas_width  = atlas_image.width();
+  const std::uint16_t atlas_height = atlas_image.height();
+
+  binaryIO::rel_array32<char> texture_data = {};
+  texture_data.elements.offset            = sizeof(texture_data) +
+                                 sizeof(std::uint16_t) +
+                                 sizeof(std::uint16_t);
+  texture_data.num_elements = image_bytes_size;
+
+  QByteArray packet = {};
+  packet.reserve(sizeof(event) + event.packet_size);
+
+  packet.append((const char *)&event, sizeof(event));
+  packet.append((const char *)&texture_data, sizeof(texture_data));
+  packet.append((const char *)&atlas_width, sizeof(atlas_width));
+  packet.append((const char *)&atlas_height, sizeof(atlas_height));
+  packet.append((const char *)atlas_image.constBits(), image_bytes_size);
+
+  return packet;
+}
+
+// Compares the images in tiles, neighboring changed tiles in a row become one rect and
+// rects with the same columns in consecutive rows are joined so a changed frame is usually one rect.
+static std::vector<QRect> findChangedAtlasRegions(const QImage &old_image, const QImage &new_image)
+{
+  const int width     = new_image.width();
+  const int height    = new_image.height();
+  const int num_tiles = (width + k_AtlasDiffTileSize - 1) / k_AtlasDiffTileSize;
+
+  std::vector<QRect> result     = {};
+  std::vector<QRect> open_rects = {};  //!< Rects that reached the bottom of the previous tile row.
+  std::vector<QRect> next_open  = {};
+  std::vector<bool>  is_dirty(num_tiles);
+
+  for (int tile_y = 0; tile_y < height; tile_y += k_AtlasDiffTileSize)
+  {
+    const int tile_h = std::min(k_AtlasDiffTileSize, height - tile_y);
+
+    std::fill(is_dirty.begin(), is_dirty.end(), false);
+
+    for (int y = tile_y; y < tile_y + tile_h; ++y)
+    {
+      const uchar *const old_row = old_image.constScanLine(y);
+      const uchar *const new_row = new_image.constScanLine(y);
+
+      for (int tile = 0; tile < num_tiles; ++tile)
+      {
+        if (!is_dirty[tile])
+        {
+          const int x      = tile * k_AtlasDiffTileSize;
+          const int tile_w = std::min(k_AtlasDiffTileSize, width - x);
+
+          is_dirty[tile] = std::memcmp(old_row + x * 4, new_row + x * 4, tile_w * 4) != 0;
+        }
+      }
+    }
+
+    next_open.clear();
+
+    for (int tile = 0; tile < num_tiles;)
+    {
+      if (!is_dirty[tile])
+      {
+        ++tile;
+        continue;
+      }
+
+      const int run_begin = tile;
+
+      while (tile < num_tiles && is_dirty[tile])
+      {
+        ++tile;
+      }
+
+      const int run_left  = run_begin * k_AtlasDiffTileSize;
+      const int run_right = std::min(tile * k_AtlasDiffTileSize, width);
+      QRect     run_rect  = QRect(run_left, tile_y, run_right - run_left, tile_h);
+
+      const auto above = std::find_if(open_rects.begin(), open_rects.end(), [&run_rect](const QRect &rect) {
+        return rect.left() == run_rect.left() && rect.right() == run_rect.right();
+      });
+
+      if (above != open_rects.end())
+      {
+        run_rect.setTop(above->top());
+        open_rects.erase(above);
+      }
+
+      next_open.push_back(run_rect);
+    }
+
+    // Anything not continued in this row is finished.
+    result.insert(result.end(), open_rects.begin(), open_rects.end());
+    std::swap(open_rects, next_open);
+  }
+
+  result.insert(result.end(), open_rects.begin(), open_rects.end());
+
+  return result;
 }
 
 std::unique_ptr<LiveReloadServer> g_Server;
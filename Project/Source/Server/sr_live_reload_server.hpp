@@ -4,34 +4,122 @@
 #include "sprite_anim/bf_sprite_animation.hpp"  // k_ServerPort
 
 #include "Data/sr_animation.hpp"
+#include "sr_live_reload_protocol.hpp"  // LiveReloadClientHello, LiveReloadCodec
+#include "sr_live_reload_queue.hpp"     // LiveReloadQueue
+#include "sr_live_reload_shm.hpp"       // LiveReloadSharedMemory
 
 #include <QBuffer>     // QBuffer
 #include <QImage>      // QImage
 #include <QObject>     // QObject
 #include <QTcpServer>  // QTcpServer
 #include <QTcpSocket>  // QTcpSocket
+#include <QThread>     // QThread
 #include <QUuid>       // QUuid
 
+#include <algorithm>  // max
+#include <atomic>     // atomic<T>
+#include <vector>     // vector<T>
+
 struct Animation;
 
+// NOTE(SR): Past this a client is considered behind, packets wait in 'LiveReloadClient::pending' instead of the socket's buffer.
+constexpr qint64 k_LiveReloadMaxBytesInFlight = 4 * 1024 * 1024;
+
+struct LiveReloadPendingPacket final
+{
+  QByteArray coalesce_key;  //!< See 'LiveReloadMessage::coalesce_key'.
+  QByteArray packet;
+};
+
+struct LiveReloadClient final
+{
+  QTcpSocket*                    socket;
+  QByteArray                     hello;          //!< Bytes of the 'LiveReloadClientHello' received so far.
+  std::uint32_t                  capabilities;   //!< 'LiveReloadCapability' flags the client opted in to.
+  bool                           has_atlas;      //!< Has been sent 'LiveReloadWorker::m_LastAtlas' so only what changed from it needs sending.
+  QList<LiveReloadPendingPacket> pending;        //!< Not handed to the socket yet, superseded packets are dropped from here.
+  qint64                         pending_bytes;  //!< Sum of 'pending'.
+};
+
+// Owns the listening socket and every client, lives on 'LiveReloadServer::m_Thread'.
+// Only the atomics may be touched from other threads.
+class LiveReloadWorker final : public QObject
+{
+  Q_OBJECT
+
+ private:
+  QTcpServer                   m_Server;
+  QVector<LiveReloadClient>    m_Clients;
+  QUuid                        m_LastAtlasSpritesheet;
+  QImage                       m_LastAtlas;  //!< The last atlas sent, changed regions are found by diffing against it.
+  LiveReloadQueue&             m_Queue;
+  LiveReloadSharedMemory       m_SharedMemory;  //!< Opened for the first client that asks for it.
+  std::atomic<LiveReloadCodec> m_Compression;  //!< Used for atlas packets sent to clients that can decode it.
+  std::atomic_int              m_NumClients;
+  std::atomic<qint64>          m_NumBytesNeedSend;  //!< Everything given to clients (not dropped) since 'm_NumBytesSent' last caught up.
+  std::atomic<qint64>          m_NumBytesSent;      //!< Reset along with 'm_NumBytesNeedSend' once it catches up.
+  std::atomic<qint64>          m_NumBytesDropped;   //!< Total of the packets superseded before a slow client got them.
+
+ public:
+  explicit LiveReloadWorker(LiveReloadQueue& queue);
+
+  LiveReloadCodec compression() const { return m_Compression.load(std::memory_order_relaxed); }
+  int             numClients() const { return m_NumClients.load(std::memory_order_relaxed); }
+  qint64          numBytesNeedSend() const { return m_NumBytesNeedSend.load(std::memory_order_relaxed); }
+  qint64          numBytesSent() const { return m_NumBytesSent.load(std::memory_order_relaxed); }
+  qint64          numBytesDropped() const { return m_NumBytesDropped.load(std::memory_order_relaxed); }
+
+  void setCompression(LiveReloadCodec codec);
+
+  ~LiveReloadWorker();
+
+ signals:
+  void bytesSent();
+
+ public slots:
+  bool listen();
+  void drainQueue();
+
+ private slots:
+  void onClientConnect();
+  void onClientBytesSent(qint64 num_bytes);
+  void onClientReadyRead();
+  void onClientDisconnect();
+
+ private:
+  LiveReloadClient* findClient(QTcpSocket* socket);
+  void              queuePacket(LiveReloadClient& client, const QByteArray& coalesce_key, const QByteArray& packet);
+  bool              dropPending(LiveReloadClient& client, const QByteArray& coalesce_key);
+  void              flushPending(LiveReloadClient& client);
+  void              sendPacket(const QByteArray& packet, const QByteArray& coalesce_key);
+  void              sendAtlas(const QUuid& spritesheet, const QImage& atlas_image);
+  QByteArray        shareAtlasPacket(const QUuid& spritesheet, const QByteArray& packet);
+  QByteArray        makeFullAtlasPacket(const SpriteAnim::LiveReloadPacketHeader& event, const QImage& atlas_image) const;
+};
+
+// The editor's side of the server, packets are assembled on the calling (gui) thread
+// and handed to 'LiveReloadWorker' so slow clients never stall editing.
 class LiveReloadServer final : public QObject
 {
   Q_OBJECT
 
  private:
-  QTcpServer           m_Server;
-  QVector<QTcpSocket*> m_Clients;
-  qint64               m_NumBytesNeedSend;
-  qint64               m_NumBytesSent;
+  QThread           m_Thread;
+  LiveReloadQueue   m_Queue;
+  LiveReloadWorker* m_Worker;  //!< Deleted on 'm_Thread' once it finishes.
 
  public:
   LiveReloadServer();
 
-  qint64 numBytesNeedSend() const { return m_NumBytesNeedSend; }
-  qint64 numBytesSent() const { return m_NumBytesSent; }
-  bool   startServer() { return m_Server.listen(QHostAddress::LocalHost, SpriteAnim::k_ServerPort); }
+  qint64          numBytesNeedSend() const { return m_Worker->numBytesNeedSend(); }
+  qint64          numBytesSent() const { return m_Worker->numBytesSent(); }
+  qint64          numBytesQueued() const { return std::max(numBytesNeedSend() - numBytesSent(), qint64(0)); }
+  qint64          numBytesDropped() const { return m_Worker->numBytesDropped(); }
+  int             numClients() const { return m_Worker->numClients(); }
+  LiveReloadCodec compression() const { return m_Worker->compression(); }
+  bool            startServer();
 
-  void setup();
+  void setCompression(LiveReloadCodec codec) { m_Worker->setCompression(codec); }
 
   void sendAnimationAdded(const QUuid& spritesheet, const Animation& animation, const QMap<QString, std::uint32_t>& frame_to_index);
   void sendAnimationRenamed(const QUuid& spritesheet, const QString& old_name, const Animation& animation, const QMap<QString, std::uint32_t>& frame_to_index);
@@ -44,17 +132,11 @@ class LiveReloadServer final : public QObject
  signals:
   void bytesSent();
 
- private slots:
-  void onClientBytesSent(qint64 num_bytes);
-  void onClientDisconnect();
-
  private:
-  void writeEventHeader(const SpriteAnim::LiveReloadPacketHeader& event);
-  void writeString(const QString& str);
-  void writeAnimationData(const Animation& animation, const QMap<QString, std::uint32_t>& frame_to_index);
+  bool hasClients() const { return numClients() != 0; }
+  void post(LiveReloadMessage&& message);
 
-  void packetSizeAddString(SpriteAnim::LiveReloadPacketHeader& event, const QString& str);
-  void packetSizeAddAnimation(SpriteAnim::LiveReloadPacketHeader& event, const Animation& animation);
+  static std::vector<SpriteAnim::SpriteAnimationFrame> animationFrames(const Animation& animation, const QMap<QString, std::uint32_t>& frame_to_index);
 };
 
 extern std::unique_ptr<LiveReloadServer> g_Server;
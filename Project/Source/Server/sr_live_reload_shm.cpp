@@ -0,0 +1,167 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_shm.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_live_reload_shm.hpp"
+
+#include <QDebug>  // qWarning
+
+#include <algorithm>  // min
+#include <cstring>    // memcpy, memcmp
+
+static char* ringData(QSharedMemory& memory)
+{
+  return static_cast<char*>(memory.data()) + sizeof(LiveReloadSharedMemoryHeader);
+}
+
+static LiveReloadSharedMemoryHeader* ringHeader(QSharedMemory& memory)
+{
+  return static_cast<LiveReloadSharedMemoryHeader*>(memory.data());
+}
+
+LiveReloadSharedMemory::LiveReloadSharedMemory() :
+  m_Memory{k_LiveReloadSharedMemoryKey}
+{
+}
+
+bool LiveReloadSharedMemory::open(qsizetype capacity)
+{
+  if (isOpen())
+  {
+    return true;
+  }
+
+  if (!m_Memory.create(qsizetype(sizeof(LiveReloadSharedMemoryHeader)) + capacity, QSharedMemory::ReadWrite))
+  {
+    // NOTE(SR): On unix a segment left over by a crashed editor outlives it, attaching then detaching as the last user frees it.
+    if (m_Memory.error() == QSharedMemory::AlreadyExists && m_Memory.attach())
+    {
+      m_Memory.detach();
+    }
+
+    if (!m_Memory.create(qsizetype(sizeof(LiveReloadSharedMemoryHeader)) + capacity, QSharedMemory::ReadWrite))
+    {
+      qWarning() << "Failed to create the live reload shared memory:" << m_Memory.errorString();
+      return false;
+    }
+  }
+
+  LiveReloadSharedMemoryHeader* const header = ringHeader(m_Memory);
+
+  std::memcpy(header->magic, LiveReloadSharedMemoryHeader::k_Magic, sizeof(header->magic));
+  header->version  = k_LiveReloadProtocolVersion;
+  header->capacity = std::uint64_t(capacity);
+  header->write_offset.store(0u, std::memory_order_release);
+
+  return true;
+}
+
+qint64 LiveReloadSharedMemory::publish(const QByteArray& packet)
+{
+  if (!isOpen())
+  {
+    return -1;
+  }
+
+  LiveReloadSharedMemoryHeader* const header   = ringHeader(m_Memory);
+  const qsizetype                     capacity = qsizetype(header->capacity);
+  const qsizetype                     size     = packet.size();
+
+  if (size > capacity)
+  {
+    return -1;
+  }
+
+  const std::uint64_t offset = header->write_offset.load(std::memory_order_relaxed);
+
+  // Readers check this after copying so it has to move before any bytes are overwritten (a seqlock, only ever increasing).
+  header->write_offset.store(offset + size, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  char* const     ring        = ringData(m_Memory);
+  const qsizetype start       = qsizetype(offset % std::uint64_t(capacity));
+  const qsizetype first_chunk = std::min(size, capacity - start);
+
+  std::memcpy(ring + start, packet.constData(), first_chunk);
+  std::memcpy(ring, packet.constData() + first_chunk, size - first_chunk);
+
+  return qint64(offset);
+}
+
+LiveReloadSharedMemory::~LiveReloadSharedMemory()
+{
+  m_Memory.detach();
+}
+
+LiveReloadSharedMemoryReader::LiveReloadSharedMemoryReader() :
+  m_Memory{}
+{
+}
+
+bool LiveReloadSharedMemoryReader::open(const QString& native_key)
+{
+  if (isOpen() && m_Memory.nativeKey() == native_key)
+  {
+    return true;
+  }
+
+  m_Memory.detach();
+  m_Memory.setNativeKey(native_key);
+
+  if (!m_Memory.attach(QSharedMemory::ReadOnly))
+  {
+    return false;
+  }
+
+  const LiveReloadSharedMemoryHeader* const header = ringHeader(m_Memory);
+
+  const bool is_valid = m_Memory.size() >= qsizetype(sizeof(LiveReloadSharedMemoryHeader)) &&
+                        std::memcmp(header->magic, LiveReloadSharedMemoryHeader::k_Magic, sizeof(header->magic)) == 0 &&
+                        header->version == k_LiveReloadProtocolVersion &&
+                        header->capacity <= std::uint64_t(m_Memory.size()) - sizeof(LiveReloadSharedMemoryHeader);
+
+  if (!is_valid)
+  {
+    m_Memory.detach();
+  }
+
+  return is_valid;
+}
+
+QByteArray LiveReloadSharedMemoryReader::read(quint64 offset, qsizetype size)
+{
+  if (!isOpen())
+  {
+    return {};
+  }
+
+  LiveReloadSharedMemoryHeader* const header   = ringHeader(m_Memory);
+  const qsizetype                     capacity = qsizetype(header->capacity);
+
+  if (size > capacity || offset + size > header->write_offset.load(std::memory_order_acquire))
+  {
+    return {};
+  }
+
+  const char* const ring        = ringData(m_Memory);
+  const qsizetype   start       = qsizetype(offset % std::uint64_t(capacity));
+  const qsizetype   first_chunk = std::min(size, capacity - start);
+  QByteArray        result(size, Qt::Uninitialized);
+
+  std::memcpy(result.data(), ring + start, first_chunk);
+  std::memcpy(result.data() + first_chunk, ring, size - first_chunk);
+
+  // Pairs with the fence in 'publish', anything the copy saw half written shows up as a later 'write_offset'.
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  if (header->write_offset.load(std::memory_order_relaxed) > offset + std::uint64_t(capacity))
+  {
+    return {};
+  }
+
+  return result;
+}
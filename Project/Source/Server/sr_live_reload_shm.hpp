@@ -0,0 +1,62 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_shm.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_LIVE_RELOAD_SHM_HPP
+#define SR_LIVE_RELOAD_SHM_HPP
+
+#include "sr_live_reload_protocol.hpp"  // LiveReloadSharedMemoryHeader
+
+#include <QByteArray>     // QByteArray
+#include <QSharedMemory>  // QSharedMemory
+#include <QString>        // QString
+
+// NOTE(SR):
+//   Only created once a client asks for it with 'LiveReloadCapability_SharedMemory'.
+//   The editor never waits on readers, a client that falls a whole ring behind sees its
+//   packet was overwritten (see 'LiveReloadSharedMemoryHeader::write_offset') and has to skip it.
+
+constexpr const char* const k_LiveReloadSharedMemoryKey       = "SRSM.LiveReload";
+constexpr qsizetype         k_LiveReloadSharedMemoryCapacity  = 64 * 1024 * 1024;
+constexpr qsizetype         k_LiveReloadSharedMemoryMinPacket = 64 * 1024;  //!< Anything smaller is cheaper to just send over the socket.
+
+// The editor's (only) writer side of the ring.
+class LiveReloadSharedMemory final
+{
+ private:
+  QSharedMemory m_Memory;
+
+ public:
+  LiveReloadSharedMemory();
+
+  bool    isOpen() const { return m_Memory.isAttached(); }
+  QString nativeKey() const { return m_Memory.nativeKey(); }
+  bool    open(qsizetype capacity);
+
+  // Copies `packet` into the ring, returns its stream offset or -1 if it does not fit.
+  qint64 publish(const QByteArray& packet);
+
+  ~LiveReloadSharedMemory();
+};
+
+// The reader side, for clients.
+class LiveReloadSharedMemoryReader final
+{
+ private:
+  QSharedMemory m_Memory;
+
+ public:
+  LiveReloadSharedMemoryReader();
+
+  bool isOpen() const { return m_Memory.isAttached(); }
+  bool open(const QString& native_key);
+
+  // Copies a packet out of the ring, returns an empty array if it was already (or is being) overwritten.
+  QByteArray read(quint64 offset, qsizetype size);
+};
+
+#endif  // SR_LIVE_RELOAD_SHM_HPP
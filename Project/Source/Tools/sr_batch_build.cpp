@@ -0,0 +1,516 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_batch_build.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_batch_build.hpp"
+
+#include "Data/sr_atlas_builder.hpp"  // atlasDecodeImage, atlasLayoutImages, atlasCompositePage, atlasWritePageStreaming
+#include "Data/sr_build_cache.hpp"    // BuildCacheKey, buildCacheFetch
+#include "Data/sr_png_encoder.hpp"    // pngWriteFile
+#include "Data/sr_project_file.hpp"   // ProjectFile
+
+#include <QDir>           // QDir
+#include <QDirIterator>   // QDirIterator
+#include <QElapsedTimer>  // QElapsedTimer
+#include <QFile>          // QFile
+#include <QFileInfo>      // QFileInfo
+#include <QMutex>         // QMutex
+#include <QMutexLocker>   // QMutexLocker
+#include <QTextStream>    // QTextStream
+#include <QThreadPool>    // QThreadPool
+
+#include <atomic>   // atomic_int, atomic_bool, atomic<T>
+#include <memory>   // unique_ptr<T>
+#include <utility>  // move
+
+static constexpr int k_MaxManifestDepth = 8;
+
+namespace
+{
+  struct BatchProjectState final
+  {
+    BatchBuildResult    result;
+    ProjectFile         project;
+    AtlasDecodeResult   decoded_images;
+    AtlasLayout         layout;
+    std::vector<QImage> pages;
+    QString             cache_key;        //!< Empty if the build cache is not used.
+    QString             cache_entry_dir;  //!< Where the export is being written if it is going into the build cache.
+    QElapsedTimer       timer;
+    std::atomic_int     num_jobs_left;  //!< Of the current stage, the last job of a stage starts the next.
+    std::atomic_bool    has_failed;
+    QMutex              error_lock;
+    std::atomic<qint64> input_bytes;
+    std::atomic<qint64> output_bytes;
+    std::atomic<qint64> stage_time_ns[int(BatchStage::Count)];
+  };
+
+  class BatchBuilder final
+  {
+   private:
+    QThreadPool                                     m_Pool;
+    BatchBuildOptions                               m_Options;
+    std::vector<std::unique_ptr<BatchProjectState>> m_Projects;
+
+   public:
+    BatchBuilder(const QStringList& project_paths, const BatchBuildOptions& options);
+
+    std::vector<BatchBuildResult> run();
+
+   private:
+    template<typename F>
+    void startJob(BatchProjectState& state, BatchStage stage, F&& job);
+
+    void startLoad(BatchProjectState& state);
+    void startDecode(BatchProjectState& state);
+    void startLayout(BatchProjectState& state);
+    void startComposite(BatchProjectState& state);
+    void startExport(BatchProjectState& state);
+    void writeSpritesheet(BatchProjectState& state, const QString& export_dir, const QString& export_name);
+    void commitToCache(BatchProjectState& state);
+    QString computeCacheKey(BatchProjectState& state);
+    QString exportDir(const BatchProjectState& state) const;
+    void finish(BatchProjectState& state);
+    void fail(BatchProjectState& state, const QString& error);
+    bool finishJob(BatchProjectState& state);
+  };
+}  // namespace
+
+static void collectProjects(const QString& path, int depth, QStringList& out_projects, QStringList& out_errors)
+{
+  const QFileInfo info(path);
+
+  if (info.isDir())
+  {
+    QDirIterator it(info.absoluteFilePath(), QStringList{"*.srsmproj.json", "*.srsmproj.bin"}, QDir::Files, QDirIterator::Subdirectories);
+    QStringList  found_projects = {};
+
+    while (it.hasNext())
+    {
+      found_projects.push_back(it.next());
+    }
+
+    found_projects.sort();
+
+    for (const QString& project_path : found_projects)
+    {
+      // A project saved in both formats is only built once, from the json.
+      if (!project_path.endsWith(".srsmproj.bin") || !found_projects.contains(project_path.chopped(4) + ".json"))
+      {
+        out_projects.push_back(project_path);
+      }
+    }
+  }
+  else if (info.isFile() && (path.endsWith(".srsmproj.json") || path.endsWith(".srsmproj.bin")))
+  {
+    out_projects.push_back(info.absoluteFilePath());
+  }
+  else if (info.isFile())
+  {
+    QFile manifest(path);
+
+    if (depth >= k_MaxManifestDepth || !manifest.open(QFile::ReadOnly | QFile::Text))
+    {
+      out_errors.push_back(QString("Failed to read manifest '%1'.").arg(path));
+      return;
+    }
+
+    QTextStream stream(&manifest);
+
+    while (!stream.atEnd())
+    {
+      const QString line = stream.readLine().trimmed();
+
+      if (!line.isEmpty() && !line.startsWith('#'))
+      {
+        collectProjects(info.dir().absoluteFilePath(line), depth + 1, out_projects, out_errors);
+      }
+    }
+  }
+  else
+  {
+    out_errors.push_back(QString("'%1' does not exist.").arg(path));
+  }
+}
+
+QStringList batchCollectProjects(const QStringList& paths, QStringList& out_errors)
+{
+  QStringList result = {};
+
+  for (const QString& path : paths)
+  {
+    collectProjects(path, 0, result, out_errors);
+  }
+
+  result.removeDuplicates();
+
+  return result;
+}
+
+std::vector<BatchBuildResult> batchBuildProjects(const QStringList& project_paths, const BatchBuildOptions& options)
+{
+  BatchBuilder builder{project_paths, options};
+
+  return builder.run();
+}
+
+BatchBuilder::BatchBuilder(const QStringList& project_paths, const BatchBuildOptions& options) :
+  m_Pool{},
+  m_Options{options},
+  m_Projects{}
+{
+  m_Pool.setMaxThreadCount(atlasResolveThreadCount(options.num_threads));
+
+  m_Projects.reserve(project_paths.size());
+
+  for (const QString& project_path : project_paths)
+  {
+    BatchProjectState& state = *m_Projects.emplace_back(std::make_unique<BatchProjectState>());
+
+    state.result              = BatchBuildResult{};
+    state.result.project_path = project_path;
+    state.num_jobs_left       = 0;
+    state.has_failed          = false;
+    state.input_bytes         = 0;
+    state.output_bytes        = 0;
+
+    for (std::atomic<qint64>& stage_time : state.stage_time_ns)
+    {
+      stage_time = 0;
+    }
+  }
+}
+
+std::vector<BatchBuildResult> BatchBuilder::run()
+{
+  for (const auto& state : m_Projects)
+  {
+    startLoad(*state);
+  }
+
+  m_Pool.waitForDone();
+
+  std::vector<BatchBuildResult> results = {};
+  results.reserve(m_Projects.size());
+
+  for (const auto& state : m_Projects)
+  {
+    results.push_back(std::move(state->result));
+  }
+
+  return results;
+}
+
+template<typename F>
+void BatchBuilder::startJob(BatchProjectState& state, BatchStage stage, F&& job)
+{
+  // NOTE(SR):
+  //   The priority of a job is its stage so a project that has started is pushed through
+  //   ahead of decoding new ones, this keeps the number of projects with images in memory low.
+
+  m_Pool.start(
+   [&state, stage, job = std::forward<F>(job)]() {
+     QElapsedTimer timer;
+     timer.start();
+
+     job();
+
+     state.stage_time_ns[int(stage)].fetch_add(timer.nsecsElapsed(), std::memory_order_relaxed);
+   },
+   int(stage));
+}
+
+void BatchBuilder::startLoad(BatchProjectState& state)
+{
+  startJob(state, BatchStage::Load, [this, &state]() {
+    state.timer.start();
+
+    QString error = {};
+
+    if (!projectFileLoad(state.result.project_path, state.project, error))
+    {
+      fail(state, error);
+      finish(state);
+      return;
+    }
+
+    state.result.name       = state.project.name;
+    state.result.num_images = state.project.abs_image_paths.size();
+
+    if (state.project.abs_image_paths.isEmpty())
+    {
+      fail(state, "The project has no images.");
+      finish(state);
+      return;
+    }
+
+    state.cache_key = computeCacheKey(state);
+
+    if (!state.cache_key.isEmpty() && buildCacheFetch(m_Options.cache_dir, state.cache_key, exportDir(state), state.project.name))
+    {
+      state.result.is_cached = true;
+      finish(state);
+      return;
+    }
+
+    startDecode(state);
+  });
+}
+
+void BatchBuilder::startDecode(BatchProjectState& state)
+{
+  const int num_images = state.project.abs_image_paths.size();
+
+  state.decoded_images.images.resize(num_images);
+  state.decoded_images.image_hashes.resize(num_images, 0u);
+  state.num_jobs_left = num_images;
+
+  // NOTE(SR): Hashing for the cache key already counted the images, each one is only counted once (by the decode).
+  state.input_bytes = 0;
+
+  for (int i = 0; i < num_images; ++i)
+  {
+    startJob(state, BatchStage::Decode, [this, &state, i]() {
+      const QString& abs_image_path = state.project.abs_image_paths[i];
+
+      // Each slot is only ever written by a single job so no locking is needed.
+      atlasDecodeImage(abs_image_path, state.decoded_images.images[i], state.decoded_images.image_hashes[i]);
+
+      state.input_bytes.fetch_add(QFileInfo(abs_image_path).size(), std::memory_order_relaxed);
+
+      if (state.decoded_images.images[i].isNull())
+      {
+        fail(state, QString("Failed to load image: '%1'").arg(abs_image_path));
+      }
+
+      if (finishJob(state))
+      {
+        startLayout(state);
+      }
+    });
+  }
+}
+
+void BatchBuilder::startLayout(BatchProjectState& state)
+{
+  if (state.has_failed)
+  {
+    finish(state);
+    return;
+  }
+
+  startJob(state, BatchStage::Layout, [this, &state]() {
+    atlasLayoutImages(state.decoded_images, state.project.settings, state.layout);
+
+    state.result.num_unique_frames = int(state.layout.uv_frame_images.size());
+    state.result.num_pages         = int(state.layout.page_sizes.size());
+
+    // NOTE(SR): A streamed page is composited as it is encoded, the whole page is never held in memory.
+    if (m_Options.stream_pages)
+    {
+      startExport(state);
+    }
+    else
+    {
+      startComposite(state);
+    }
+  });
+}
+
+void BatchBuilder::startComposite(BatchProjectState& state)
+{
+  const int num_pages = int(state.layout.page_sizes.size());
+
+  state.pages.resize(num_pages);
+  state.num_jobs_left = num_pages;
+
+  for (int page_index = 0; page_index < num_pages; ++page_index)
+  {
+    startJob(state, BatchStage::Composite, [this, &state, page_index]() {
+      state.pages[page_index] = atlasCompositePage(state.decoded_images.images, state.project.settings, state.layout, page_index);
+
+      if (finishJob(state))
+      {
+        // The decoded images are no longer needed, free them before the (slow) export.
+        state.decoded_images = AtlasDecodeResult{};
+
+        startExport(state);
+      }
+    });
+  }
+}
+
+void BatchBuilder::startExport(BatchProjectState& state)
+{
+  const int num_pages = int(state.layout.page_sizes.size());
+
+  if (!state.cache_key.isEmpty())
+  {
+    state.cache_entry_dir = buildCacheBeginEntry(m_Options.cache_dir, state.cache_key);
+  }
+
+  // Written into the cache first then linked out from there, if the cache can not be used straight to the destination.
+  const QString export_dir  = state.cache_entry_dir.isEmpty() ? exportDir(state) : state.cache_entry_dir;
+  const QString export_name = state.cache_entry_dir.isEmpty() ? state.project.name : buildCacheEntryName();
+
+  state.num_jobs_left = num_pages;
+
+  for (int page_index = 0; page_index < num_pages; ++page_index)
+  {
+    startJob(state, BatchStage::Export, [this, &state, page_index, export_dir, export_name]() {
+      const QString image_path = QDir(export_dir).filePath(atlasPageFileName(export_name, page_index));
+
+      // May be a hard link into the build cache from an earlier build.
+      QFile::remove(image_path);
+
+      // The alpha mode is the project's, it has to agree with the "ALPH" chunk of its spritesheet data.
+      PngEncodeOptions png_options    = m_Options.png_options;
+      png_options.premultiplied_alpha = state.project.settings.premultiplied_alpha;
+
+      const bool is_written = m_Options.stream_pages ? atlasWritePageStreaming(image_path, state.decoded_images.images, state.project.settings, state.layout, page_index, png_options) :
+                                                       pngWriteFile(state.pages[page_index], image_path, png_options);
+
+      if (is_written)
+      {
+        state.output_bytes.fetch_add(QFileInfo(image_path).size(), std::memory_order_relaxed);
+      }
+      else
+      {
+        fail(state, QString("Failed to write '%1'.").arg(image_path));
+      }
+
+      if (!m_Options.stream_pages)
+      {
+        state.pages[page_index] = QImage();
+      }
+
+      if (finishJob(state))
+      {
+        state.decoded_images = AtlasDecodeResult{};
+
+        // Only write out bytes if we were able to save every page.
+        if (!state.has_failed)
+        {
+          writeSpritesheet(state, export_dir, export_name);
+        }
+
+        if (!state.cache_entry_dir.isEmpty())
+        {
+          commitToCache(state);
+        }
+
+        finish(state);
+      }
+    });
+  }
+}
+
+void BatchBuilder::writeSpritesheet(BatchProjectState& state, const QString& export_dir, const QString& export_name)
+{
+  const QString bytes_path = QDir(export_dir).filePath(export_name + ".srsm.bytes");
+
+  std::uint64_t                          atlas_data_size = 0u;
+  const std::unique_ptr<unsigned char[]> atlas_data      = atlasBuildSpritesheetData(state.project.edit_uuid, state.layout, projectFileAtlasAnimations(state.project, state.layout), atlas_data_size);
+
+  if (atlasWriteSpritesheetFile(bytes_path, atlas_data.get(), atlas_data_size, atlasBuildExtensionData(state.layout, state.project.settings)))
+  {
+    state.output_bytes.fetch_add(QFileInfo(bytes_path).size(), std::memory_order_relaxed);
+  }
+  else
+  {
+    fail(state, QString("Failed to write '%1'.").arg(bytes_path));
+  }
+}
+
+void BatchBuilder::commitToCache(BatchProjectState& state)
+{
+  if (state.has_failed)
+  {
+    QDir(state.cache_entry_dir).removeRecursively();
+    return;
+  }
+
+  const QString export_dir = exportDir(state);
+
+  if (!buildCacheCommitEntry(m_Options.cache_dir, state.cache_key, state.cache_entry_dir, k_BuildCacheMaxEntries) ||
+      !buildCacheFetch(m_Options.cache_dir, state.cache_key, export_dir, state.project.name))
+  {
+    fail(state, QString("Failed to copy the export from the build cache to '%1'.").arg(export_dir));
+  }
+}
+
+QString BatchBuilder::computeCacheKey(BatchProjectState& state)
+{
+  if (m_Options.cache_dir.isEmpty())
+  {
+    return {};
+  }
+
+  BuildCacheKey key = {state.project.settings, m_Options.png_options.compression_level, state.project.edit_uuid};
+
+  for (const QString& abs_image_path : state.project.abs_image_paths)
+  {
+    // A missing image is reported by the decode stage.
+    if (!key.addImageFile(abs_image_path))
+    {
+      return {};
+    }
+
+    state.input_bytes.fetch_add(QFileInfo(abs_image_path).size(), std::memory_order_relaxed);
+  }
+
+  for (const ProjectFileAnimation& animation : state.project.animations)
+  {
+    key.addAnimation(animation.name, int(animation.frames.size()));
+
+    for (const ProjectFileFrame& frame : animation.frames)
+    {
+      key.addFrame(frame.image_index, frame.frame_time);
+    }
+  }
+
+  return key.result();
+}
+
+QString BatchBuilder::exportDir(const BatchProjectState& state) const
+{
+  return m_Options.output_dir.isEmpty() ? state.project.project_folder.absolutePath() : m_Options.output_dir;
+}
+
+void BatchBuilder::finish(BatchProjectState& state)
+{
+  // NOTE(SR): Only ever called by the last job of a project so the result is not shared.
+
+  state.result.wall_time_ms = state.timer.elapsed();
+  state.result.input_bytes  = state.input_bytes.load(std::memory_order_relaxed);
+  state.result.output_bytes = state.output_bytes.load(std::memory_order_relaxed);
+
+  // The time of the job calling this is still being counted, it will be (slightly) missing from its stage.
+  for (int i = 0; i < int(BatchStage::Count); ++i)
+  {
+    state.result.stage_time_ms[i] = state.stage_time_ns[i].load(std::memory_order_relaxed) / 1000000;
+  }
+
+  state.layout = AtlasLayout{};
+  state.pages.clear();
+}
+
+void BatchBuilder::fail(BatchProjectState& state, const QString& error)
+{
+  const QMutexLocker lock(&state.error_lock);
+
+  // Only the first error is kept, the rest tend to be caused by it.
+  if (!state.has_failed.exchange(true))
+  {
+    state.result.error = error;
+  }
+}
+
+bool BatchBuilder::finishJob(BatchProjectState& state)
+{
+  return state.num_jobs_left.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
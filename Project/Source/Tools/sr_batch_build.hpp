@@ -0,0 +1,63 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_batch_build.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_BATCH_BUILD_HPP
+#define SR_BATCH_BUILD_HPP
+
+#include "Data/sr_png_encoder.hpp"  // PngEncodeOptions
+
+#include <QString>      // QString
+#include <QStringList>  // QStringList
+
+#include <vector>  // vector<T>
+
+enum class BatchStage
+{
+  Load,
+  Decode,
+  Layout,
+  Composite,
+  Export,
+
+  Count,
+};
+
+struct BatchBuildOptions final
+{
+  QString          output_dir;   //!< Overrides where each project is exported to, empty means the project's folder.
+  QString          cache_dir;    //!< The build cache to use (see 'buildCacheFetch'), empty means it is not used.
+  int              num_threads;  //!< Size of the pool shared by every project, 0 or less uses one per core.
+  PngEncodeOptions png_options;   //!< Each page is one job so 'num_threads' here is per page on top of the pool, 'premultiplied_alpha' comes from each project.
+  bool             stream_pages;  //!< Composite each page in bands straight into its png ('atlasWritePageStreaming'), the composite time is then part of the export stage.
+};
+
+struct BatchBuildResult final
+{
+  QString project_path;
+  QString name;
+  QString error;                                //!< Empty if the project was built and exported.
+  bool    is_cached;                            //!< The export was taken from the build cache, only 'num_images' and the load stage are filled in.
+  int     num_images;                           //!<
+  int     num_unique_frames;                    //!<
+  int     num_pages;                            //!<
+  qint64  input_bytes;                          //!< Size of the source image files, each counted once even though a cache miss reads them to hash and to decode.
+  qint64  output_bytes;                         //!< Size of the files written.
+  qint64  wall_time_ms;                         //!< From the project starting to load to its last file being written.
+  qint64  stage_time_ms[int(BatchStage::Count)];  //!< Summed time of the jobs of each stage, these run in parallel so can add up to more than 'wall_time_ms'.
+};
+
+// Expands `paths` into a list of '.srsmproj.json' / '.srsmproj.bin' files, each path is either a project file,
+// a directory that is searched recursively or a manifest listing one such path per line ('#' starts a comment).
+QStringList batchCollectProjects(const QStringList& paths, QStringList& out_errors);
+
+// Builds and exports every project on a single pool of 'BatchBuildOptions::num_threads' workers,
+// the jobs of all projects share the pool so one project's serial stages overlap with the work of the others.
+// The results are parallel to `project_paths`.
+std::vector<BatchBuildResult> batchBuildProjects(const QStringList& project_paths, const BatchBuildOptions& options);
+
+#endif  // SR_BATCH_BUILD_HPP
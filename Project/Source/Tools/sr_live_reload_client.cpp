@@ -0,0 +1,365 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_client.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_live_reload_client.hpp"
+
+#include "Server/sr_live_reload_codec.hpp"  // liveReloadDecompress
+
+#include <chrono>   // steady_clock
+#include <cstring>  // memcpy
+#include <vector>   // vector<T>
+
+using PacketHeader = SpriteAnim::LiveReloadPacketHeader;
+
+// The animation data the add / rename / frames changed packets end with, it must fill the rest of the packet.
+static QString checkAnimationData(const char* data, qsizetype size)
+{
+  SpriteAnim::SpriteAnimation animation;
+
+  if (size < qsizetype(sizeof(animation)))
+  {
+    return "animation data is cut off";
+  }
+
+  std::memcpy(&animation, data, sizeof(animation));
+
+  const qsizetype expected_size = qsizetype(sizeof(animation)) +
+                                  qsizetype(animation.name.num_elements) * qsizetype(sizeof(char)) +
+                                  qsizetype(animation.frames.num_elements) * qsizetype(sizeof(SpriteAnim::SpriteAnimationFrame));
+
+  if (expected_size != size)
+  {
+    return QString("animation data is %1 bytes but the name / frame counts add up to %2").arg(size).arg(expected_size);
+  }
+
+  return {};
+}
+
+LiveReloadTestClient::LiveReloadTestClient(std::uint32_t capabilities, QObject* parent) :
+  QObject(parent),
+  m_Socket{this},
+  m_Buffer{},
+  m_Capabilities{capabilities},
+  m_SharedMemory{},
+  m_Atlases{},
+  m_Stats{{}, 0, 0, 0, 0}
+{
+  QObject::connect(&m_Socket, &QTcpSocket::connected, this, &LiveReloadTestClient::onConnected);
+  QObject::connect(&m_Socket, &QTcpSocket::readyRead, this, &LiveReloadTestClient::onReadyRead);
+  QObject::connect(&m_Socket, &QTcpSocket::disconnected, this, &LiveReloadTestClient::disconnected);
+}
+
+std::uint32_t LiveReloadTestClient::supportedCapabilities()
+{
+  std::uint32_t capabilities = LiveReloadCapability_AtlasRegions | LiveReloadCapability_SharedMemory;
+
+  if (liveReloadCodecIsAvailable(LiveReloadCodec::LZ4))
+  {
+    capabilities |= LiveReloadCapability_LZ4;
+  }
+
+  if (liveReloadCodecIsAvailable(LiveReloadCodec::Zstd))
+  {
+    capabilities |= LiveReloadCapability_Zstd;
+  }
+
+  return capabilities;
+}
+
+QString LiveReloadTestClient::packetTypeName(std::uint32_t type)
+{
+  switch (type)
+  {
+    case PacketHeader::AnimationAdded: return "AnimationAdded";
+    case PacketHeader::AnimationRenamed: return "AnimationRenamed";
+    case PacketHeader::AnimationFramesChanged: return "AnimationFramesChanged";
+    case PacketHeader::AnimationRemoved: return "AnimationRemoved";
+    case PacketHeader::AtlasTextureChanged: return "AtlasTextureChanged";
+    case k_LiveReloadPacket_AtlasRegionsChanged: return "AtlasRegionsChanged";
+    case k_LiveReloadPacket_Compressed: return "Compressed";
+    case k_LiveReloadPacket_SharedMemory: return "SharedMemory";
+  }
+
+  return QString("Unknown(%1)").arg(type);
+}
+
+qint64 LiveReloadTestClient::clockNs()
+{
+  return qint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void LiveReloadTestClient::connectToEditor(const QString& host, quint16 port)
+{
+  m_Socket.connectToHost(host, port);
+}
+
+void LiveReloadTestClient::onConnected()
+{
+  if (m_Capabilities != 0u)
+  {
+    LiveReloadClientHello hello;
+    std::memcpy(hello.magic, LiveReloadClientHello::k_Magic, sizeof(hello.magic));
+    hello.version      = k_LiveReloadProtocolVersion;
+    hello.capabilities = m_Capabilities;
+
+    m_Socket.write((const char*)&hello, sizeof(hello));
+  }
+}
+
+void LiveReloadTestClient::onReadyRead()
+{
+  const qint64     received_ns = clockNs();
+  const QByteArray received    = m_Socket.readAll();
+
+  m_Stats.num_socket_bytes += received.size();
+  m_Buffer += received;
+
+  qsizetype read_offset = 0;
+
+  while (m_Buffer.size() - read_offset >= qsizetype(sizeof(PacketHeader)))
+  {
+    PacketHeader header;
+    std::memcpy(&header, m_Buffer.constData() + read_offset, sizeof(header));
+
+    const qsizetype packet_size = qsizetype(sizeof(header)) + qsizetype(header.packet_size);
+
+    if (m_Buffer.size() - read_offset < packet_size)
+    {
+      break;
+    }
+
+    std::uint32_t type        = std::uint32_t(liveReloadPacketType(header));
+    QUuid         spritesheet = {};
+    const QString error       = checkPacket(m_Buffer.mid(read_offset, packet_size), false, type, spritesheet);
+
+    if (!error.isEmpty())
+    {
+      ++m_Stats.num_invalid;
+    }
+
+    ++m_Stats.num_packets[packetTypeName(type)];
+    emit packetReceived(type, spritesheet, packet_size, error, received_ns);
+
+    read_offset += packet_size;
+  }
+
+  m_Buffer.remove(0, read_offset);
+}
+
+QString LiveReloadTestClient::checkPacket(const QByteArray& packet, bool is_wrapped, std::uint32_t& out_type, QUuid& out_spritesheet)
+{
+  PacketHeader header;
+
+  if (packet.size() < qsizetype(sizeof(header)))
+  {
+    return "packet is smaller than its header";
+  }
+
+  std::memcpy(&header, packet.constData(), sizeof(header));
+  std::memcpy(&out_spritesheet, &header.target_spritesheet, sizeof(QUuid));
+
+  out_type = std::uint32_t(liveReloadPacketType(header));
+
+  if (qsizetype(sizeof(header)) + qsizetype(header.packet_size) != packet.size())
+  {
+    return QString("packet_size says %1 bytes but there are %2").arg(header.packet_size).arg(packet.size() - qsizetype(sizeof(header)));
+  }
+
+  const char* const payload      = packet.constData() + sizeof(header);
+  const qsizetype   payload_size = qsizetype(header.packet_size);
+  const qsizetype   target_size  = qsizetype(header.target_animation.num_elements) * qsizetype(sizeof(char));
+
+  switch (out_type)
+  {
+    case PacketHeader::AnimationAdded:
+    case PacketHeader::AnimationFramesChanged:
+    {
+      return checkAnimationData(payload, payload_size);
+    }
+    case PacketHeader::AnimationRenamed:
+    {
+      // The old name comes first.
+      if (target_size > payload_size)
+      {
+        return "old animation name is cut off";
+      }
+
+      return checkAnimationData(payload + target_size, payload_size - target_size);
+    }
+    case PacketHeader::AnimationRemoved:
+    {
+      return target_size == payload_size ? QString() : QString("name is %1 bytes but the packet has %2").arg(target_size).arg(payload_size);
+    }
+    case PacketHeader::AtlasTextureChanged:
+    {
+      return checkAtlasTexture(out_spritesheet, payload, payload_size);
+    }
+    case k_LiveReloadPacket_AtlasRegionsChanged:
+    {
+      return checkAtlasRegions(out_spritesheet, payload, payload_size);
+    }
+    case k_LiveReloadPacket_Compressed:
+    {
+      LiveReloadPacketCompressed compressed;
+
+      if (is_wrapped || payload_size < qsizetype(sizeof(compressed)))
+      {
+        return is_wrapped ? "compressed packets can not be nested" : "compressed header is cut off";
+      }
+
+      std::memcpy(&compressed, payload, sizeof(compressed));
+
+      const QByteArray inner = liveReloadDecompress(LiveReloadCodec(compressed.codec),
+                                                    payload + sizeof(compressed),
+                                                    payload_size - qsizetype(sizeof(compressed)),
+                                                    qsizetype(compressed.uncompressed_size));
+
+      if (inner.isEmpty())
+      {
+        return QString("failed to decompress with codec %1").arg(compressed.codec);
+      }
+
+      const QUuid outer_spritesheet = out_spritesheet;
+      const auto  error             = checkPacket(inner, true, out_type, out_spritesheet);
+
+      return error.isEmpty() && outer_spritesheet != out_spritesheet ? "compressed packet targets a different spritesheet than what it wraps" : error;
+    }
+    case k_LiveReloadPacket_SharedMemory:
+    {
+      LiveReloadPacketSharedMemory shared_memory;
+
+      if (is_wrapped || payload_size < qsizetype(sizeof(shared_memory)))
+      {
+        return is_wrapped ? "shared memory packets can not be nested" : "shared memory header is cut off";
+      }
+
+      std::memcpy(&shared_memory, payload, sizeof(shared_memory));
+
+      if (qsizetype(sizeof(shared_memory)) + qsizetype(shared_memory.key_length) != payload_size)
+      {
+        return "shared memory key length does not match packet_size";
+      }
+
+      const QString native_key = QString::fromUtf8(payload + sizeof(shared_memory), shared_memory.key_length);
+
+      if (!m_SharedMemory.open(native_key))
+      {
+        return QString("failed to open the shared memory '%1'").arg(native_key);
+      }
+
+      const QByteArray inner = m_SharedMemory.read(shared_memory.offset, qsizetype(shared_memory.size));
+
+      if (inner.isEmpty())
+      {
+        // Only atlases are shared so the mirror is out of date, regions that follow must not be checked against it.
+        ++m_Stats.num_overwritten;
+        m_Atlases.remove(out_spritesheet);
+        return "shared memory packet was overwritten before it was read, the atlas is out of sync";
+      }
+
+      m_Stats.num_shared_bytes += inner.size();
+
+      return checkPacket(inner, true, out_type, out_spritesheet);
+    }
+  }
+
+  return "unknown packet type";
+}
+
+QString LiveReloadTestClient::checkAtlasTexture(const QUuid& spritesheet, const char* payload, qsizetype payload_size)
+{
+  binaryIO::rel_array32<char> texture_data;
+  std::uint16_t               atlas_size[2];
+
+  if (payload_size < qsizetype(sizeof(texture_data) + sizeof(atlas_size)))
+  {
+    return "atlas header is cut off";
+  }
+
+  std::memcpy(&texture_data, payload, sizeof(texture_data));
+  std::memcpy(atlas_size, payload + sizeof(texture_data), sizeof(atlas_size));
+
+  const qsizetype num_pixel_bytes = qsizetype(atlas_size[0]) * qsizetype(atlas_size[1]) * 4;
+
+  if (qsizetype(texture_data.num_elements) != num_pixel_bytes)
+  {
+    return QString("atlas is %1x%2 but has %3 bytes of pixels").arg(atlas_size[0]).arg(atlas_size[1]).arg(texture_data.num_elements);
+  }
+
+  if (payload_size != qsizetype(sizeof(SpriteAnim::LiveReloadPacketAtlasTexture)) + num_pixel_bytes ||
+      payload_size < qsizetype(sizeof(texture_data) + sizeof(atlas_size)) + num_pixel_bytes)
+  {
+    return "atlas pixels do not fill the packet";
+  }
+
+  m_Atlases[spritesheet] = AtlasMirror{atlas_size[0], atlas_size[1], QByteArray(payload + payload_size - num_pixel_bytes, num_pixel_bytes)};
+
+  return {};
+}
+
+QString LiveReloadTestClient::checkAtlasRegions(const QUuid& spritesheet, const char* payload, qsizetype payload_size)
+{
+  LiveReloadPacketAtlasRegions header;
+
+  if (payload_size < qsizetype(sizeof(header)))
+  {
+    return "regions header is cut off";
+  }
+
+  std::memcpy(&header, payload, sizeof(header));
+
+  const auto mirror = m_Atlases.find(spritesheet);
+
+  if (mirror == m_Atlases.end() || mirror->width != header.atlas_width || mirror->height != header.atlas_height)
+  {
+    return "regions sent without a full atlas of the same size first";
+  }
+
+  const qsizetype regions_size = qsizetype(header.num_regions) * qsizetype(sizeof(LiveReloadAtlasRegion));
+
+  if (payload_size - qsizetype(sizeof(header)) < regions_size)
+  {
+    return "region list is cut off";
+  }
+
+  std::vector<LiveReloadAtlasRegion> regions(header.num_regions);
+  std::memcpy(regions.data(), payload + sizeof(header), regions_size);
+
+  qsizetype num_pixel_bytes = 0;
+
+  for (const LiveReloadAtlasRegion& region : regions)
+  {
+    if (region.width == 0 || region.height == 0 || region.x + region.width > header.atlas_width || region.y + region.height > header.atlas_height)
+    {
+      return QString("region %1,%2 %3x%4 is outside of the atlas").arg(region.x).arg(region.y).arg(region.width).arg(region.height);
+    }
+
+    num_pixel_bytes += qsizetype(region.width) * region.height * 4;
+  }
+
+  const char* pixels = payload + sizeof(header) + regions_size;
+
+  if (pixels + num_pixel_bytes != payload + payload_size)
+  {
+    return "region pixels do not fill the packet";
+  }
+
+  // Apply them so the next regions are checked against the right atlas.
+  for (const LiveReloadAtlasRegion& region : regions)
+  {
+    const qsizetype row_size = qsizetype(region.width) * 4;
+
+    for (int y = region.y; y < region.y + region.height; ++y)
+    {
+      std::memcpy(mirror->pixels.data() + (qsizetype(y) * mirror->width + region.x) * 4, pixels, row_size);
+      pixels += row_size;
+    }
+  }
+
+  return {};
+}
@@ -0,0 +1,86 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_client.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_LIVE_RELOAD_CLIENT_HPP
+#define SR_LIVE_RELOAD_CLIENT_HPP
+
+#include "Server/sr_live_reload_protocol.hpp"  // LiveReloadCapability
+#include "Server/sr_live_reload_shm.hpp"       // LiveReloadSharedMemoryReader
+
+#include <QByteArray>  // QByteArray
+#include <QHash>       // QHash
+#include <QMap>        // QMap
+#include <QObject>     // QObject
+#include <QTcpSocket>  // QTcpSocket
+#include <QUuid>       // QUuid
+
+// NOTE(SR):
+//   A stand in for an engine, it parses every packet the editor can send and checks it is well formed.
+//   The atlas of each spritesheet is mirrored so region updates are checked against what they apply to.
+
+struct LiveReloadClientStats final
+{
+  QMap<QString, qint64> num_packets;       //!< By packet type name, wrapped packets are counted once as what they wrap.
+  qint64                num_socket_bytes;  //!< Read from the socket.
+  qint64                num_shared_bytes;  //!< Read from the shared memory ring.
+  qint64                num_invalid;       //!< Packets that failed a check, 'num_overwritten' included.
+  qint64                num_overwritten;   //!< Shared memory packets lost to the ring wrapping around before they were read, each leaves the atlas out of sync.
+};
+
+class LiveReloadTestClient final : public QObject
+{
+  Q_OBJECT
+
+ private:
+  struct AtlasMirror final
+  {
+    int        width;
+    int        height;
+    QByteArray pixels;
+  };
+
+ private:
+  QTcpSocket                   m_Socket;
+  QByteArray                   m_Buffer;        //!< Received bytes not yet making up a whole packet.
+  std::uint32_t                m_Capabilities;  //!< Sent in the hello, 0 connects as a plain client that sends nothing.
+  LiveReloadSharedMemoryReader m_SharedMemory;
+  QHash<QUuid, AtlasMirror>    m_Atlases;
+  LiveReloadClientStats        m_Stats;
+
+ public:
+  explicit LiveReloadTestClient(std::uint32_t capabilities, QObject* parent = nullptr);
+
+  // What this build can handle, LZ4 / zstd depend on what it was built with.
+  static std::uint32_t supportedCapabilities();
+  static QString       packetTypeName(std::uint32_t type);
+
+  // Monotonic time in nanoseconds, what the 'received_ns' of 'packetReceived' is measured with.
+  static qint64 clockNs();
+
+  const LiveReloadClientStats& stats() const { return m_Stats; }
+  QTcpSocket&                  socket() { return m_Socket; }
+
+  void connectToEditor(const QString& host, quint16 port);
+
+ signals:
+  // `type` is what the packet was once unwrapped from 'Compressed' / 'SharedMemory', `error` is empty when it was valid.
+  // `received_ns` is when the read that completed the packet started, see 'clockNs'.
+  void packetReceived(std::uint32_t type, const QUuid& spritesheet, qint64 size, const QString& error, qint64 received_ns);
+  void disconnected();
+
+ private slots:
+  void onConnected();
+  void onReadyRead();
+
+ private:
+  QString checkPacket(const QByteArray& packet, bool is_wrapped, std::uint32_t& out_type, QUuid& out_spritesheet);
+  QString checkAtlasTexture(const QUuid& spritesheet, const char* payload, qsizetype payload_size);
+  QString checkAtlasRegions(const QUuid& spritesheet, const char* payload, qsizetype payload_size);
+};
+
+#endif  // SR_LIVE_RELOAD_CLIENT_HPP
@@ -0,0 +1,273 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_latency.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "sr_live_reload_latency.hpp"
+
+#include "Server/sr_live_reload_server.hpp"  // g_Server
+#include "Tools/sr_live_reload_client.hpp"   // LiveReloadTestClient
+#include "sr_main_window.hpp"                // MainWindow
+
+#include <QCoreApplication>  // QCoreApplication
+#include <QElapsedTimer>     // QElapsedTimer
+#include <QTimer>            // QTimer
+
+#include <algorithm>   // sort, rotate, max, fill, all_of, none_of
+#include <cmath>       // ceil
+#include <functional>  // function<T>
+#include <memory>      // unique_ptr<T>
+#include <vector>      // vector<T>
+
+// An edit has this long to reach every client before it counts as lost.
+static constexpr int k_EditTimeoutMs = 10000;
+
+// No packet arriving for this long means the previous edit is done being sent.
+static constexpr int k_SettleTimeMs = 20;
+
+struct EditKindStats final
+{
+  QString             name;
+  std::vector<qint64> latencies_ns;  //!< One per client per edit.
+  qint64              num_bytes;     //!< Received by all clients, socket and shared memory.
+  qint64              busy_ns;       //!< Summed time from each edit to the last packet it caused arriving.
+  int                 num_timeouts;  //!< Edits that did not reach every client.
+};
+
+// Keeps the gui thread's event loop going until `is_done` or `timeout_ms` passes.
+static bool waitUntil(const std::function<bool()>& is_done, int timeout_ms)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  while (!is_done() && !timer.hasExpired(timeout_ms))
+  {
+    QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents);
+  }
+
+  return is_done();
+}
+
+// Nearest rank, `sorted_values` must not be empty.
+static double percentileMs(const std::vector<qint64>& sorted_values, double percentile)
+{
+  const std::size_t rank = std::size_t(std::ceil(percentile * double(sorted_values.size())));
+
+  return double(sorted_values[std::max(rank, std::size_t(1)) - 1]) / 1000000.0;
+}
+
+int liveReloadLatencyBench(const LiveReloadLatencyOptions& options, QTextStream& out, QTextStream& err)
+{
+  if (!g_Server)
+  {
+    err << "The live reload server is not running." << Qt::endl;
+    return 1;
+  }
+
+  // Wakes 'waitUntil' up to check its timeout even when nothing arrives.
+  QTimer tick_timer;
+  tick_timer.start(10);
+
+  MainWindow  window{"Live Reload Bench"};
+  ProjectPtr& project = window.project();
+
+  if (!project->open(options.project_path))
+  {
+    err << "Failed to open project '" << options.project_path << "'." << Qt::endl;
+    return 1;
+  }
+
+  window.postLoadInit();
+
+  // The atlas is built in the background, it has to be in place before any edit is timed.
+  project->waitForAtlasExport();
+
+  // Connect the clients
+
+  // 'arrival_ns' is parallel to 'clients', when the current edit's packet arrived, -1 while waiting.
+  std::vector<std::unique_ptr<LiveReloadTestClient>> clients          = {};
+  std::vector<qint64>                                arrival_ns       = {};
+  std::function<bool(std::uint32_t)>                 is_edit_packet   = {};
+  qint64                                             num_packets      = 0;
+  qint64                                             last_received_ns = 0;
+
+  for (int i = 0; i < options.num_clients; ++i)
+  {
+    LiveReloadTestClient* const client = clients.emplace_back(std::make_unique<LiveReloadTestClient>(options.capabilities)).get();
+
+    arrival_ns.push_back(-1);
+
+    QObject::connect(client, &LiveReloadTestClient::packetReceived, [&, i](std::uint32_t type, const QUuid&, qint64, const QString& error, qint64 received_ns) {
+      if (!error.isEmpty())
+      {
+        err << "INVALID " << LiveReloadTestClient::packetTypeName(type) << ": " << error << Qt::endl;
+      }
+
+      if (arrival_ns[i] < 0 && is_edit_packet && is_edit_packet(type))
+      {
+        arrival_ns[i] = received_ns;
+      }
+
+      last_received_ns = received_ns;
+      ++num_packets;
+    });
+
+    client->connectToEditor("127.0.0.1", SpriteAnim::k_ServerPort);
+  }
+
+  const auto all_connected = [&]() {
+    return g_Server->numClients() >= options.num_clients &&
+           std::all_of(clients.begin(), clients.end(), [](const auto& client) { return client->socket().state() == QAbstractSocket::ConnectedState; });
+  };
+
+  if (!waitUntil(all_connected, k_EditTimeoutMs))
+  {
+    err << "Failed to connect " << options.num_clients << " client(s) to port " << SpriteAnim::k_ServerPort << "." << Qt::endl;
+    return 1;
+  }
+
+  const auto total_bytes = [&]() {
+    qint64 num_bytes = 0;
+
+    for (const auto& client : clients)
+    {
+      num_bytes += client->stats().num_socket_bytes + client->stats().num_shared_bytes;
+    }
+
+    return num_bytes;
+  };
+
+  const auto settle = [&]() {
+    qint64 last_num_packets = -1;
+
+    while (last_num_packets != num_packets)
+    {
+      last_num_packets = num_packets;
+      waitUntil([]() { return false; }, k_SettleTimeMs);
+    }
+  };
+
+  // Makes `edit` once and waits for a packet `is_expected` accepts at every client.
+  const auto time_edit = [&](EditKindStats& stats, const std::function<void()>& edit, const std::function<bool(std::uint32_t)>& is_expected) {
+    settle();
+
+    std::fill(arrival_ns.begin(), arrival_ns.end(), -1);
+    is_edit_packet = is_expected;
+
+    const qint64 bytes_before = total_bytes();
+    const qint64 edit_ns      = LiveReloadTestClient::clockNs();
+
+    edit();
+
+    const bool did_arrive = waitUntil([&]() { return std::none_of(arrival_ns.begin(), arrival_ns.end(), [](qint64 t) { return t < 0; }); }, k_EditTimeoutMs);
+
+    is_edit_packet = {};
+    settle();
+
+    if (!did_arrive)
+    {
+      ++stats.num_timeouts;
+      return;
+    }
+
+    for (const qint64 t : arrival_ns)
+    {
+      stats.latencies_ns.push_back(t - edit_ns);
+    }
+
+    stats.num_bytes += total_bytes() - bytes_before;
+    stats.busy_ns += std::max(last_received_ns, edit_ns) - edit_ns;
+  };
+
+  // The Edit Script
+
+  EditKindStats frames_stats = {"frames", {}, 0, 0, 0};
+  EditKindStats atlas_stats  = {"atlas", {}, 0, 0, 0};
+
+  int animation_index = -1;
+
+  for (int i = 0; i < project->numAnimations() && animation_index == -1; ++i)
+  {
+    if (project->animationAt(i)->numFrames() >= 2)
+    {
+      animation_index = i;
+    }
+  }
+
+  if (animation_index != -1)
+  {
+    project->selectAnimation(animation_index);
+
+    Animation* const animation = project->animationAt(animation_index);
+
+    // Reorders the frames, only the 'AnimationFramesChanged' of the selected animation is sent.
+    for (int i = 0; i < options.num_edits; ++i)
+    {
+      time_edit(
+       frames_stats,
+       [&]() {
+         project->recordAnimationAction("Live Reload Bench", animation, [animation]() {
+           std::rotate(animation->frames.begin(), animation->frames.begin() + 1, animation->frames.end());
+         });
+       },
+       [](std::uint32_t type) { return type == SpriteAnim::LiveReloadPacketHeader::AnimationFramesChanged; });
+    }
+  }
+  else
+  {
+    err << "No animation with 2 or more frames, skipping the frame edits." << Qt::endl;
+  }
+
+  const int frame_size = int(project->spritesheetFrameSize());
+
+  // Flips the frame size back and forth, every frame is repainted so the whole atlas changes.
+  for (int i = 0; i < options.num_edits; ++i)
+  {
+    time_edit(
+     atlas_stats,
+     [&]() { project->setSpritesheetFrameSize(i % 2 == 0 ? std::max(frame_size * 3 / 4, 1) : frame_size); },
+     [](std::uint32_t type) { return type == SpriteAnim::LiveReloadPacketHeader::AtlasTextureChanged || type == k_LiveReloadPacket_AtlasRegionsChanged; });
+  }
+
+  // Report
+
+  out << "Live reload latency of '" << project->name() << "', " << options.num_clients << " client(s), " << options.num_edits
+      << " edit(s) of each kind, capabilities 0x" << QString::number(options.capabilities, 16) << Qt::endl;
+  out << QString("%1 %2 %3 %4 %5 %6").arg("edit", -8).arg("p50 ms", 10).arg("p99 ms", 10).arg("max ms", 10).arg("MB/s", 10).arg("timeouts", 10) << Qt::endl;
+
+  for (EditKindStats* const stats : {&frames_stats, &atlas_stats})
+  {
+    if (stats->latencies_ns.empty())
+    {
+      out << QString("%1 %2").arg(stats->name, -8).arg("n/a", 10) << Qt::endl;
+      continue;
+    }
+
+    std::sort(stats->latencies_ns.begin(), stats->latencies_ns.end());
+
+    const double megabytes_per_second = stats->busy_ns > 0 ? (double(stats->num_bytes) / 1000000.0) / (double(stats->busy_ns) / 1000000000.0) : 0.0;
+
+    out << QString("%1 %2 %3 %4 %5 %6")
+            .arg(stats->name, -8)
+            .arg(percentileMs(stats->latencies_ns, 0.50), 10, 'f', 3)
+            .arg(percentileMs(stats->latencies_ns, 0.99), 10, 'f', 3)
+            .arg(double(stats->latencies_ns.back()) / 1000000.0, 10, 'f', 3)
+            .arg(megabytes_per_second, 10, 'f', 1)
+            .arg(stats->num_timeouts, 10)
+        << Qt::endl;
+  }
+
+  qint64 num_invalid = 0;
+
+  for (const auto& client : clients)
+  {
+    num_invalid += client->stats().num_invalid;
+  }
+
+  out << num_packets << " packet(s) received, " << num_invalid << " invalid" << Qt::endl;
+
+  return num_invalid != 0 || frames_stats.num_timeouts != 0 || atlas_stats.num_timeouts != 0 ? 1 : 0;
+}
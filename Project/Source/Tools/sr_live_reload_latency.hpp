@@ -0,0 +1,33 @@
+//
+// SR Spritesheet Manager
+//
+// file:   sr_live_reload_latency.hpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#ifndef SR_LIVE_RELOAD_LATENCY_HPP
+#define SR_LIVE_RELOAD_LATENCY_HPP
+
+#include <QString>      // QString
+#include <QTextStream>  // QTextStream
+
+#include <cstdint>  // uint32_t
+
+// NOTE(SR):
+//   Runs inside the editor ('--live-reload-bench') since the edits go through a real 'Project' / 'MainWindow',
+//   the clients are 'LiveReloadTestClient's on the gui thread so the edit and the arrival are timed with the same clock.
+
+struct LiveReloadLatencyOptions final
+{
+  QString       project_path;  //!< The '.srsmproj.json' to edit, it is never saved.
+  int           num_edits;     //!< Of each kind of edit.
+  int           num_clients;   //!<
+  std::uint32_t capabilities;  //!< Sent in every client's hello, 0 connects them as plain clients.
+};
+
+// Opens the project, connects the clients to 'g_Server' and times each scripted edit from
+// the moment it is made to its packet arriving at every client. Returns the exit code for 'main'.
+int liveReloadLatencyBench(const LiveReloadLatencyOptions& options, QTextStream& out, QTextStream& err);
+
+#endif  // SR_LIVE_RELOAD_LATENCY_HPP
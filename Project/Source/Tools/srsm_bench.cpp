@@ -0,0 +1,224 @@
+//
+// SR Spritesheet Manager
+//
+// file:   srsm_bench.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "Data/sr_png_encoder.hpp"  // pngEncode, PngStreamEncoder
+
+#include <QBrush>              // QRadialGradient
+#include <QBuffer>             // QBuffer
+#include <QColor>              // QColor
+#include <QCommandLineParser>  // QCommandLineParser
+#include <QElapsedTimer>       // QElapsedTimer
+#include <QGuiApplication>     // QGuiApplication
+#include <QPainter>            // QPainter
+#include <QRandomGenerator>    // QRandomGenerator
+#include <QTextStream>         // QTextStream
+
+#include <algorithm>   // sort
+#include <functional>  // function<T>
+#include <utility>     // move
+#include <vector>      // vector<T>
+
+// NOTE(SR):
+//   Times the export png encode of an atlas sized image:
+//     srsm-bench [--size <px>] [--iterations <count>] [--levels <l,...>] [--threads <t,...>] [image]
+//   Without an image a synthetic "sprite atlas" (mostly transparent with opaque blobs) is generated.
+//   'pngStream' feeds the same image through 'PngStreamEncoder' a band at a time, it must match 'pngEncode' byte for byte.
+
+static QImage generateAtlasImage(int size)
+{
+  QImage image(size, size, QImage::Format_ARGB32);
+  image.fill(Qt::transparent);
+
+  QRandomGenerator rng(1337);
+  QPainter         painter(&image);
+
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setPen(Qt::NoPen);
+
+  const int cell_size = std::max(size / 16, 1);
+
+  for (int y = 0; y < size; y += cell_size)
+  {
+    for (int x = 0; x < size; x += cell_size)
+    {
+      // Sprites rarely fill their frame, leave a random border around each blob.
+      const int inset = rng.bounded(cell_size / 8 + 1, cell_size / 3 + 2);
+
+      QRadialGradient gradient(x + cell_size / 2, y + cell_size / 2, cell_size / 2);
+      gradient.setColorAt(0.0, QColor::fromRgb(rng.generate() | 0xFF000000u));
+      gradient.setColorAt(1.0, QColor::fromRgb(rng.generate() & 0x80FFFFFFu));
+
+      painter.setBrush(gradient);
+      painter.drawEllipse(x + inset, y + inset, cell_size - inset * 2, cell_size - inset * 2);
+    }
+  }
+
+  painter.end();
+
+  return image;
+}
+
+static std::vector<int> parseIntList(const QString& value)
+{
+  std::vector<int> result = {};
+
+  for (const QString& item : value.split(',', Qt::SkipEmptyParts))
+  {
+    result.push_back(item.trimmed().toInt());
+  }
+
+  return result;
+}
+
+// Runs `encode` `num_iterations` times, returns the median time and keeps the last output.
+static double timeEncode(int num_iterations, QByteArray& out_bytes, const std::function<bool(QBuffer&)>& encode)
+{
+  std::vector<double> times_ms = {};
+
+  for (int i = 0; i < num_iterations; ++i)
+  {
+    QByteArray bytes = {};
+    QBuffer    buffer(&bytes);
+    buffer.open(QBuffer::WriteOnly);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!encode(buffer))
+    {
+      return -1.0;
+    }
+
+    times_ms.push_back(double(timer.nsecsElapsed()) / 1000000.0);
+    out_bytes = std::move(bytes);
+  }
+
+  std::sort(times_ms.begin(), times_ms.end());
+
+  return times_ms[times_ms.size() / 2];
+}
+
+int main(int argc, char* argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+  {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  QGuiApplication app(argc, argv);
+  QGuiApplication::setApplicationName("srsm-bench");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Compares the parallel png encoder used for exports with QImage::save.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("image", "Image to encode, a synthetic atlas is generated if not given.", "[image]");
+
+  const QCommandLineOption size_option("size", "Width / height of the synthetic atlas.", "px", "4096");
+  const QCommandLineOption iterations_option("iterations", "Number of times each encode is run, the median is reported.", "count", "3");
+  const QCommandLineOption levels_option("levels", "Comma separated compression levels to test.", "levels", "1,6,9");
+  const QCommandLineOption threads_option("threads", "Comma separated thread counts to test, 0 is one per core.", "counts", "1,2,4,0");
+
+  parser.addOption(size_option);
+  parser.addOption(iterations_option);
+  parser.addOption(levels_option);
+  parser.addOption(threads_option);
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  const QStringList positional_args = parser.positionalArguments();
+  QImage            image           = positional_args.isEmpty() ? generateAtlasImage(parser.value(size_option).toInt()) : QImage(positional_args[0]);
+
+  if (image.isNull())
+  {
+    err << "Failed to load the image to encode." << Qt::endl;
+    return 1;
+  }
+
+  // Both encoders are compared from the format the atlas is built in.
+  image = image.convertToFormat(QImage::Format_ARGB32);
+
+  const int    num_iterations = std::max(parser.value(iterations_option).toInt(), 1);
+  const double image_mb       = double(image.sizeInBytes()) / (1024.0 * 1024.0);
+  bool         all_valid      = true;
+
+  out << "Encoding " << image.width() << "x" << image.height() << " (" << QString::number(image_mb, 'f', 1) << " MB), median of " << num_iterations << " run(s)" << Qt::endl;
+  out << QString("%1 %2 %3 %4 %5 %6").arg("encoder", -12).arg("level", 6).arg("threads", 8).arg("ms", 10).arg("MB/s", 10).arg("size", 12) << Qt::endl;
+
+  const auto report = [&](const QString& encoder_name, int level, const QString& threads, double time_ms, const QByteArray& bytes) {
+    if (time_ms < 0.0)
+    {
+      err << encoder_name << " failed to encode." << Qt::endl;
+      all_valid = false;
+      return;
+    }
+
+    // Make sure a faster encode is not a broken one.
+    const bool is_valid = QImage::fromData(bytes, "PNG").convertToFormat(QImage::Format_ARGB32) == image;
+
+    all_valid = all_valid && is_valid;
+
+    out << QString("%1 %2 %3 %4 %5 %6%7")
+            .arg(encoder_name, -12)
+            .arg(level, 6)
+            .arg(threads, 8)
+            .arg(time_ms, 10, 'f', 1)
+            .arg(image_mb / (time_ms / 1000.0), 10, 'f', 1)
+            .arg(bytes.size(), 12)
+            .arg(is_valid ? "" : "  MISMATCH")
+        << Qt::endl;
+  };
+
+  for (const int level : parseIntList(parser.value(levels_option)))
+  {
+    // Qt maps the quality of a png to a zlib level as '(100 - quality) * 9 / 91'.
+    const int  quality    = 100 - (level * 91 + 8) / 9;
+    QByteArray qt_bytes   = {};
+    const auto qt_time_ms = timeEncode(num_iterations, qt_bytes, [&image, quality](QBuffer& buffer) {
+      return image.save(&buffer, "PNG", quality);
+    });
+
+    report("QImage::save", level, "1", qt_time_ms, qt_bytes);
+
+    for (const int num_threads : parseIntList(parser.value(threads_option)))
+    {
+      QByteArray bytes   = {};
+      const auto time_ms = timeEncode(num_iterations, bytes, [&image, level, num_threads](QBuffer& buffer) {
+        return pngEncode(image, PngEncodeOptions{level, num_threads, false}, buffer);
+      });
+
+      report("pngEncode", level, num_threads <= 0 ? QString("auto") : QString::number(num_threads), time_ms, bytes);
+
+      QByteArray stream_bytes   = {};
+      const auto stream_time_ms = timeEncode(num_iterations, stream_bytes, [&image, level, num_threads](QBuffer& buffer) {
+        PngStreamEncoder encoder(buffer, image.size(), PngEncodeOptions{level, num_threads, false});
+
+        for (int y = 0; y < image.height(); y += encoder.rowsPerBand())
+        {
+          if (!encoder.writeRows(image.copy(0, y, image.width(), std::min(encoder.rowsPerBand(), image.height() - y))))
+          {
+            return false;
+          }
+        }
+
+        return encoder.finish();
+      });
+
+      report("pngStream", level, num_threads <= 0 ? QString("auto") : QString::number(num_threads), stream_time_ms, stream_bytes);
+
+      if (stream_time_ms >= 0.0 && stream_bytes != bytes)
+      {
+        err << "pngStream at level " << level << " does not match pngEncode byte for byte." << Qt::endl;
+        all_valid = false;
+      }
+    }
+  }
+
+  return all_valid ? 0 : 1;
+}
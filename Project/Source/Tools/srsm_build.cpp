@@ -0,0 +1,170 @@
+//
+// SR Spritesheet Manager
+//
+// file:   srsm_build.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "Data/sr_build_cache.hpp"  // buildCacheDefaultDir
+#include "sr_batch_build.hpp"         // batchCollectProjects, batchBuildProjects
+
+#include <QCommandLineParser>  // QCommandLineParser
+#include <QElapsedTimer>       // QElapsedTimer
+#include <QGuiApplication>     // QGuiApplication
+#include <QTextStream>         // QTextStream
+
+#include <algorithm>  // max
+
+// NOTE(SR):
+//   Builds and exports the spritesheets of projects without the editor:
+//     srsm-build [-o <dir>] [-j <threads>] [-z <level>] [--encode-threads <count>] [--stream] [--cache-dir <dir> | --no-cache] <paths...>
+//   Only QtCore / QtGui are used (no widgets) so this can run on a machine without a display.
+
+static const char* const k_StageNames[] = {"load", "decode", "layout", "composite", "export"};
+
+static_assert(sizeof(k_StageNames) / sizeof(k_StageNames[0]) == int(BatchStage::Count), "A name is needed for each stage.");
+
+static double bytesToMB(qint64 num_bytes)
+{
+  return double(num_bytes) / (1024.0 * 1024.0);
+}
+
+static void printResult(const BatchBuildResult& result, QTextStream& out, QTextStream& err)
+{
+  if (!result.error.isEmpty())
+  {
+    err << "'" << result.project_path << "' failed: " << result.error << Qt::endl;
+    return;
+  }
+
+  if (result.is_cached)
+  {
+    out << result.name << ": " << result.num_images << " images, unchanged (from the build cache) in " << result.wall_time_ms << " ms" << Qt::endl;
+    return;
+  }
+
+  out << result.name << ": "
+      << result.num_images << " images, "
+      << result.num_unique_frames << " unique frames, "
+      << result.num_pages << " page(s), "
+      << QString::number(bytesToMB(result.input_bytes), 'f', 2) << " MB in, "
+      << QString::number(bytesToMB(result.output_bytes), 'f', 2) << " MB out" << Qt::endl;
+
+  out << " ";
+
+  for (int i = 0; i < int(BatchStage::Count); ++i)
+  {
+    out << " " << k_StageNames[i] << " " << result.stage_time_ms[i] << " ms,";
+  }
+
+  out << " wall " << result.wall_time_ms << " ms" << Qt::endl;
+}
+
+int main(int argc, char* argv[])
+{
+  // NOTE(SR): Nothing is ever shown so the offscreen platform keeps Qt from needing a display.
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+  {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  QGuiApplication app(argc, argv);
+  QGuiApplication::setApplicationName("srsm-build");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Builds and exports the spritesheets of SR Spritesheet Manager projects.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("paths", "'.srsmproj.json' / '.srsmproj.bin' files, directories to search for them or manifests listing one path per line.", "<paths...>");
+
+  const QCommandLineOption output_option({"o", "output"}, "Directory to export to, defaults to each project's folder.", "dir");
+  const QCommandLineOption threads_option({"j", "threads"}, "Number of threads shared by all projects, 0 uses one per core.", "count", "0");
+  const QCommandLineOption compression_option({"z", "compression"}, "PNG compression level, 0 is fastest and 9 is smallest.", "level", QString::number(k_PngDefaultCompressionLevel));
+  const QCommandLineOption encode_threads_option("encode-threads", "Threads each page is compressed with, pages are already compressed in parallel with each other.", "count", "1");
+  const QCommandLineOption stream_option("stream", "Composite each page straight into its png a band of rows at a time, for atlases too big to hold in memory.");
+  const QCommandLineOption cache_dir_option("cache-dir", "Build cache to reuse unchanged exports from, defaults to the one shared with the editor.", "dir", buildCacheDefaultDir());
+  const QCommandLineOption no_cache_option("no-cache", "Always rebuild, the build cache is neither read nor written.");
+
+  parser.addOption(output_option);
+  parser.addOption(threads_option);
+  parser.addOption(compression_option);
+  parser.addOption(encode_threads_option);
+  parser.addOption(stream_option);
+  parser.addOption(cache_dir_option);
+  parser.addOption(no_cache_option);
+  parser.process(app);
+
+  const QStringList positional_args = parser.positionalArguments();
+
+  if (positional_args.isEmpty())
+  {
+    parser.showHelp(1);
+  }
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  QStringList       collect_errors = {};
+  const QStringList project_paths  = batchCollectProjects(positional_args, collect_errors);
+
+  for (const QString& error : collect_errors)
+  {
+    err << error << Qt::endl;
+  }
+
+  if (project_paths.isEmpty())
+  {
+    err << "No projects found." << Qt::endl;
+    return 1;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+
+  BatchBuildOptions options = {};
+  options.output_dir        = parser.value(output_option);
+  options.cache_dir         = parser.isSet(no_cache_option) ? QString() : parser.value(cache_dir_option);
+  options.num_threads       = parser.value(threads_option).toInt();
+  options.png_options       = PngEncodeOptions{parser.value(compression_option).toInt(), parser.value(encode_threads_option).toInt(), false};
+  options.stream_pages      = parser.isSet(stream_option);
+
+  const std::vector<BatchBuildResult> results = batchBuildProjects(project_paths, options);
+
+  const qint64 wall_time_ms = timer.elapsed();
+
+  int    num_failed  = 0;
+  int    num_cached  = 0;
+  qint64 num_frames  = 0;
+  qint64 input_bytes = 0;
+
+  for (const BatchBuildResult& result : results)
+  {
+    printResult(result, out, err);
+
+    if (result.error.isEmpty())
+    {
+      num_cached += result.is_cached ? 1 : 0;
+      num_frames += result.num_images;
+      input_bytes += result.input_bytes;
+    }
+    else
+    {
+      ++num_failed;
+    }
+  }
+
+  // Guard against a divide by zero for tiny builds.
+  const double wall_time_s = double(std::max<qint64>(wall_time_ms, 1)) / 1000.0;
+
+  if (results.size() > 1u)
+  {
+    out << Qt::endl;
+  }
+
+  out << (results.size() - num_failed) << " project(s) built (" << num_cached << " from the build cache), " << num_failed << " failed, "
+      << num_frames << " frames in " << wall_time_ms << " ms ("
+      << QString::number(double(num_frames) / wall_time_s, 'f', 1) << " frames/sec, "
+      << QString::number(bytesToMB(input_bytes) / wall_time_s, 'f', 2) << " MB/sec)" << Qt::endl;
+
+  return num_failed == 0 && collect_errors.isEmpty() ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+//
+// SR Spritesheet Manager
+//
+// file:   srsm_live_reload_bench.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "Server/sr_live_reload_packet.hpp"  // liveReloadAnimationPacket
+
+#include <QCommandLineParser>  // QCommandLineParser
+#include <QCoreApplication>    // QCoreApplication
+#include <QElapsedTimer>       // QElapsedTimer
+#include <QFile>               // QFile
+#include <QTcpServer>          // QTcpServer
+#include <QTcpSocket>          // QTcpSocket
+#include <QTextStream>         // QTextStream
+
+#include <algorithm>   // sort, max
+#include <functional>  // function<T>
+#include <vector>      // vector<T>
+
+// NOTE(SR):
+//   Times sending one 'AnimationFramesChanged' packet to several clients over loopback:
+//     srsm-live-reload-bench [--frames <count>] [--clients <count>] [--iterations <count>]
+//   "per-field" is how the server used to write (one 'QTcpSocket::write' per header / string / frame, per client),
+//   "single buffer" is the packet assembled once and the same buffer written to every client.
+
+struct SendStats final
+{
+  qint64 num_write_calls = 0;   //!< 'QTcpSocket::write' calls per iteration.
+  qint64 num_syscalls    = -1;  //!< write(2) calls per iteration, -1 where the OS does not say.
+  double median_ms       = 0.0;
+  bool   is_valid        = true;
+};
+
+// Number of write syscalls this process has made, -1 if not known (Linux only).
+static qint64 writeSyscallCount()
+{
+  QFile io_file("/proc/self/io");
+
+  if (io_file.open(QFile::ReadOnly | QFile::Text))
+  {
+    for (const QByteArray& line : io_file.readAll().split('\n'))
+    {
+      if (line.startsWith("syscw:"))
+      {
+        return line.mid(6).trimmed().toLongLong();
+      }
+    }
+  }
+
+  return -1;
+}
+
+static SendStats timeSend(int num_iterations, const QByteArray& expected_packet, const std::vector<QTcpSocket*>& senders, const std::vector<QTcpSocket*>& receivers, const std::function<qint64()>& send)
+{
+  SendStats           stats           = {};
+  std::vector<double> times_ms        = {};
+  qint64              num_write_calls = 0;
+
+  const qint64 syscalls_before = writeSyscallCount();
+
+  for (int i = 0; i < num_iterations; ++i)
+  {
+    QElapsedTimer timer;
+    timer.start();
+
+    num_write_calls += send();
+
+    // Done once every client has the whole packet.
+    for (QTcpSocket* const sender : senders)
+    {
+      while (sender->bytesToWrite() > 0 && sender->waitForBytesWritten(1000))
+      {
+      }
+    }
+
+    for (QTcpSocket* const receiver : receivers)
+    {
+      QByteArray received = receiver->readAll();
+
+      while (received.size() < expected_packet.size() && receiver->waitForReadyRead(1000))
+      {
+        received += receiver->readAll();
+      }
+
+      stats.is_valid = stats.is_valid && received == expected_packet;
+    }
+
+    times_ms.push_back(double(timer.nsecsElapsed()) / 1000000.0);
+  }
+
+  const qint64 syscalls_after = writeSyscallCount();
+
+  std::sort(times_ms.begin(), times_ms.end());
+
+  stats.num_write_calls = num_write_calls / num_iterations;
+  stats.num_syscalls    = syscalls_before < 0 ? -1 : (syscalls_after - syscalls_before) / num_iterations;
+  stats.median_ms       = times_ms[times_ms.size() / 2];
+
+  return stats;
+}
+
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("srsm-live-reload-bench");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Compares writing live reload packets field by field with writing one shared buffer.");
+  parser.addHelpOption();
+
+  const QCommandLineOption frames_option("frames", "Number of frames in the animation.", "count", "500");
+  const QCommandLineOption clients_option("clients", "Number of connected clients.", "count", "4");
+  const QCommandLineOption iterations_option("iterations", "Number of packets sent, the median time is reported.", "count", "200");
+
+  parser.addOption(frames_option);
+  parser.addOption(clients_option);
+  parser.addOption(iterations_option);
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  const int num_frames     = std::max(parser.value(frames_option).toInt(), 0);
+  const int num_clients    = std::max(parser.value(clients_option).toInt(), 1);
+  const int num_iterations = std::max(parser.value(iterations_option).toInt(), 1);
+
+  QTcpServer server;
+
+  if (!server.listen(QHostAddress::LocalHost, 0))
+  {
+    err << "Failed to listen on a local port: " << server.errorString() << Qt::endl;
+    return 1;
+  }
+
+  // The server's end of each connection sends, like the editor, the connecting end plays the engine.
+  std::vector<QTcpSocket*> senders   = {};
+  std::vector<QTcpSocket*> receivers = {};
+
+  for (int i = 0; i < num_clients; ++i)
+  {
+    QTcpSocket* const receiver = new QTcpSocket(&app);
+    receiver->connectToHost(QHostAddress::LocalHost, server.serverPort());
+
+    if (!receiver->waitForConnected(1000) || !server.waitForNewConnection(1000))
+    {
+      err << "Failed to connect client " << i << "." << Qt::endl;
+      return 1;
+    }
+
+    senders.push_back(server.nextPendingConnection());
+    receivers.push_back(receiver);
+  }
+
+  std::vector<SpriteAnim::SpriteAnimationFrame> frames(num_frames);
+
+  for (int i = 0; i < num_frames; ++i)
+  {
+    frames[i].frame_index = std::uint32_t(i);
+    frames[i].frame_time  = 1.0f / 24.0f;
+  }
+
+  const QUuid      spritesheet = QUuid::createUuid();
+  const QByteArray name        = QByteArrayLiteral("Bench Animation");
+  const auto       make_packet = [&]() {
+    return liveReloadAnimationPacket(SpriteAnim::LiveReloadPacketHeader::AnimationFramesChanged, spritesheet, name, frames.data(), std::uint32_t(frames.size()));
+  };
+
+  const QByteArray expected_packet = make_packet();
+
+  out << num_frames << " frame animation (" << expected_packet.size() << " byte packet) to " << num_clients << " client(s), median of " << num_iterations << " send(s)" << Qt::endl;
+  out << QString("%1 %2 %3 %4").arg("method", -14).arg("writes", 8).arg("syscalls", 10).arg("ms", 10) << Qt::endl;
+
+  bool all_valid = true;
+
+  const auto report = [&](const QString& method_name, const SendStats& stats) {
+    all_valid = all_valid && stats.is_valid;
+
+    out << QString("%1 %2 %3 %4%5")
+            .arg(method_name, -14)
+            .arg(stats.num_write_calls, 8)
+            .arg(stats.num_syscalls < 0 ? QString("n/a") : QString::number(stats.num_syscalls), 10)
+            .arg(stats.median_ms, 10, 'f', 3)
+            .arg(stats.is_valid ? "" : "  MISMATCH")
+        << Qt::endl;
+  };
+
+  // Same bytes as the single buffer, written in the pieces the server used to write them in.
+  const SendStats per_field_stats = timeSend(num_iterations, expected_packet, senders, receivers, [&]() -> qint64 {
+    const char* const packet      = expected_packet.constData();
+    const qsizetype   header_size = sizeof(SpriteAnim::LiveReloadPacketHeader);
+    const qsizetype   anim_size   = sizeof(SpriteAnim::SpriteAnimation);
+    const qsizetype   frame_size  = sizeof(SpriteAnim::SpriteAnimationFrame);
+    const qsizetype   frames_at   = header_size + anim_size + name.size();
+    qint64            num_writes  = 0;
+
+    for (QTcpSocket* const sender : senders)
+    {
+      sender->write(packet, header_size);
+      sender->write(packet + header_size, anim_size);
+      sender->write(packet + header_size + anim_size, name.size());
+      num_writes += 3;
+
+      for (int i = 0; i < num_frames; ++i)
+      {
+        sender->write(packet + frames_at + i * frame_size, frame_size);
+        ++num_writes;
+      }
+    }
+
+    return num_writes;
+  });
+
+  const SendStats single_buffer_stats = timeSend(num_iterations, expected_packet, senders, receivers, [&]() -> qint64 {
+    const QByteArray packet = make_packet();
+
+    for (QTcpSocket* const sender : senders)
+    {
+      sender->write(packet);
+    }
+
+    return qint64(senders.size());
+  });
+
+  report("per-field", per_field_stats);
+  report("single buffer", single_buffer_stats);
+
+  return all_valid ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+//
+// SR Spritesheet Manager
+//
+// file:   srsm_live_reload_client.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "Tools/sr_live_reload_client.hpp"  // LiveReloadTestClient
+
+#include <QCommandLineParser>  // QCommandLineParser
+#include <QCoreApplication>    // QCoreApplication
+#include <QTextStream>         // QTextStream
+
+// NOTE(SR):
+//   Connects to a running editor like an engine would and checks every packet it is sent:
+//     srsm-live-reload-client [--host <address>] [--port <port>] [--count <packets>] [--plain] [--no-shared-memory] [--no-compression] [--quiet]
+//   Exits once the editor disconnects or '--count' packets arrived, with 1 if any packet was invalid.
+
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("srsm-live-reload-client");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Headless live reload client that checks the packets the editor sends.");
+  parser.addHelpOption();
+
+  const QCommandLineOption host_option("host", "Address of the editor.", "address", "127.0.0.1");
+  const QCommandLineOption port_option("port", "Port of the editor.", "port", QString::number(SpriteAnim::k_ServerPort));
+  const QCommandLineOption count_option("count", "Exit after this many packets, 0 waits for the editor to disconnect.", "packets", "0");
+  const QCommandLineOption plain_option("plain", "Do not send a hello, only get the runtime's own packets.");
+  const QCommandLineOption no_shared_memory_option("no-shared-memory", "Do not ask for atlases through shared memory.");
+  const QCommandLineOption no_compression_option("no-compression", "Do not ask for compressed atlases.");
+  const QCommandLineOption quiet_option(QStringList{"q", "quiet"}, "Only print invalid packets and the summary.");
+
+  parser.addOption(host_option);
+  parser.addOption(port_option);
+  parser.addOption(count_option);
+  parser.addOption(plain_option);
+  parser.addOption(no_shared_memory_option);
+  parser.addOption(no_compression_option);
+  parser.addOption(quiet_option);
+  parser.process(app);
+
+  std::uint32_t capabilities = LiveReloadTestClient::supportedCapabilities();
+
+  if (parser.isSet(no_shared_memory_option))
+  {
+    capabilities &= ~std::uint32_t(LiveReloadCapability_SharedMemory);
+  }
+
+  if (parser.isSet(no_compression_option))
+  {
+    capabilities &= ~std::uint32_t(LiveReloadCapability_LZ4 | LiveReloadCapability_Zstd);
+  }
+
+  if (parser.isSet(plain_option))
+  {
+    capabilities = 0u;
+  }
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  const qint64         max_packets = parser.value(count_option).toLongLong();
+  const bool           is_quiet    = parser.isSet(quiet_option);
+  qint64               num_packets = 0;
+  LiveReloadTestClient client{capabilities};
+
+  QObject::connect(&client, &LiveReloadTestClient::packetReceived, [&](std::uint32_t type, const QUuid& spritesheet, qint64 size, const QString& error, qint64 /* received_ns */) {
+    if (!error.isEmpty())
+    {
+      err << "INVALID " << LiveReloadTestClient::packetTypeName(type) << " (" << size << " bytes): " << error << Qt::endl;
+    }
+    else if (!is_quiet)
+    {
+      out << LiveReloadTestClient::packetTypeName(type) << " " << spritesheet.toString(QUuid::WithoutBraces) << " " << size << " bytes" << Qt::endl;
+    }
+
+    if (max_packets > 0 && ++num_packets == max_packets)
+    {
+      QCoreApplication::quit();
+    }
+  });
+
+  QObject::connect(&client, &LiveReloadTestClient::disconnected, &app, &QCoreApplication::quit);
+  QObject::connect(&client.socket(), &QTcpSocket::errorOccurred, [&](QAbstractSocket::SocketError) {
+    err << "Connection failed: " << client.socket().errorString() << Qt::endl;
+    QCoreApplication::exit(1);
+  });
+
+  client.connectToEditor(parser.value(host_option), quint16(parser.value(port_option).toUInt()));
+
+  const int app_result = app.exec();
+
+  const LiveReloadClientStats& stats = client.stats();
+
+  out << "Received " << stats.num_socket_bytes << " bytes over the socket, " << stats.num_shared_bytes << " through shared memory" << Qt::endl;
+
+  for (auto it = stats.num_packets.cbegin(); it != stats.num_packets.cend(); ++it)
+  {
+    out << "  " << QString("%1").arg(it.key(), -24) << it.value() << Qt::endl;
+  }
+
+  out << stats.num_invalid << " invalid, " << stats.num_overwritten << " overwritten in shared memory before being read" << Qt::endl;
+
+  return app_result != 0 || stats.num_invalid != 0 ? 1 : 0;
+}
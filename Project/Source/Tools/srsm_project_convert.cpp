@@ -0,0 +1,159 @@
+//
+// SR Spritesheet Manager
+//
+// file:   srsm_project_convert.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "Data/sr_project_binary.hpp"  // ProjectBinaryFile, projectBinaryFromJson, projectBinaryToJson
+
+#include <QCommandLineParser>  // QCommandLineParser
+#include <QCoreApplication>    // QCoreApplication
+#include <QElapsedTimer>       // QElapsedTimer
+#include <QFile>               // QFile
+#include <QJsonDocument>       // QJsonDocument
+#include <QSaveFile>           // QSaveFile
+#include <QTextStream>         // QTextStream
+
+// NOTE(SR):
+//   Converts a project between the json and binary formats:
+//     srsm-project-convert [--time] <input> <output>
+//   The input's format is detected from its first bytes, the output is binary when it ends in '.srsmproj.bin'.
+//   The conversion is checked to round trip back to the same json before anything is written.
+
+static bool readJsonProject(const QString& file_path, QJsonObject& out_project, QString& out_error)
+{
+  QFile file(file_path);
+
+  if (!file.open(QFile::ReadOnly))
+  {
+    out_error = QString("Failed to open '%1': %2").arg(file_path, file.errorString());
+    return false;
+  }
+
+  QJsonParseError     parse_error = {};
+  const QJsonDocument json_doc    = QJsonDocument::fromJson(file.readAll(), &parse_error);
+
+  if (!json_doc.isObject())
+  {
+    out_error = QString("'%1' is not a valid project: %2").arg(file_path, parse_error.errorString());
+    return false;
+  }
+
+  out_project = json_doc.object();
+  return true;
+}
+
+// What loading `file_path` costs before a single field can be read, the whole parse for json and just the map for binary.
+static double loadTimeMs(const QString& file_path, int num_iterations)
+{
+  const bool    is_binary = ProjectBinaryFile::isBinaryProject(file_path);
+  QElapsedTimer timer;
+  QString       error;
+
+  timer.start();
+
+  for (int i = 0; i < num_iterations; ++i)
+  {
+    if (is_binary)
+    {
+      ProjectBinaryFile file;
+      file.open(file_path, error);
+    }
+    else
+    {
+      QJsonObject project;
+      readJsonProject(file_path, project, error);
+    }
+  }
+
+  return double(timer.nsecsElapsed()) / 1000000.0 / double(num_iterations);
+}
+
+int main(int argc, char* argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("srsm-project-convert");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Converts a spritesheet project between the json and binary formats.");
+  parser.addHelpOption();
+
+  const QCommandLineOption time_option("time", "Print how long the input and output each take to load.");
+
+  parser.addOption(time_option);
+  parser.addPositionalArgument("input", "The '.srsmproj.json' or '.srsmproj.bin' to convert.", "<input>");
+  parser.addPositionalArgument("output", "Where to write the converted project, binary if it ends in '.srsmproj.bin'.", "<output>");
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  const QStringList paths = parser.positionalArguments();
+
+  if (paths.size() != 2)
+  {
+    parser.showHelp(1);
+  }
+
+  const QString& input_path  = paths[0];
+  const QString& output_path = paths[1];
+  QJsonObject    project     = {};
+  QString        error       = {};
+
+  if (ProjectBinaryFile::isBinaryProject(input_path))
+  {
+    ProjectBinaryFile file;
+
+    if (!file.open(input_path, error))
+    {
+      err << error << Qt::endl;
+      return 1;
+    }
+
+    project = projectBinaryToJson(file);
+
+    if (file.isCorrupt())
+    {
+      err << "'" << input_path << "' is corrupt, an array is out of bounds." << Qt::endl;
+      return 1;
+    }
+  }
+  else if (!readJsonProject(input_path, project, error))
+  {
+    err << error << Qt::endl;
+    return 1;
+  }
+
+  const QByteArray  binary_bytes = projectBinaryFromJson(project);
+  ProjectBinaryFile round_trip;
+
+  if (!round_trip.openData(binary_bytes, error) || projectBinaryToJson(round_trip) != project)
+  {
+    err << "'" << input_path << "' does not convert losslessly, nothing was written." << Qt::endl;
+    return 1;
+  }
+
+  const bool       is_binary_output = output_path.endsWith(k_ProjectBinaryExtension);
+  const QByteArray output_bytes     = is_binary_output ? binary_bytes : QJsonDocument(project).toJson(QJsonDocument::Indented);
+  QSaveFile        output_file(output_path);
+
+  if (!output_file.open(QFile::WriteOnly) || output_file.write(output_bytes) != output_bytes.size() || !output_file.commit())
+  {
+    err << "Failed to write '" << output_path << "': " << output_file.errorString() << Qt::endl;
+    return 1;
+  }
+
+  out << "Wrote " << output_path << " (" << output_bytes.size() << " bytes)" << Qt::endl;
+
+  if (parser.isSet(time_option))
+  {
+    static constexpr int k_NumTimeIterations = 20;
+
+    out << QString("%1 %2").arg(input_path, -48).arg(loadTimeMs(input_path, k_NumTimeIterations), 10, 'f', 3) << " ms" << Qt::endl;
+    out << QString("%1 %2").arg(output_path, -48).arg(loadTimeMs(output_path, k_NumTimeIterations), 10, 'f', 3) << " ms" << Qt::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,297 @@
+//
+// SR Spritesheet Manager
+//
+// file:   srsm_resample_bench.cpp
+// author: Shareef Abdoul-Raheem
+// Copyright (c) 2021 Shareef Abdoul-Raheem
+//
+
+#include "Data/sr_image_resample.hpp"  // imageResample
+
+#include <QBrush>              // QRadialGradient
+#include <QColor>              // QColor
+#include <QCommandLineParser>  // QCommandLineParser
+#include <QElapsedTimer>       // QElapsedTimer
+#include <QGuiApplication>     // QGuiApplication
+#include <QPainter>            // QPainter
+#include <QRandomGenerator>    // QRandomGenerator
+#include <QTextStream>         // QTextStream
+
+#include <algorithm>   // sort, max
+#include <cmath>       // sqrt, lround
+#include <cstdlib>     // abs
+#include <functional>  // function<T>
+#include <utility>     // move
+#include <vector>      // vector<T>
+
+// NOTE(SR):
+//   Compares the frame scaling the atlas builder used to do ('QPainter' with 'SmoothPixmapTransform') with 'imageResample':
+//     srsm-resample-bench [--size <px>] [--iterations <count>] [--scales <s,...>] [image]
+//   Speed is timed on the image (a generated sprite sheet without one). Quality is the aliasing of a 1px black / white
+//   checkerboard scaled the same amount, an ideal filter gives flat gray so the RMS distance from gray is how much aliasing got through.
+//   Each SIMD path is also checked against the scalar one, they may only differ by rounding.
+
+static constexpr int k_MaxIsaDifference = 1;
+
+static QImage generateSpriteImage(int size)
+{
+  QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+
+  QRandomGenerator rng(1337);
+  QPainter         painter(&image);
+
+  painter.setRenderHint(QPainter::Antialiasing);
+  painter.setPen(Qt::NoPen);
+
+  const int cell_size = std::max(size / 8, 1);
+
+  for (int y = 0; y < size; y += cell_size)
+  {
+    for (int x = 0; x < size; x += cell_size)
+    {
+      QRadialGradient gradient(x + cell_size / 2, y + cell_size / 2, cell_size / 2);
+      gradient.setColorAt(0.0, QColor::fromRgb(rng.generate() | 0xFF000000u));
+      gradient.setColorAt(1.0, QColor::fromRgb(rng.generate() & 0x80FFFFFFu));
+
+      painter.setBrush(gradient);
+      painter.drawEllipse(x + 2, y + 2, cell_size - 4, cell_size - 4);
+    }
+  }
+
+  painter.end();
+
+  return image;
+}
+
+static QImage generateCheckerImage(int size)
+{
+  QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+
+  for (int y = 0; y < size; ++y)
+  {
+    QRgb* const row = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+    for (int x = 0; x < size; ++x)
+    {
+      row[x] = ((x ^ y) & 1) ? 0xFFFFFFFFu : 0xFF000000u;
+    }
+  }
+
+  return image;
+}
+
+static std::vector<double> parseDoubleList(const QString& value)
+{
+  std::vector<double> result = {};
+
+  for (const QString& item : value.split(',', Qt::SkipEmptyParts))
+  {
+    result.push_back(item.trimmed().toDouble());
+  }
+
+  return result;
+}
+
+static QImage painterResample(const QImage& image, const QSize& size)
+{
+  QImage result(size, QImage::Format_ARGB32_Premultiplied);
+  result.fill(Qt::transparent);
+
+  QPainter painter(&result);
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+  painter.setCompositionMode(QPainter::CompositionMode_Source);
+  painter.drawImage(QRectF(result.rect()), image, QRectF(image.rect()));
+  painter.end();
+
+  return result;
+}
+
+// Runs `resample` `num_iterations` times, returns the median time and keeps the last output.
+static double timeResample(int num_iterations, QImage& out_image, const std::function<QImage()>& resample)
+{
+  std::vector<double> times_ms = {};
+
+  for (int i = 0; i < num_iterations; ++i)
+  {
+    QElapsedTimer timer;
+    timer.start();
+
+    QImage image = resample();
+
+    times_ms.push_back(double(timer.nsecsElapsed()) / 1000000.0);
+    out_image = std::move(image);
+  }
+
+  std::sort(times_ms.begin(), times_ms.end());
+
+  return times_ms[times_ms.size() / 2];
+}
+
+static double aliasingRms(const QImage& image)
+{
+  double sum_sq = 0.0;
+
+  for (int y = 0; y < image.height(); ++y)
+  {
+    const QRgb* const row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+
+    for (int x = 0; x < image.width(); ++x)
+    {
+      const double r = qRed(row[x]) - 127.5;
+      const double g = qGreen(row[x]) - 127.5;
+      const double b = qBlue(row[x]) - 127.5;
+
+      sum_sq += r * r + g * g + b * b;
+    }
+  }
+
+  const double num_samples = double(image.width()) * double(image.height()) * 3.0;
+
+  return num_samples > 0.0 ? std::sqrt(sum_sq / num_samples) : 0.0;
+}
+
+static int maxDifference(const QImage& lhs, const QImage& rhs)
+{
+  if (lhs.size() != rhs.size())
+  {
+    return 255;
+  }
+
+  int result = 0;
+
+  for (int y = 0; y < lhs.height(); ++y)
+  {
+    const uchar* const lhs_row = lhs.constScanLine(y);
+    const uchar* const rhs_row = rhs.constScanLine(y);
+
+    for (int x = 0; x < lhs.width() * 4; ++x)
+    {
+      result = std::max(result, std::abs(int(lhs_row[x]) - int(rhs_row[x])));
+    }
+  }
+
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+  {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  QGuiApplication app(argc, argv);
+  QGuiApplication::setApplicationName("srsm-resample-bench");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Compares the frame resampler used by the atlas builder with QPainter scaling.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("image", "Image to scale, a synthetic sprite sheet is generated if not given.", "[image]");
+
+  const QCommandLineOption size_option("size", "Width / height of the synthetic images.", "px", "1024");
+  const QCommandLineOption iterations_option("iterations", "Number of times each resample is run, the median is reported.", "count", "5");
+  const QCommandLineOption scales_option("scales", "Comma separated scale factors to test.", "scales", "2,0.5,0.3,0.13");
+
+  parser.addOption(size_option);
+  parser.addOption(iterations_option);
+  parser.addOption(scales_option);
+  parser.process(app);
+
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+
+  const QStringList positional_args = parser.positionalArguments();
+  const int         synthetic_size  = std::max(parser.value(size_option).toInt(), 1);
+  QImage            image           = positional_args.isEmpty() ? generateSpriteImage(synthetic_size) : QImage(positional_args[0]);
+
+  if (image.isNull())
+  {
+    err << "Failed to load the image to scale." << Qt::endl;
+    return 1;
+  }
+
+  image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+  const QImage checker_image  = generateCheckerImage(synthetic_size);
+  const int    num_iterations = std::max(parser.value(iterations_option).toInt(), 1);
+  const double source_mp      = double(image.width()) * double(image.height()) / 1000000.0;
+  bool         all_valid      = true;
+
+  std::vector<ResampleIsa> isas = {};
+
+  for (const ResampleIsa isa : {ResampleIsa::Scalar, ResampleIsa::SSE41, ResampleIsa::AVX2})
+  {
+    if (imageResampleIsaIsAvailable(isa))
+    {
+      isas.push_back(isa);
+    }
+  }
+
+  out << "Scaling " << image.width() << "x" << image.height() << ", median of " << num_iterations << " run(s), best isa is " << imageResampleIsaName(imageResampleBestIsa()) << Qt::endl;
+  out << QString("%1 %2 %3 %4 %5 %6 %7").arg("filter", -10).arg("isa", -7).arg("scale", 6).arg("ms", 10).arg("MP/s", 10).arg("alias rms", 10).arg("max diff", 9) << Qt::endl;
+
+  const auto report = [&out](const QString& filter_name, const QString& isa_name, double scale, double time_ms, double source_mp, double alias_rms, const QString& max_diff) {
+    out << QString("%1 %2 %3 %4 %5 %6 %7")
+            .arg(filter_name, -10)
+            .arg(isa_name, -7)
+            .arg(scale, 6, 'f', 2)
+            .arg(time_ms, 10, 'f', 2)
+            .arg(source_mp / (time_ms / 1000.0), 10, 'f', 1)
+            .arg(alias_rms, 10, 'f', 2)
+            .arg(max_diff, 9)
+        << Qt::endl;
+  };
+
+  for (const double scale : parseDoubleList(parser.value(scales_option)))
+  {
+    const QSize size(std::max(int(std::lround(image.width() * scale)), 1), std::max(int(std::lround(image.height() * scale)), 1));
+    const QSize checker_size(std::max(int(std::lround(checker_image.width() * scale)), 1), std::max(int(std::lround(checker_image.height() * scale)), 1));
+
+    QImage     painter_result  = {};
+    const auto painter_time_ms = timeResample(num_iterations, painter_result, [&image, &size]() {
+      return painterResample(image, size);
+    });
+
+    report("QPainter", "-", scale, painter_time_ms, source_mp, aliasingRms(painterResample(checker_image, checker_size)), "-");
+
+    for (const ResampleFilter filter : {ResampleFilter::Box, ResampleFilter::Lanczos3})
+    {
+      const QString filter_name   = filter == ResampleFilter::Box ? "box" : "lanczos3";
+      QImage        scalar_result = {};
+
+      for (const ResampleIsa isa : isas)
+      {
+        QImage     result  = {};
+        const auto time_ms = timeResample(num_iterations, result, [&image, &size, filter, isa]() {
+          return imageResample(image, QRectF(image.rect()), size, filter, isa);
+        });
+
+        QString max_diff = "-";
+
+        if (isa == ResampleIsa::Scalar)
+        {
+          scalar_result = result;
+        }
+        else
+        {
+          const int difference = maxDifference(result, scalar_result);
+
+          max_diff  = QString::number(difference);
+          all_valid = all_valid && difference <= k_MaxIsaDifference;
+
+          if (difference > k_MaxIsaDifference)
+          {
+            max_diff += " MISMATCH";
+          }
+        }
+
+        const double alias_rms = aliasingRms(imageResample(checker_image, QRectF(checker_image.rect()), checker_size, filter, isa));
+
+        report(filter_name, imageResampleIsaName(isa), scale, time_ms, source_mp, alias_rms, max_diff);
+      }
+    }
+  }
+
+  return all_valid ? 0 : 1;
+}
@@ -13,6 +13,7 @@
 AnimatedSprite::AnimatedSprite(Project* project) :
   m_Project{project},
   m_UvRect{0.0f, 0.0f, 1.0f, 1.0f},
+  m_FrameOffset{0.0f, 0.0f},
   m_Bounds{0.0f, 0.0f, 0.0f, 0.0f}
 {
   setFlags(flags() & ~(ItemIsSelectable | ItemIsMovable | ItemIsFocusable));
@@ -28,8 +29,8 @@ void AnimatedSprite::updateBounds()
 {
   const QSize  pixmap_size = pixmap().size();
   const QRectF src_rect    = QRectF(
-   0,
-   0,
+   m_FrameOffset.x(),
+   m_FrameOffset.y(),
    m_UvRect.width() * pixmap_size.width(),
    m_UvRect.height() * pixmap_size.height());
 
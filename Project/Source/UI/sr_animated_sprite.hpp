@@ -18,6 +18,7 @@ class AnimatedSprite : public QGraphicsPixmapItem
  private:
   Project* m_Project;
   QRectF   m_UvRect;
+  QPointF  m_FrameOffset;  //!< Where a trimmed frame sits within its untrimmed frame.
   QRectF   m_Bounds;
 
  public:
@@ -30,6 +31,7 @@ class AnimatedSprite : public QGraphicsPixmapItem
   int    type() const override { return QGraphicsItem::UserType + 1; }
 
   void setUVRect(const QRectF& rect) { m_UvRect = rect; }
+  void setFrameOffset(const QPointF& offset) { m_FrameOffset = offset; }
 
   // QGraphicsItem interface
  public:
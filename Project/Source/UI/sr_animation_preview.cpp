@@ -241,14 +241,13 @@ void AnimationPreview::onAnimationSelected(Animation* anim, int index)
 
   if (m_CurrentAnim)
   {
-    m_Sprite->setPixmap(m_Atlas->pixmap);
-    m_Sprite->updateBounds();
     onFrameSelected(m_CurrentAnim);
   }
   else
   {
     m_Sprite->setPixmap(m_NoSelectedAnimPixmap);
     m_Sprite->setUVRect(QRectF(0.0f, 0.0f, 1.0f, 1.0f));
+    m_Sprite->setFrameOffset(QPointF(0.0f, 0.0f));
     m_Sprite->updateBounds();
     fitSpriteIntoView();
   }
@@ -272,8 +271,6 @@ void AnimationPreview::onAtlasUpdated(AtlasExport& atlas)
     m_CurrentAnim->previewed_frame      = 0;
     m_CurrentAnim->previewed_frame_time = 0.0f;
 
-    m_Sprite->setPixmap(m_Atlas->pixmap);
-    m_Sprite->updateBounds();
     onFrameSelected(m_CurrentAnim);
   }
 
@@ -282,20 +279,30 @@ void AnimationPreview::onAtlasUpdated(AtlasExport& atlas)
 
 void AnimationPreview::onFrameSelected(Animation* anim)
 {
-  const int num_frames = m_CurrentAnim ? m_CurrentAnim->numFrames() : 0;
-  const int index      = m_CurrentAnim ? m_CurrentAnim->previewed_frame : 0;
+  const int num_frames  = m_CurrentAnim ? m_CurrentAnim->numFrames() : 0;
+  const int index       = m_CurrentAnim ? m_CurrentAnim->previewed_frame : 0;
+  const int image_index = m_CurrentAnim && index < num_frames && index >= 0 ? m_CurrentAnim->frameAt(index)->source->index : -1;
+  const int page_index  = m_Atlas && image_index >= 0 && std::size_t(image_index) < m_Atlas->layout.image_pages.size() ? m_Atlas->layout.image_pages[image_index] : -1;
+
+  // The atlas job for a newly added frame may still be running, the placeholder is shown until 'atlasModified' brings it in.
+  const bool is_in_atlas = page_index >= 0 && std::size_t(page_index) < m_Atlas->pages.size() &&
+                           std::size_t(image_index) < m_Atlas->layout.image_rects.size() &&
+                           std::size_t(image_index) < m_Atlas->layout.image_trims.size();
 
-  if (anim == m_CurrentAnim && index < num_frames && index >= 0)
+  if (anim == m_CurrentAnim && is_in_atlas)
   {
-    const QRect& frame_rect = m_Atlas->image_rectangles[m_CurrentAnim->frameAt(index)->source->index];
+    const QRect&          frame_rect  = m_Atlas->layout.image_rects[image_index];
+    const AtlasFrameTrim& frame_trim  = m_Atlas->layout.image_trims[image_index];
+    const QPixmap&        page_pixmap = m_Atlas->pages[page_index].pixmap;
 
-    m_Sprite->setPixmap(m_Atlas->pixmap);
+    m_Sprite->setPixmap(page_pixmap);
     m_Sprite->setUVRect(
      QRectF(
-      qreal(frame_rect.x()) / qreal(m_Atlas->pixmap.width()),
-      qreal(frame_rect.y()) / qreal(m_Atlas->pixmap.height()),
-      qreal(frame_rect.width()) / qreal(m_Atlas->pixmap.width()),
-      qreal(frame_rect.height()) / qreal(m_Atlas->pixmap.height())));
+      qreal(frame_rect.x()) / qreal(page_pixmap.width()),
+      qreal(frame_rect.y()) / qreal(page_pixmap.height()),
+      qreal(frame_rect.width()) / qreal(page_pixmap.width()),
+      qreal(frame_rect.height()) / qreal(page_pixmap.height())));
+    m_Sprite->setFrameOffset(frame_trim.offset);
     m_Sprite->updateBounds();
 
     if (m_AnimNewlySelected)
@@ -309,6 +316,7 @@ void AnimationPreview::onFrameSelected(Animation* anim)
   {
     m_Sprite->setPixmap(m_NoAnimFramesPixmap);
     m_Sprite->setUVRect(QRectF(0.0f, 0.0f, 1.0f, 1.0f));
+    m_Sprite->setFrameOffset(QPointF(0.0f, 0.0f));
     m_Sprite->updateBounds();
   }
 
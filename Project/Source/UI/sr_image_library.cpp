@@ -1,6 +1,8 @@
 #include "sr_image_library.hpp"
 
-#include "Data/sr_project.hpp"  // Project
+#include "Data/sr_project.hpp"         // Project
+#include "Data/sr_project_binary.hpp"  // ProjectBinaryFile
+#include "Data/sr_settings.hpp"        // Settings
 
 #include <QCollator>
 #include <QDragEnterEvent>
@@ -38,7 +40,9 @@ ImageLibrary::ImageLibrary(QWidget* parent) :
   QTreeWidget(parent),
   m_FileWatcher{},
   m_AbsToFrameSrc{},
-  m_LoadedImagesIndices{}
+  m_LoadedImagesIndices{},
+  m_ImageCache{qint64(Settings::imageCacheBudgetMB()) * 1024 * 1024},
+  m_ChangedImages{}
 {
   setAcceptDrops(true);
 
@@ -61,6 +65,21 @@ void ImageLibrary::deserialize(Project& project, const QJsonObject& data)
   deserializeImpl(project, invisibleRootItem(), data);
 }
 
+void ImageLibrary::deserialize(Project& project, const ProjectBinaryFile& data)
+{
+  m_LoadedImagesIndices.clear();
+  m_AbsToFrameSrc.clear();
+  clear();
+
+  std::uint32_t                      num_nodes = 0u;
+  const ProjectBinLibraryNode* const nodes     = data.elements(data.header().image_library, num_nodes);
+
+  if (num_nodes != 0u)
+  {
+    deserializeImpl(project, invisibleRootItem(), data, nodes, num_nodes, 0u);
+  }
+}
+
 void ImageLibrary::addImage(const QString& img_path, bool emit_signal)
 {
   addImage(invisibleRootItem(), img_path, emit_signal);
@@ -94,7 +113,23 @@ void ImageLibrary::onCustomCtxMenu(const QPoint& pos)
 
 void ImageLibrary::onFileWatcherDirOrFile(const QString& path)
 {
-  (void)path;
+  // NOTE(SR):
+  //   Anything that is not a known image (a directory) will leave
+  //   'm_ChangedImages' empty which makes the project do a full rebuild.
+
+  if (m_AbsToFrameSrc.contains(path))
+  {
+    // Some image editors save by replacing the file which removes it from the watcher.
+    if (!m_FileWatcher.files().contains(path) && QFileInfo::exists(path))
+    {
+      m_FileWatcher.addPath(path);
+    }
+
+    if (!m_ChangedImages.contains(path))
+    {
+      m_ChangedImages.push_back(path);
+    }
+  }
 
   emit signalImagesChanged();
 }
@@ -143,7 +178,7 @@ bool ImageLibrary::removeSelectedItems()
 
     if (do_removal)
     {
-      m_Project->recordAction(tr("Remove Imported Items"), UndoActionFlag_ModifiedAtlas, [&selected_items, &anim_to_frames_to_delete, this]() {
+      m_Project->recordAction(tr("Remove Imported Items"), UndoActionFlag_ModifiedLibrary | UndoActionFlag_ModifiedAtlas | UndoActionFlag_ModifiedAnimation, [&selected_items, &anim_to_frames_to_delete, this]() {
         for (const auto& anim : anim_to_frames_to_delete)
         {
           const auto& frame_indices = anim.second;
@@ -160,6 +195,7 @@ bool ImageLibrary::removeSelectedItems()
 
           m_FileWatcher.removePath(abs_path);
           m_AbsToFrameSrc.remove(abs_path);
+          m_ImageCache.remove(abs_path);
           delete item;
         }
       });
@@ -305,6 +341,44 @@ void ImageLibrary::deserializeImpl(Project& project, QTreeWidgetItem* parent, co
   }
 }
 
+// Same as the json version for the node at `index`, returns the index of the node after it and all of its children.
+std::uint32_t ImageLibrary::deserializeImpl(Project& project, QTreeWidgetItem* parent, const ProjectBinaryFile& data, const ProjectBinLibraryNode* nodes, std::uint32_t num_nodes, std::uint32_t index)
+{
+  const ProjectBinLibraryNode& node = nodes[index++];
+
+  if (node.type == ProjectBinNodeType_Folder)
+  {
+    parent->setExpanded(node.is_expanded != 0u);
+
+    for (std::uint32_t i = 0; i < node.num_children && index < num_nodes; ++i)
+    {
+      const ProjectBinLibraryNode& child = nodes[index];
+
+      if (child.type == ProjectBinNodeType_Folder)
+      {
+        QTreeWidgetItem* folder_item = new QTreeWidgetItem(parent, QStringList{data.string(child.text)});
+
+        folder_item->setFlags(folder_item->flags() | Qt::ItemIsEditable);
+
+        index = deserializeImpl(project, folder_item, data, nodes, num_nodes, index);
+      }
+      else
+      {
+        index = deserializeImpl(project, parent, data, nodes, num_nodes, index);
+      }
+    }
+  }
+  else
+  {
+    const QDir& dir = project.projectFolder();
+    QFileInfo   file_info(dir.filePath(data.string(node.text)));
+
+    addImage(parent, file_info.canonicalFilePath(), false);
+  }
+
+  return index;
+}
+
 void ImageLibrary::addDirectory(QStringList& files, bool emit_signal)
 {
   QCollator collator;
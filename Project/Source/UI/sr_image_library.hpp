@@ -1,13 +1,18 @@
 #ifndef SRSM_IMAGELIBRARY_HPP
 #define SRSM_IMAGELIBRARY_HPP
 
+#include "Data/sr_image_cache.hpp"  // ImageCache
+
 #include <QFileSystemWatcher>
 #include <QTreeWidget>
 
-#include <memory>
+#include <memory>   // shared_ptr<T>
+#include <utility>  // exchange
 
 class Project;
+class ProjectBinaryFile;
 struct Animation;
+struct ProjectBinLibraryNode;
 
 struct AnimationFrameSource final : public std::enable_shared_from_this<AnimationFrameSource>
 {
@@ -54,15 +59,20 @@ class ImageLibrary : public QTreeWidget
   QFileSystemWatcher                     m_FileWatcher;
   QMap<QString, AnimationFrameSourcePtr> m_AbsToFrameSrc;
   QVector<QString>                       m_LoadedImagesIndices;
+  ImageCache                             m_ImageCache;
+  QVector<QString>                       m_ChangedImages;
 
  public:
   ImageLibrary(QWidget* parent);
 
   int                     numImages() const { return m_AbsToFrameSrc.keys().size(); }
   const QVector<QString>& loadedImageList() const { return m_LoadedImagesIndices; }
+  ImageCache&             imageCache() { return m_ImageCache; }
+  QVector<QString>        takeChangedImages() { return std::exchange(m_ChangedImages, {}); }
 
   QJsonObject             serialize(Project& project);
   void                    deserialize(Project& project, const QJsonObject& data);
+  void                    deserialize(Project& project, const ProjectBinaryFile& data);
   void                    addImage(const QString& img_path, bool emit_signal = true);
   void                    addNewFolder();
   void                    addDirectory(QStringList& files, bool emit_signal = true);
@@ -88,10 +98,11 @@ class ImageLibrary : public QTreeWidget
   void keyPressEvent(QKeyEvent* event) override;
 
  private:
-  QJsonObject serializeImpl(Project& project, QTreeWidgetItem* item);
-  void        deserializeImpl(Project& project, QTreeWidgetItem* parent, const QJsonObject& data);
-  void        addImage(QTreeWidgetItem* parent, const QString& img_path, bool emit_signal = true);
-  void        checkForFramesInUse(QTreeWidgetItem* item, std::vector<ItemToDeleteInfo>& items_to_delete_info, std::unordered_map<Animation*, std::vector<int>>& anim_to_frames_to_delete);
+  QJsonObject   serializeImpl(Project& project, QTreeWidgetItem* item);
+  void          deserializeImpl(Project& project, QTreeWidgetItem* parent, const QJsonObject& data);
+  std::uint32_t deserializeImpl(Project& project, QTreeWidgetItem* parent, const ProjectBinaryFile& data, const ProjectBinLibraryNode* nodes, std::uint32_t num_nodes, std::uint32_t index);
+  void          addImage(QTreeWidgetItem* parent, const QString& img_path, bool emit_signal = true);
+  void          checkForFramesInUse(QTreeWidgetItem* item, std::vector<ItemToDeleteInfo>& items_to_delete_info, std::unordered_map<Animation*, std::vector<int>>& anim_to_frames_to_delete);
 };
 
 #endif  // SRSM_IMAGELIBRARY_HPP
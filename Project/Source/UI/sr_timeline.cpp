@@ -10,6 +10,7 @@
 
 #include "ui_sr_timeline.h"
 
+#include "Data/sr_atlas_builder.hpp"  // aspectRatioDrawRegion, roundToUpperMultiple
 #include "Data/sr_project.hpp"
 #include "UI/sr_image_library.hpp"
 
@@ -54,39 +55,6 @@ static int roundToLowerMultiple(int n, int grid_size)
   return (n / grid_size) * grid_size;
 }
 
-int roundToUpperMultiple(int n, int grid_size)
-{
-  const int remainder = grid_size == 0 ? 0 : n % grid_size;
-
-  return (remainder == 0) ? n : n + grid_size - remainder;
-}
-
-QRect aspectRatioDrawRegion(std::uint32_t aspect_w, std::uint32_t aspect_h, std::uint32_t window_w, std::uint32_t window_h)
-{
-  QRect result = {};
-
-  if (aspect_w > 0 && aspect_h > 0 && window_w > 0 && window_h > 0)
-  {
-    const float optimal_w = float(window_h) * (float(aspect_w) / float(aspect_h));
-    const float optimal_h = float(window_w) * (float(aspect_h) / float(aspect_w));
-
-    if (optimal_w > float(window_w))
-    {
-      result.setRight(int(window_w) - 1);
-      result.setTop(qRound(0.5f * (window_h - optimal_h)));
-      result.setBottom(int(result.top() + optimal_h) - 1);
-    }
-    else
-    {
-      result.setBottom(int(window_h) - 1);
-      result.setLeft(qRound(0.5f * (window_w - optimal_w)));
-      result.setRight(int(result.left() + optimal_w) - 1);
-    }
-  }
-
-  return result;
-}
-
 // TimelineSelectionItem Class
 
 bool TimelineSelectionItem::isValid() const
@@ -470,20 +438,19 @@ void Timeline::paintEvent(QPaintEvent* event)
 
   if (m_AtlasExport && m_CurrentAnimation)
   {
-    QPixmap&  atlas_image = m_AtlasExport->pixmap;
-    const int num_frames  = numFrames();
+    const int num_frames = numFrames();
 
     for (int i = 0; i < num_frames; ++i)
     {
       if (!m_Selection.isSelected(i))
       {
-        drawFrame(atlas_image, painter, i);
+        drawFrame(painter, i);
       }
     }
 
     // The selected frames needs to be drawn on top.
-    m_Selection.forEachSelectedItem([this, &atlas_image, &painter](int selected_item) {
-      drawFrame(atlas_image, painter, selected_item);
+    m_Selection.forEachSelectedItem([this, &painter](int selected_item) {
+      drawFrame(painter, selected_item);
     });
 
     if (m_DragMode != FrameDragMode::None)
@@ -896,9 +863,9 @@ void Timeline::mouseReleaseEvent(QMouseEvent* event)
 
           // Copy over new frame data
 
-          m_CurrentAnimation->parent->recordAction(
+          m_CurrentAnimation->parent->recordAnimationAction(
            tr("Edit Frame Order '%1'").arg(m_CurrentAnimation->name()),
-           UndoActionFlag_ModifiedAnimation,
+           m_CurrentAnimation,
            [&first_diff, &new_frames]() {
              std::copy(first_diff.first, new_frames.end(), first_diff.second);
            });
@@ -913,9 +880,9 @@ void Timeline::mouseReleaseEvent(QMouseEvent* event)
     {
       if (m_ResizedFrame)
       {
-        m_CurrentAnimation->parent->recordAction(
+        m_CurrentAnimation->parent->recordAnimationAction(
          tr("Edit Frame Time '%1'").arg(m_CurrentAnimation->name()),
-         UndoActionFlag_ModifiedAnimation,
+         m_CurrentAnimation,
          [this]() {
            m_Selection.forEachSelectedItem([this](int item) {
              m_CurrentAnimation->frameAt(item)->frame_time = m_DesiredFrameInfos[item].frame_time;
@@ -1060,9 +1027,9 @@ void Timeline::dropEvent(QDropEvent* event)
       return;
     }
 
-    m_CurrentAnimation->parent->recordAction(
+    m_CurrentAnimation->parent->recordAnimationAction(
      tr("Add Frames To %1").arg(m_CurrentAnimation->name()),
-     UndoActionFlag_ModifiedAnimation,
+     m_CurrentAnimation,
      [this, &frames_to_insert]() {
        std::vector<AnimationFrameInstance>& frames = m_CurrentAnimation->frames;
        const auto                           it     = iteratorFromFrameInfo(m_DroppedFrameInfo, frames);
@@ -1108,7 +1075,7 @@ void Timeline::recalculateTimelineSize(bool new_anim)
     {
       AnimationFrameInstance* const frame             = m_CurrentAnimation->frameAt(i);
       const float                   frame_time        = frame->frame_time;
-      const QRect&                  frame_uv_rect     = m_AtlasExport->image_rectangles[frame->source->index];
+      const QRect                   frame_uv_rect     = frameUVRect(frame->source->index);
       const float                   frame_width_scale = frame_time / base_frame_time;
       const int                     frame_width       = int(m_FrameHeight * frame_width_scale);
       const QRect                   resize_left       = QRect(current_x, frame_top, k_FramePadding, frame_height);
@@ -1230,24 +1197,52 @@ void Timeline::calculateDesiredLayout(bool use_selected_items)
   }
 }
 
+QRect Timeline::frameUVRect(int image_index) const
+{
+  if (!m_AtlasExport || image_index < 0 || std::size_t(image_index) >= m_AtlasExport->layout.image_rects.size())
+  {
+    return {};
+  }
+
+  return m_AtlasExport->layout.image_rects[image_index];
+}
+
+const QPixmap* Timeline::framePagePixmap(int image_index) const
+{
+  if (!m_AtlasExport || image_index < 0 || std::size_t(image_index) >= m_AtlasExport->layout.image_pages.size())
+  {
+    return nullptr;
+  }
+
+  const int page_index = m_AtlasExport->layout.image_pages[image_index];
+
+  return page_index >= 0 && std::size_t(page_index) < m_AtlasExport->pages.size() ? &m_AtlasExport->pages[page_index].pixmap : nullptr;
+}
+
 int Timeline::numFrames() const
 {
   return m_CurrentAnimation ? m_CurrentAnimation->numFrames() : 0;
 }
 
-void Timeline::drawFrame(const QPixmap& atlas_image, QPainter& painter, int index)
+void Timeline::drawFrame(QPainter& painter, int index)
 {
-  const auto&  frame_rect_info = m_FrameInfos[index];
-  const QRect& frame_rect      = frame_rect_info.image;
-  const QRect& pixmap_src      = frame_rect_info.frame_uv_rect;
-  const QRect  pixmap_dst      = aspectRatioDrawRegion(pixmap_src.width(), pixmap_src.height(), frame_rect.width() - 1, frame_rect.height() - 1).translated(frame_rect.topLeft());
+  const auto&    frame_rect_info = m_FrameInfos[index];
+  const QRect&   frame_rect      = frame_rect_info.image;
+  const QRect&   pixmap_src      = frame_rect_info.frame_uv_rect;
+  const QPixmap* atlas_image     = framePagePixmap(frame_rect_info.frame_src->index);
 
   painter.fillRect(frame_rect, k_BackgroundBrush);
 
-  painter.drawPixmap(
-   pixmap_dst,
-   atlas_image,
-   pixmap_src);
+  // Just the background until 'atlasModified' brings an atlas with this frame in it.
+  if (atlas_image && !pixmap_src.isEmpty())
+  {
+    const QRect pixmap_dst = aspectRatioDrawRegion(pixmap_src.width(), pixmap_src.height(), frame_rect.width() - 1, frame_rect.height() - 1).translated(frame_rect.topLeft());
+
+    painter.drawPixmap(
+     pixmap_dst,
+     *atlas_image,
+     pixmap_src);
+  }
 
   // Draw Inner Framing
 
@@ -1386,7 +1381,7 @@ bool Timeline::removeSelectedFrames()
 {
   if (!m_Selection.isEmpty())
   {
-    m_CurrentAnimation->parent->recordAction("Delete Frames", UndoActionFlag_ModifiedAnimation, [this]() {
+    m_CurrentAnimation->parent->recordAnimationAction("Delete Frames", m_CurrentAnimation, [this]() {
       m_Selection.forEachSelectedItem<true>([this](int item) {
         m_CurrentAnimation->frames.erase(m_CurrentAnimation->frames.begin() + item);
       });
@@ -196,8 +196,10 @@ class Timeline final : public QWidget
  private:
   void             recalculateTimelineSize(bool new_anim = false);
   void             calculateDesiredLayout(bool use_selected_items);
+  QRect            frameUVRect(int image_index) const;      // Empty while the atlas does not have the image yet.
+  const QPixmap*   framePagePixmap(int image_index) const;  // nullptr while the atlas does not have the image yet.
   int              numFrames() const;
-  void             drawFrame(const QPixmap& atlas_image, QPainter& painter, int index);
+  void             drawFrame(QPainter& painter, int index);
   FrameInfoAtPoint infoAt(const QPoint& local_mouse_pos, bool allow_active_item, bool allow_last_frame_right_ext = false) const;
   FrameInfoAtPoint dropInfoAt(const QPoint& local_mouse_pos);  // Uses 'logical' frame positioning rather than 'physical' layout
   bool             removeSelectedFrames();
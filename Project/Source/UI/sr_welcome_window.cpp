@@ -132,7 +132,7 @@ void WelcomeWindow::on_m_NewProjectBtn_clicked()
 
 void WelcomeWindow::on_m_OpenProjectBtn_clicked()
 {
-  const QString json_file = QFileDialog::getOpenFileName(this, "Select A Spritesheet", QString(), "Spritesheet Project (*.srsmproj.json)");
+  const QString json_file = QFileDialog::getOpenFileName(this, "Select A Spritesheet", QString(), "Spritesheet Project (*.srsmproj.json *.srsmproj.bin)");
 
   if (!json_file.isEmpty())
   {
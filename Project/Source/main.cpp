@@ -8,15 +8,21 @@
 
 #include "Data/sr_settings.hpp"              // Settings
 #include "Server/sr_live_reload_server.hpp"  // g_Server
+#include "Tools/sr_live_reload_client.hpp"   // LiveReloadTestClient
+#include "Tools/sr_live_reload_latency.hpp"  // liveReloadLatencyBench
 #include "UI/sr_image_library.hpp"           // AnimationFrameSourcePtr
 #include "UI/sr_welcome_window.hpp"          // WelcomeWindow
 
-#include <QApplication>     // QApplication
-#include <QDir>             // For MacOS
-#include <QMessageBox>      // QMessageBox
-#include <QSharedMemory  >  // QSharedMemory
-#include <QStyleFactory>    // QStyleFactory
-#include <QMetaType> // qRegisterMetaTypeStreamOperators
+#include <QApplication>        // QApplication
+#include <QCommandLineParser>  // QCommandLineParser
+#include <QDir>                // For MacOS
+#include <QMessageBox>         // QMessageBox
+#include <QSharedMemory>       // QSharedMemory
+#include <QStyleFactory>       // QStyleFactory
+#include <QTextStream>         // QTextStream
+#include <QMetaType>           // qRegisterMetaTypeStreamOperators
+
+#include <algorithm>  // max
 
 /*!
  * @brief main
@@ -72,6 +78,62 @@ int main(int argc, char *argv[])
   app.setPalette(palette);
 #endif
 
+  QCommandLineParser       parser;
+  const QCommandLineOption help_option = parser.addHelpOption();
+
+  const QCommandLineOption bench_option("live-reload-bench", "Times scripted edits of a project reaching live reload clients, then exits.", "project");
+  const QCommandLineOption bench_edits_option("bench-edits", "Number of edits of each kind for '--live-reload-bench'.", "count", "50");
+  const QCommandLineOption bench_clients_option("bench-clients", "Number of clients for '--live-reload-bench'.", "count", "1");
+  const QCommandLineOption bench_plain_option("bench-plain", "Connect the '--live-reload-bench' clients without a hello.");
+
+  parser.addOption(bench_option);
+  parser.addOption(bench_edits_option);
+  parser.addOption(bench_clients_option);
+  parser.addOption(bench_plain_option);
+
+  // NOTE(SR): Not 'process' since that exits on an unknown option, the platform or a launcher may pass some to the editor (macOS '-psn_...').
+  const bool parsed_args = parser.parse(app.arguments());
+
+  if (parser.isSet(help_option))
+  {
+    parser.showHelp();
+  }
+
+  if (parser.isSet(bench_option))
+  {
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (!parsed_args)
+    {
+      err << parser.errorText() << Qt::endl;
+      return 1;
+    }
+
+    g_Server = std::make_unique<LiveReloadServer>();
+
+    if (!g_Server->startServer())
+    {
+      err << "Failed to start the live reload server, is the editor already open?" << Qt::endl;
+      return 1;
+    }
+
+    g_Server->setCompression(LiveReloadCodec(Settings::liveReloadCompression()));
+
+    const LiveReloadLatencyOptions bench_options = {
+     parser.value(bench_option),
+     std::max(parser.value(bench_edits_option).toInt(), 1),
+     std::max(parser.value(bench_clients_option).toInt(), 1),
+     parser.isSet(bench_plain_option) ? 0u : LiveReloadTestClient::supportedCapabilities(),
+    };
+
+    const int bench_result = liveReloadLatencyBench(bench_options, out, err);
+
+    g_Server.reset();
+
+    return bench_result;
+  }
+
   QSharedMemory shared_mem{"SRSM.AppCount", nullptr};
 
   if (!shared_mem.attach(QSharedMemory::ReadWrite))
@@ -93,7 +155,7 @@ int main(int argc, char *argv[])
   }
   else
   {
-    g_Server->setup();
+    g_Server->setCompression(LiveReloadCodec(Settings::liveReloadCompression()));
   }
 
   Settings::openRecentFiles();
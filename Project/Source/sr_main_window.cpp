@@ -9,12 +9,15 @@
 #include "UI/sr_timeline.hpp"
 #include "UI/sr_welcome_window.hpp"
 
+#include "Server/sr_live_reload_codec.hpp"   // liveReloadCodecIsAvailable
 #include "Server/sr_live_reload_server.hpp"  // g_Server
 #include "sr_new_animation_dialog.hpp"
 
+#include <QActionGroup>
 #include <QCloseEvent>
 #include <QFileDialog>
 #include <QInputDialog>
+#include <QLocale>
 #include <QMessageBox>
 
 MainWindow::MainWindow(const QString& name, QWidget* parent) :
@@ -22,6 +25,8 @@ MainWindow::MainWindow(const QString& name, QWidget* parent) :
   m_BaseTitle{},
   m_OpenProject{std::make_unique<Project>(this, name)},
   m_PacketSendingProgress{this},
+  m_AtlasStats{this},
+  m_AtlasProgress{this},
   m_OnTimelineChange{}
 {
   setupUi(this);
@@ -44,6 +49,8 @@ MainWindow::MainWindow(const QString& name, QWidget* parent) :
   QObject::connect(m_TimelineFpsSpinbox, &QSpinBox::valueChanged, m_OpenProject.get(), &Project::onTimelineFpsChange);
   QObject::connect(m_OpenProject.get(), &Project::atlasModified, m_TimelineFrames, &Timeline::onAtlasUpdated);
   QObject::connect(m_OpenProject.get(), &Project::atlasModified, m_GfxPreview, &AnimationPreview::onAtlasUpdated);
+  QObject::connect(m_OpenProject.get(), &Project::atlasModified, this, &MainWindow::onAtlasStatsUpdated);
+  QObject::connect(m_OpenProject.get(), &Project::atlasProgress, this, &MainWindow::onAtlasProgress);
   QObject::connect(m_OpenProject.get(), &Project::animationChanged, m_TimelineFrames, &Timeline::onAnimationChanged);
   QObject::connect(m_OpenProject.get(), &Project::animationChanged, this, &MainWindow::onAnimChanged);
   QObject::connect(m_OpenProject.get(), &Project::animationChanged, m_GfxPreview, &AnimationPreview::onAnimationChanged);
@@ -53,6 +60,7 @@ MainWindow::MainWindow(const QString& name, QWidget* parent) :
   QObject::connect(m_ActionImageLibraryNewFolder, &QAction::triggered, m_OpenProject.get(), &Project::onCreateNewFolder);
   QObject::connect(m_ActionImportImages, &QAction::triggered, m_OpenProject.get(), &Project::onImportImages);
   QObject::connect(m_OpenProject.get(), &Project::renamed, this, &MainWindow::onProjectRenamed);
+  QObject::connect(&m_OpenProject->historyStack(), &QUndoStack::indexChanged, this, &MainWindow::onHistoryChanged);
   QObject::connect(m_AnimationList, &QListView::customContextMenuRequested, this, &MainWindow::onAnimationRightClick);
   QObject::connect(m_AnimationList->selectionModel(), &QItemSelectionModel::currentRowChanged, this, &MainWindow::onAnimationSelectionChanged);
 
@@ -84,6 +92,14 @@ MainWindow::MainWindow(const QString& name, QWidget* parent) :
 
   m_TimelinePlayButton->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
 
+  m_StatusBar->addPermanentWidget(&m_AtlasStats);
+  m_StatusBar->addPermanentWidget(&m_AtlasProgress);
+
+  // The atlas is rebuilt in the background, this is only shown while that is happening.
+  m_AtlasProgress.setFormat(tr("Atlas %p%"));
+  m_AtlasProgress.setMaximumWidth(160);
+  m_AtlasProgress.hide();
+
   QObject::connect(m_TimelinePlayButton, &QToolButton::clicked, [this]() {
     m_GfxPreview->onTogglePlayAnimation();
     m_TimelinePlayButton->setIcon(m_GfxPreview->isPlayingAnimation() ? style()->standardIcon(QStyle::SP_MediaPause) : style()->standardIcon(QStyle::SP_MediaPlay));
@@ -97,7 +113,33 @@ MainWindow::MainWindow(const QString& name, QWidget* parent) :
     QObject::connect(g_Server.get(), &LiveReloadServer::bytesSent, [this]() {
       m_PacketSendingProgress.setRange(0, g_Server->numBytesNeedSend());
       m_PacketSendingProgress.setValue(g_Server->numBytesSent());
+      m_PacketSendingProgress.setToolTip(tr("%1 queued, %2 dropped (superseded before a slow client got them)")
+                                           .arg(QLocale().formattedDataSize(g_Server->numBytesQueued()))
+                                           .arg(QLocale().formattedDataSize(g_Server->numBytesDropped())));
     });
+
+    // Atlas packets are only compressed for clients that said they can decode the chosen codec.
+    auto live_reload_menu  = new QMenu(tr("&Live Reload"), this);
+    auto compression_menu  = live_reload_menu->addMenu(tr("Atlas &Compression"));
+    auto compression_group = new QActionGroup(this);
+
+    for (const LiveReloadCodec codec : {LiveReloadCodec::None, LiveReloadCodec::LZ4, LiveReloadCodec::Zstd})
+    {
+      const bool is_available = liveReloadCodecIsAvailable(codec);
+      auto       action       = compression_menu->addAction(is_available ? tr(liveReloadCodecName(codec)) : tr("%1 (Not Built In)").arg(liveReloadCodecName(codec)));
+
+      action->setCheckable(true);
+      action->setChecked(codec == g_Server->compression());
+      action->setEnabled(is_available);
+      compression_group->addAction(action);
+
+      QObject::connect(action, &QAction::triggered, [codec]() {
+        g_Server->setCompression(codec);
+        Settings::setLiveReloadCompression(int(codec));
+      });
+    }
+
+    QMainWindow::menuBar()->insertMenu(menuAbout->menuAction(), live_reload_menu);
   }
 
   restoreWindowLayout();
@@ -108,9 +150,27 @@ void MainWindow::postLoadInit()
   onProjectRenamed(m_OpenProject->name());
   m_QualitySpritesheetSize->setValue(m_OpenProject->spritesheetImageSize());
   m_QualityFrameSize->setValue(m_OpenProject->spritesheetFrameSize());
+  m_QualityPackingMode->setCurrentIndex(int(m_OpenProject->atlasPackingMode()));
+  m_QualityTrimFrames->setChecked(m_OpenProject->trimTransparentBorders());
+  m_QualityMaxPageSize->setValue(m_OpenProject->maxPageSize());
+  m_QualityPremultipliedAlpha->setChecked(m_OpenProject->premultipliedAlpha());
+  m_DecodeThreadCount->setValue(Settings::decodeThreadCount());
+  m_PngCompressionLevel->setValue(Settings::pngCompressionLevel());
+  m_EncodeThreadCount->setValue(Settings::encodeThreadCount());
 
   QObject::connect(m_QualitySpritesheetSize, &QSpinBox::editingFinished, this, &MainWindow::onSpritesheetQualitySettingChanged);
   QObject::connect(m_QualityFrameSize, &QSpinBox::editingFinished, this, &MainWindow::onSpritesheetQualitySettingChanged);
+  QObject::connect(m_QualityPackingMode, &QComboBox::currentIndexChanged, this, &MainWindow::onSpritesheetQualitySettingChanged);
+  QObject::connect(m_QualityTrimFrames, &QCheckBox::toggled, this, &MainWindow::onSpritesheetQualitySettingChanged);
+  QObject::connect(m_QualityMaxPageSize, &QSpinBox::editingFinished, this, &MainWindow::onSpritesheetQualitySettingChanged);
+  QObject::connect(m_QualityPremultipliedAlpha, &QCheckBox::toggled, this, &MainWindow::onSpritesheetQualitySettingChanged);
+
+  // These are editor preferences rather than part of the document so they are not undo-able.
+  QObject::connect(m_DecodeThreadCount, &QSpinBox::valueChanged, &Settings::setDecodeThreadCount);
+  QObject::connect(m_PngCompressionLevel, &QSpinBox::valueChanged, &Settings::setPngCompressionLevel);
+  QObject::connect(m_EncodeThreadCount, &QSpinBox::valueChanged, &Settings::setEncodeThreadCount);
+
+  onHistoryChanged();
 }
 
 void MainWindow::onProjectRenamed(const QString& name)
@@ -174,6 +234,10 @@ void MainWindow::onSpritesheetQualitySettingChanged()
 {
   m_OpenProject->setSpritesheetImageSize(m_QualitySpritesheetSize->value());
   m_OpenProject->setSpritesheetFrameSize(m_QualityFrameSize->value());
+  m_OpenProject->setAtlasPackingMode(m_QualityPackingMode->currentIndex());
+  m_OpenProject->setTrimTransparentBorders(m_QualityTrimFrames->isChecked());
+  m_OpenProject->setMaxPageSize(m_QualityMaxPageSize->value());
+  m_OpenProject->setPremultipliedAlpha(m_QualityPremultipliedAlpha->isChecked());
 }
 
 void MainWindow::onAnimationSelectionChanged(const QModelIndex& current, const QModelIndex& /* previous */)
@@ -190,6 +254,32 @@ void MainWindow::onAnimChanged(Animation* anim)
   }
 }
 
+void MainWindow::onAtlasStatsUpdated(AtlasExport& atlas)
+{
+  m_AtlasStats.setText(tr("Decode: %1 ms (%2 threads, %3 cached)").arg(atlas.decode_time_ms).arg(atlas.decode_num_threads).arg(atlas.decode_cache_hits));
+}
+
+void MainWindow::onAtlasProgress(int value, int maximum)
+{
+  m_AtlasProgress.setRange(0, maximum);
+  m_AtlasProgress.setValue(value);
+  m_AtlasProgress.setVisible(value < maximum);
+}
+
+void MainWindow::onHistoryChanged()
+{
+  const QUndoStack& history    = m_OpenProject->historyStack();
+  const qint64      disk_usage = m_OpenProject->historyDiskUsage();
+  QString           text       = tr("%1 action(s), %2 in memory").arg(history.count()).arg(QLocale().formattedDataSize(qint64(m_OpenProject->historyMemoryUsage())));
+
+  if (disk_usage > 0)
+  {
+    text += tr(", %1 on disk").arg(QLocale().formattedDataSize(disk_usage));
+  }
+
+  m_HistoryMemoryLabel->setText(text);
+}
+
 void MainWindow::changeEvent(QEvent* e)
 {
   QMainWindow::changeEvent(e);
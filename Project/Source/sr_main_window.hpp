@@ -11,6 +11,7 @@
 
 #include "ui_sr_main_window.h"
 
+#include <QLabel>
 #include <QProgressBar>
 
 struct OnTimelineChange : public bf::IPropChangeListener<int>
@@ -36,6 +37,8 @@ class MainWindow : public QMainWindow, private Ui::MainWindow
   QString          m_BaseTitle;
   ProjectPtr       m_OpenProject;
   QProgressBar     m_PacketSendingProgress;
+  QLabel           m_AtlasStats;
+  QProgressBar     m_AtlasProgress;
   OnTimelineChange m_OnTimelineChange;
 
  public:
@@ -56,6 +59,9 @@ class MainWindow : public QMainWindow, private Ui::MainWindow
   void onSpritesheetQualitySettingChanged();
   void onAnimationSelectionChanged(const QModelIndex& current, const QModelIndex& previous);
   void onAnimChanged(Animation* anim);
+  void onAtlasStatsUpdated(AtlasExport& atlas);
+  void onAtlasProgress(int value, int maximum);
+  void onHistoryChanged();
 
   // QWidget interface
  protected: